@@ -0,0 +1,180 @@
+/*************************************************************************************
+ *  Copyright 2026 agent <agent@local>                                               *
+ *                                                                                   *
+ *  This library is free software; you can redistribute it and/or                    *
+ *  modify it under the terms of the GNU Lesser General Public                       *
+ *  License as published by the Free Software Foundation; either                     *
+ *  version 2.1 of the License, or (at your option) any later version.               *
+ *                                                                                   *
+ *  This library is distributed in the hope that it will be useful,                  *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of                   *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU                *
+ *  Lesser General Public License for more details.                                  *
+ *                                                                                   *
+ *  You should have received a copy of the GNU Lesser General Public                 *
+ *  License along with this library; if not, write to the Free Software              *
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA       *
+ *************************************************************************************/
+
+#include <QCoreApplication>
+#include <QtTest>
+#include <QObject>
+#include <QSignalSpy>
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+
+#include "../src/backendmanager_p.h"
+#include "../src/getconfigoperation.h"
+#include "../src/setconfigoperation.h"
+#include "../src/confirmconfigoperation.h"
+#include "../src/config.h"
+#include "../src/output.h"
+
+Q_LOGGING_CATEGORY(KSCREEN, "kscreen")
+
+using namespace KScreen;
+
+// What the backend launcher does for its clients, with the Fake backend
+class TestBackendLauncher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TestBackendLauncher(QObject *parent = nullptr);
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void testAsyncShutdown();
+    void testConfigRevert();
+    void testMergedSetConfig();
+};
+
+TestBackendLauncher::TestBackendLauncher(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void TestBackendLauncher::init()
+{
+    qputenv("KSCREEN_LOGGING", "false");
+    qputenv("KSCREEN_BACKEND_INPROCESS", "0");
+    qputenv("KSCREEN_BACKEND", "Fake");
+    qputenv("KSCREEN_BACKEND_ARGS", "TEST_DATA=" TEST_DATA "multipleoutput.json");
+
+    BackendManager::instance()->setMethod(BackendManager::OutOfProcess);
+    BackendManager::instance()->shutdownBackend();
+}
+
+void TestBackendLauncher::cleanup()
+{
+    BackendManager::instance()->shutdownBackend();
+}
+
+void TestBackendLauncher::testAsyncShutdown()
+{
+    auto op = new GetConfigOperation();
+    QVERIFY(op->exec());
+
+    QSignalSpy finishedSpy(BackendManager::instance(), &BackendManager::shutdownFinished);
+    BackendManager::instance()->shutdownBackendAsync();
+    QVERIFY(BackendManager::instance()->isShuttingDown());
+
+    // Requested while the launcher is quitting, served by the next one
+    auto op2 = new GetConfigOperation();
+    QVERIFY(op2->exec());
+    QVERIFY(op2->config());
+    QCOMPARE(finishedSpy.count(), 1);
+    QVERIFY(!BackendManager::instance()->isShuttingDown());
+
+    KScreen::BackendManager::instance()->shutdownBackend();
+    QVERIFY(!QDBusConnection::sessionBus().interface()->isServiceRegistered(QStringLiteral("org.kde.KScreen")));
+    // Nothing to wait for still finishes
+    BackendManager::instance()->shutdownBackendAsync();
+    QVERIFY(finishedSpy.wait(1000));
+}
+
+void TestBackendLauncher::testConfigRevert()
+{
+    auto currentPos = [](int outputId) {
+        auto op = new GetConfigOperation(GetConfigOperation::NoEDID);
+        op->exec();
+        return op->config()->output(outputId)->pos();
+    };
+
+    auto op = new GetConfigOperation(GetConfigOperation::NoEDID);
+    QVERIFY(op->exec());
+    auto config = op->config();
+    auto output = config->outputs().last();
+    const QPoint originalPos = output->pos();
+    const QPoint movedPos = originalPos + QPoint(100, 0);
+
+    // Not confirmed, the launcher reverts on its own
+    output->setPos(movedPos);
+    auto setop = new SetConfigOperation(config);
+    setop->setRevertTimeout(200);
+    QVERIFY(setop->exec());
+    const quint32 transaction = setop->transactionId();
+    QVERIFY(transaction != 0);
+    QCOMPARE(currentPos(output->id()), movedPos);
+    QTRY_COMPARE(currentPos(output->id()), originalPos);
+
+    // Too late to confirm
+    auto lateop = new ConfirmConfigOperation(transaction);
+    QVERIFY(lateop->exec());
+    QVERIFY(!lateop->isConfirmed());
+
+    // Confirmed in time
+    output->setPos(movedPos);
+    setop = new SetConfigOperation(config);
+    setop->setRevertTimeout(200);
+    QVERIFY(setop->exec());
+    QVERIFY(setop->transactionId() != transaction);
+    auto confirmop = new ConfirmConfigOperation(setop->transactionId());
+    QVERIFY(confirmop->exec());
+    QVERIFY(confirmop->isConfirmed());
+    QTest::qWait(400);
+    QCOMPARE(currentPos(output->id()), movedPos);
+
+    // Without a timeout there is nothing to confirm
+    output->setPos(originalPos);
+    setop = new SetConfigOperation(config);
+    QVERIFY(setop->exec());
+    QCOMPARE(setop->transactionId(), quint32(0));
+}
+
+void TestBackendLauncher::testMergedSetConfig()
+{
+    auto op = new GetConfigOperation(GetConfigOperation::NoEDID);
+    QVERIFY(op->exec());
+    auto config = op->config();
+    auto output = config->outputs().last();
+    const QPoint originalPos = output->pos();
+
+    // Sent in a burst, the launcher may merge them, but the last one wins
+    QList<QPoint> results;
+    int errors = 0;
+    for (int i = 1; i <= 5; ++i) {
+        output->setPos(originalPos + QPoint(10 * i, 0));
+        auto setop = new SetConfigOperation(config->clone());
+        connect(setop, &ConfigOperation::finished, this, [&results, &errors, output](ConfigOperation *op) {
+            if (op->hasError() || !op->config()) {
+                ++errors;
+                return;
+            }
+            results << op->config()->output(output->id())->pos();
+        });
+    }
+    QTRY_COMPARE(results.count() + errors, 5);
+    QCOMPARE(errors, 0);
+    QCOMPARE(results.last(), originalPos + QPoint(50, 0));
+
+    auto getop = new GetConfigOperation(GetConfigOperation::NoEDID);
+    QVERIFY(getop->exec());
+    QCOMPARE(getop->config()->output(output->id())->pos(), originalPos + QPoint(50, 0));
+}
+
+QTEST_GUILESS_MAIN(TestBackendLauncher)
+
+#include "testbackendlauncher.moc"
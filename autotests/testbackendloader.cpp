@@ -42,6 +42,7 @@ private Q_SLOTS:
     void testEnv();
     void testEnv_data();
     void testFallback();
+    void testBackendIndex();
 };
 
 TestBackendLoader::TestBackendLoader(QObject *parent)
@@ -104,6 +105,36 @@ void TestBackendLoader::testFallback()
     QVERIFY(preferred.fileName().startsWith("KSC_QScreen"));
 }
 
+void TestBackendLoader::testBackendIndex()
+{
+    const auto index = BackendManager::backendIndex();
+    QCOMPARE(index.count(), BackendManager::listBackends().count());
+
+    bool foundFake = false;
+    bool foundQScreen = false;
+    for (const BackendManager::BackendInfo &info : index) {
+        if (info.name == QLatin1String("Fake")) {
+            foundFake = true;
+            QVERIFY(info.file.fileName().startsWith(QLatin1String("KSC_Fake")));
+            QVERIFY(!info.requiresGui);
+            QVERIFY(info.platforms.isEmpty());
+        } else if (info.name == QLatin1String("QScreen")) {
+            foundQScreen = true;
+            QVERIFY(info.requiresGui);
+            QVERIFY(BackendManager::backendRequiresGui(info.file));
+        }
+    }
+    QVERIFY(foundFake);
+    QVERIFY(foundQScreen);
+
+    // Served from the cache the second time
+    QCOMPARE(BackendManager::backendIndex().count(), index.count());
+
+    // The plugin name in the metadata is matched too
+    qputenv("KSCREEN_BACKEND", QByteArray());
+    QVERIFY(BackendManager::preferredBackend(QStringLiteral("FAKE")).fileName().startsWith(QLatin1String("KSC_Fake")));
+}
+
 QTEST_GUILESS_MAIN(TestBackendLoader)
 
 #include "testbackendloader.moc"
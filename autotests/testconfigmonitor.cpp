@@ -104,6 +104,41 @@ private Q_SLOTS:
         QCOMPARE(spy.size(), 2);
     }
 
+    void testLatencyStatistics()
+    {
+        qputenv("KSCREEN_BACKEND_INPROCESS", "1");
+        KScreen::BackendManager::instance()->shutdownBackend();
+        KScreen::BackendManager::instance()->setMethod(KScreen::BackendManager::InProcess);
+        qputenv("KSCREEN_BACKEND_ARGS", "TEST_DATA=" TEST_DATA "singleoutput.json");
+
+        KScreen::ConfigMonitor *monitor = KScreen::ConfigMonitor::instance();
+        monitor->resetLatencyStatistics();
+        QCOMPARE(monitor->latencyHistogram(KScreen::ConfigMonitor::TotalLatency).size(), 32);
+        QCOMPARE(monitor->lastLatency(KScreen::ConfigMonitor::TotalLatency), qint64(-1));
+        QSignalSpy spy(monitor, SIGNAL(configurationChanged()));
+
+        KScreen::ConfigPtr config = getConfig();
+        monitor->addConfig(config);
+        config->outputs().first()->setEnabled(false);
+        auto setop = new KScreen::SetConfigOperation(config);
+        setop->exec();
+        QTRY_VERIFY(!spy.isEmpty());
+
+        int count = 0;
+        Q_FOREACH (int bucket, monitor->latencyHistogram(KScreen::ConfigMonitor::TotalLatency)) {
+            count += bucket;
+        }
+        QCOMPARE(count, spy.size());
+        QVERIFY(monitor->lastLatency(KScreen::ConfigMonitor::TotalLatency) >= 0);
+        QVERIFY(monitor->lastLatency(KScreen::ConfigMonitor::ClientLatency) >= 0);
+        // No launcher in between
+        QCOMPARE(monitor->lastLatency(KScreen::ConfigMonitor::LauncherLatency), qint64(-1));
+        QCOMPARE(monitor->lastLatency(KScreen::ConfigMonitor::TransportLatency), qint64(-1));
+
+        monitor->resetLatencyStatistics();
+        QCOMPARE(monitor->lastLatency(KScreen::ConfigMonitor::TotalLatency), qint64(-1));
+    }
+
 };
 
 QTEST_MAIN(TestConfigMonitor)
@@ -0,0 +1,144 @@
+/*************************************************************************************
+ *  Copyright 2026 by agent <agent@local>                                            *
+ *                                                                                   *
+ *  This library is free software; you can redistribute it and/or                    *
+ *  modify it under the terms of the GNU Lesser General Public                       *
+ *  License as published by the Free Software Foundation; either                     *
+ *  version 2.1 of the License, or (at your option) any later version.               *
+ *                                                                                   *
+ *  This library is distributed in the hope that it will be useful,                  *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of                   *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU                *
+ *  Lesser General Public License for more details.                                  *
+ *                                                                                   *
+ *  You should have received a copy of the GNU Lesser General Public                 *
+ *  License along with this library; if not, write to the Free Software              *
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA       *
+ *************************************************************************************/
+
+#include <QObject>
+#include <QtTest>
+
+#include "../src/abstractbackend.h"
+#include "../src/backendmanager_p.h"
+#include "../src/config.h"
+#include "../src/configmonitor.h"
+#include "../src/context.h"
+#include "../src/getconfigoperation.h"
+#include "../src/setconfigoperation.h"
+#include "../src/output.h"
+
+using namespace KScreen;
+
+class TestContext : public QObject
+{
+    Q_OBJECT
+
+private:
+    ConfigPtr getConfig(Context *context)
+    {
+        auto op = new GetConfigOperation(context);
+        if (!op->exec()) {
+            qWarning("Failed to retrieve backend: %s", qPrintable(op->errorString()));
+            return ConfigPtr();
+        }
+        return op->config();
+    }
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void testDefaultContext();
+    void testIndependentBackends();
+    void testSetConfigIsolation();
+};
+
+void TestContext::initTestCase()
+{
+    qputenv("KSCREEN_LOGGING", "false");
+    qputenv("KSCREEN_BACKEND_INPROCESS", "1");
+    qputenv("KSCREEN_BACKEND", "Fake");
+    qputenv("KSCREEN_BACKEND_ARGS", "TEST_DATA=" TEST_DATA "singleoutput.json");
+}
+
+void TestContext::testDefaultContext()
+{
+    Context *context = Context::defaultContext();
+    QVERIFY(context);
+    QCOMPARE(Context::defaultContext(), context);
+    QCOMPARE(BackendManager::instance(), context->backendManager());
+    QCOMPARE(ConfigMonitor::instance(), context->configMonitor());
+    QCOMPARE(ConfigMonitor::instance()->context(), context);
+    QCOMPARE(BackendManager::instance()->context(), context);
+
+    // The default context follows the environment
+    QCOMPARE(context->backendManager()->backendName(), QStringLiteral("Fake"));
+    QCOMPARE(context->backendManager()->backendArguments().value(QStringLiteral("TEST_DATA")).toString(),
+             QStringLiteral(TEST_DATA "singleoutput.json"));
+
+    auto op = new GetConfigOperation();
+    QCOMPARE(op->context(), context);
+    QVERIFY(op->exec());
+    QVERIFY(op->config());
+    QCOMPARE(op->config()->outputs().count(), 1);
+    QCOMPARE(context->config(), op->config());
+}
+
+void TestContext::testIndependentBackends()
+{
+    Context single(QStringLiteral("Fake"), {{ QStringLiteral("TEST_DATA"), QStringLiteral(TEST_DATA "singleoutput.json") }});
+    Context multiple(QStringLiteral("Fake"), {{ QStringLiteral("TEST_DATA"), QStringLiteral(TEST_DATA "multipleoutput.json") }});
+    QVERIFY(single.backendManager() != multiple.backendManager());
+    QCOMPARE(single.backendManager()->method(), BackendManager::InProcess);
+
+    const ConfigPtr singleConfig = getConfig(&single);
+    const ConfigPtr multipleConfig = getConfig(&multiple);
+    QVERIFY(singleConfig);
+    QVERIFY(multipleConfig);
+    QCOMPARE(singleConfig->outputs().count(), 1);
+    QCOMPARE(multipleConfig->outputs().count(), 2);
+
+    // Each context caches its own config
+    QCOMPARE(single.config(), singleConfig);
+    QCOMPARE(multiple.config(), multipleConfig);
+
+    // Each context got a backend of its own, even though they come from the
+    // same plugin
+    AbstractBackend *singleBackend = single.backendManager()->loadBackendInProcess(QStringLiteral("Fake"));
+    AbstractBackend *multipleBackend = multiple.backendManager()->loadBackendInProcess(QStringLiteral("Fake"));
+    QVERIFY(singleBackend);
+    QVERIFY(multipleBackend);
+    QVERIFY(singleBackend != multipleBackend);
+
+    // Querying the first context again must not be affected by the second one
+    QCOMPARE(getConfig(&single)->outputs().count(), 1);
+}
+
+void TestContext::testSetConfigIsolation()
+{
+    Context live(QStringLiteral("Fake"), {{ QStringLiteral("TEST_DATA"), QStringLiteral(TEST_DATA "multipleoutput.json") }});
+    Context simulated(QStringLiteral("Fake"), {{ QStringLiteral("TEST_DATA"), QStringLiteral(TEST_DATA "multipleoutput.json") }});
+
+    const ConfigPtr liveConfig = getConfig(&live);
+    QVERIFY(liveConfig);
+    live.configMonitor()->addConfig(liveConfig);
+    QSignalSpy liveSpy(live.configMonitor(), &ConfigMonitor::configurationChanged);
+
+    ConfigPtr candidate = getConfig(&simulated);
+    QVERIFY(candidate);
+    const int outputId = candidate->outputs().firstKey();
+    QVERIFY(candidate->output(outputId)->isEnabled());
+    candidate->output(outputId)->setEnabled(false);
+
+    auto setOp = new SetConfigOperation(&simulated, candidate);
+    QCOMPARE(setOp->context(), &simulated);
+    QVERIFY(setOp->exec());
+
+    QVERIFY(!getConfig(&simulated)->output(outputId)->isEnabled());
+    QVERIFY(getConfig(&live)->output(outputId)->isEnabled());
+    QCOMPARE(liveSpy.count(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestContext)
+
+#include "testcontext.moc"
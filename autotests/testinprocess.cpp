@@ -20,18 +20,24 @@
 #include <QtTest>
 #include <QObject>
 #include <QSignalSpy>
+#include <QThread>
 
 #include "../src/backendmanager_p.h"
 #include "../src/getconfigoperation.h"
 #include "../src/setconfigoperation.h"
+#include "../src/validateconfigoperation.h"
 #include "../src/config.h"
 #include "../src/configmonitor.h"
 #include "../src/output.h"
 #include "../src/mode.h"
 #include "../src/edid.h"
+#include "kscreen_static_backends.h"
 
 Q_LOGGING_CATEGORY(KSCREEN, "kscreen")
 
+// The QScreen backend is linked into the test if there are no plugin files
+KSCREEN_IMPORT_STATIC_BACKENDS
+
 using namespace KScreen;
 
 class TestInProcess : public QObject
@@ -53,6 +59,12 @@ private Q_SLOTS:
 
     void testConfigApply();
     void testConfigMonitor();
+    void testThreadedBackend();
+    void testPhaseTimings();
+    void testValidateConfig();
+    void testIncrementalChanges();
+    void testSetConfigResult();
+    void testBackendInitialization();
 
 private:
 
@@ -311,6 +323,245 @@ void TestInProcess::testConfigMonitor()
     QVERIFY(monitorSpy.wait(500));
 }
 
+void TestInProcess::testThreadedBackend()
+{
+    qputenv("KSCREEN_BACKEND", "Fake");
+
+    KScreen::BackendManager::instance()->shutdownBackend();
+    BackendManager::instance()->setMethod(BackendManager::InProcess);
+    BackendManager::instance()->setThreaded(true);
+    QVERIFY(BackendManager::instance()->isThreaded());
+
+    auto op = new GetConfigOperation();
+    QVERIFY(op->exec());
+    auto config = op->config();
+    QVERIFY(config);
+    QVERIFY(config->isValid());
+    QVERIFY(config->outputs().count());
+
+    auto backend = BackendManager::instance()->loadBackendInProcess(QStringLiteral("Fake"));
+    QVERIFY(backend);
+    QVERIFY(backend->thread() != QThread::currentThread());
+    QVERIFY(backend->config() != config);
+    QCOMPARE(BackendManager::instance()->config(), config);
+
+    QSignalSpy monitorSpy(ConfigMonitor::instance(), &ConfigMonitor::configurationChanged);
+    ConfigMonitor::instance()->addConfig(config);
+
+    auto output = config->outputs().first();
+    output->setCurrentModeId(output->modes().last()->id());
+    auto setop = new SetConfigOperation(config);
+    // The operation completes asynchronously, from the backend thread
+    QVERIFY(setop->exec());
+    QVERIFY(!setop->hasError());
+    QVERIFY(monitorSpy.count() > 0 || monitorSpy.wait(500));
+
+    KScreen::BackendManager::instance()->shutdownBackend();
+    BackendManager::instance()->setThreaded(false);
+}
+
+void TestInProcess::testPhaseTimings()
+{
+    qputenv("KSCREEN_BACKEND", "Fake");
+    KScreen::BackendManager::instance()->shutdownBackend();
+    BackendManager::instance()->setMethod(BackendManager::InProcess);
+
+    auto op = new GetConfigOperation();
+    QVERIFY(op->exec());
+    QVERIFY(op->phaseElapsed(ConfigOperation::Started) >= 0);
+    QVERIFY(op->phaseElapsed(ConfigOperation::BackendReady) >= op->phaseElapsed(ConfigOperation::Started));
+    QVERIFY(op->phaseElapsed(ConfigOperation::RequestSent) >= op->phaseElapsed(ConfigOperation::BackendReady));
+    QVERIFY(op->phaseElapsed(ConfigOperation::ReplyReceived) >= op->phaseElapsed(ConfigOperation::RequestSent));
+    // Nothing to deserialize in-process
+    QCOMPARE(op->phaseElapsed(ConfigOperation::Deserialized), qint64(-1));
+    QVERIFY(op->phaseElapsed(ConfigOperation::EdidsReceived) >= op->phaseElapsed(ConfigOperation::ReplyReceived));
+    QVERIFY(op->phaseElapsed(ConfigOperation::Finished) >= op->phaseElapsed(ConfigOperation::EdidsReceived));
+    auto config = op->config();
+
+    auto setop = new SetConfigOperation(config);
+    QVERIFY(setop->exec());
+    QVERIFY(setop->phaseElapsed(ConfigOperation::ReplyReceived) >= setop->phaseElapsed(ConfigOperation::RequestSent));
+    QCOMPARE(setop->phaseElapsed(ConfigOperation::EdidsReceived), qint64(-1));
+    QVERIFY(setop->phaseElapsed(ConfigOperation::Finished) >= 0);
+
+    BackendManager::instance()->setMethod(BackendManager::OutOfProcess);
+    auto oopop = new GetConfigOperation(GetConfigOperation::NoEDID);
+    QVERIFY(oopop->exec());
+    QVERIFY(oopop->phaseElapsed(ConfigOperation::BackendReady) >= oopop->phaseElapsed(ConfigOperation::Started));
+    QVERIFY(oopop->phaseElapsed(ConfigOperation::Deserialized) >= oopop->phaseElapsed(ConfigOperation::ReplyReceived));
+    QVERIFY(oopop->phaseElapsed(ConfigOperation::ReplyReceived) >= oopop->phaseElapsed(ConfigOperation::RequestSent));
+    QCOMPARE(oopop->phaseElapsed(ConfigOperation::EdidsReceived), qint64(-1));
+    QVERIFY(oopop->phaseElapsed(ConfigOperation::Finished) >= oopop->phaseElapsed(ConfigOperation::Deserialized));
+
+    KScreen::BackendManager::instance()->shutdownBackend();
+    BackendManager::instance()->setMethod(BackendManager::InProcess);
+}
+
+void TestInProcess::testValidateConfig()
+{
+    qputenv("KSCREEN_BACKEND", "Fake");
+    KScreen::BackendManager::instance()->shutdownBackend();
+    BackendManager::instance()->setMethod(BackendManager::InProcess);
+
+    auto op = new GetConfigOperation();
+    QVERIFY(op->exec());
+    auto config = op->config();
+    QCOMPARE(config->outputs().count(), 2);
+
+    auto validop = new ValidateConfigOperation(config);
+    QVERIFY(validop->exec());
+    QVERIFY(validop->isValid());
+    QVERIFY(validop->violations().isEmpty());
+    QCOMPARE(validop->config()->outputs().count(), 2);
+
+    auto first = config->outputs().first();
+    auto second = config->outputs().last();
+    const QString modeId = first->currentModeId();
+    first->setCurrentModeId(QStringLiteral("nonexistent"));
+    auto invalidop = new ValidateConfigOperation(config);
+    QVERIFY(invalidop->exec());
+    QVERIFY(!invalidop->hasError());
+    QVERIFY(!invalidop->isValid());
+    QCOMPARE(invalidop->violations().count(), 1);
+    QCOMPARE(invalidop->violations().first().reason(), ConfigViolation::InvalidMode);
+    QCOMPARE(invalidop->violations().first().outputId(), first->id());
+    first->setCurrentModeId(modeId);
+
+    // Wider than the 8192 pixels the screen supports
+    first->setPos(QPoint(0, 0));
+    second->setPos(QPoint(9000, 0));
+    auto largeop = new ValidateConfigOperation(config);
+    QVERIFY(largeop->exec());
+    QCOMPARE(largeop->violations().count(), 1);
+    QCOMPARE(largeop->violations().first().reason(), ConfigViolation::ScreenTooLarge);
+    QCOMPARE(largeop->violations().first().outputId(), -1);
+    // The config to validate is not modified
+    QCOMPARE(second->pos(), QPoint(9000, 0));
+
+    // Through the backend launcher
+    BackendManager::instance()->setMethod(BackendManager::OutOfProcess);
+    auto oopop = new ValidateConfigOperation(config);
+    QVERIFY(oopop->exec());
+    QVERIFY(!oopop->isValid());
+    QCOMPARE(oopop->violations().count(), 1);
+    QCOMPARE(oopop->violations().first().reason(), ConfigViolation::ScreenTooLarge);
+    QVERIFY(oopop->config());
+    QCOMPARE(oopop->config()->output(second->id())->pos(), QPoint(9000, 0));
+
+    KScreen::BackendManager::instance()->shutdownBackend();
+    BackendManager::instance()->setMethod(BackendManager::InProcess);
+}
+
+void TestInProcess::testIncrementalChanges()
+{
+    qputenv("KSCREEN_BACKEND", "Fake");
+    KScreen::BackendManager::instance()->shutdownBackend();
+    BackendManager::instance()->setMethod(BackendManager::InProcess);
+    // The watched config is a copy of the one of a threaded backend
+    BackendManager::instance()->setThreaded(true);
+
+    auto op = new GetConfigOperation();
+    QVERIFY(op->exec());
+    auto config = op->config();
+    QVERIFY(config);
+    ConfigMonitor::instance()->addConfig(config);
+    auto backend = BackendManager::instance()->loadBackendInProcess(QStringLiteral("Fake"));
+    QVERIFY(backend);
+
+    const OutputPtr output = config->outputs().first();
+    const int outputCount = config->outputs().count();
+    QSignalSpy rotationSpy(output.data(), &Output::rotationChanged);
+    QSignalSpy monitorSpy(ConfigMonitor::instance(), &ConfigMonitor::configurationChanged);
+
+    // Changes of one output update it in place
+    QVERIFY(QMetaObject::invokeMethod(backend, "setRotation", Qt::QueuedConnection,
+                                      Q_ARG(int, output->id()), Q_ARG(int, Output::Left)));
+    QVERIFY(rotationSpy.count() > 0 || rotationSpy.wait(500));
+    QCOMPARE(output->rotation(), Output::Left);
+    QCOMPARE(config->output(output->id()), output);
+    QCOMPARE(config->outputs().count(), outputCount);
+    QTRY_COMPARE(monitorSpy.count(), 1);
+
+    QVERIFY(QMetaObject::invokeMethod(backend, "addOutput", Qt::QueuedConnection,
+                                      Q_ARG(int, 42), Q_ARG(QString, QStringLiteral("DP-42"))));
+    QTRY_COMPARE(monitorSpy.count(), 2);
+    QVERIFY(config->output(42));
+    QCOMPARE(config->output(42)->name(), QStringLiteral("DP-42"));
+    QCOMPARE(config->outputs().count(), outputCount + 1);
+
+    QVERIFY(QMetaObject::invokeMethod(backend, "removeOutput", Qt::QueuedConnection, Q_ARG(int, 42)));
+    QTRY_COMPARE(monitorSpy.count(), 3);
+    QVERIFY(!config->output(42));
+    QCOMPARE(config->outputs().count(), outputCount);
+    QCOMPARE(rotationSpy.count(), 1);
+
+    KScreen::BackendManager::instance()->shutdownBackend();
+    BackendManager::instance()->setThreaded(false);
+}
+
+void TestInProcess::testSetConfigResult()
+{
+    qputenv("KSCREEN_BACKEND", "Fake");
+    Q_FOREACH (BackendManager::Method method, QList<BackendManager::Method>() << BackendManager::InProcess << BackendManager::OutOfProcess) {
+        KScreen::BackendManager::instance()->shutdownBackend();
+        BackendManager::instance()->setMethod(method);
+
+        auto op = new GetConfigOperation(GetConfigOperation::NoEDID);
+        QVERIFY(op->exec());
+        auto config = op->config();
+        auto output = config->outputs().last();
+        const QPoint movedPos = output->pos() + QPoint(100, 0);
+
+        // The operation returns what the backend applied
+        output->setPos(movedPos);
+        auto setop = new SetConfigOperation(config->clone());
+        QVERIFY(setop->exec());
+        QVERIFY(setop->config());
+        QCOMPARE(setop->config()->output(output->id())->pos(), movedPos);
+
+        // and reports when it could not
+        OutputPtr unknown = output->clone();
+        unknown->setId(4242);
+        config->addOutput(unknown);
+        setop = new SetConfigOperation(config);
+        QVERIFY(!setop->exec());
+        QVERIFY(setop->hasError());
+        QVERIFY(setop->errorString().contains(QStringLiteral("4242")));
+    }
+
+    KScreen::BackendManager::instance()->shutdownBackend();
+    BackendManager::instance()->setMethod(BackendManager::InProcess);
+}
+
+void TestInProcess::testBackendInitialization()
+{
+    // Operations wait until the backend has finished initializing
+    qputenv("KSCREEN_BACKEND", "Fake");
+    qputenv("KSCREEN_BACKEND_ARGS", "TEST_DATA=" TEST_DATA "multipleoutput.json;INIT_DELAY=200");
+    Q_FOREACH (BackendManager::Method method, QList<BackendManager::Method>() << BackendManager::InProcess << BackendManager::OutOfProcess) {
+        KScreen::BackendManager::instance()->shutdownBackend();
+        BackendManager::instance()->setMethod(method);
+
+        auto op = new GetConfigOperation(GetConfigOperation::NoEDID);
+        QVERIFY(op->exec());
+        QVERIFY(op->config());
+        QVERIFY(op->config()->isValid());
+        QVERIFY(!op->config()->outputs().isEmpty());
+    }
+
+    // Also when the backend is moved to a thread of its own while initializing
+    KScreen::BackendManager::instance()->shutdownBackend();
+    BackendManager::instance()->setMethod(BackendManager::InProcess);
+    BackendManager::instance()->setThreaded(true);
+    auto op = new GetConfigOperation(GetConfigOperation::NoEDID);
+    QVERIFY(op->exec());
+    QVERIFY(op->config());
+    auto setop = new SetConfigOperation(op->config());
+    QVERIFY(setop->exec());
+
+    KScreen::BackendManager::instance()->shutdownBackend();
+    BackendManager::instance()->setThreaded(false);
+}
 
 QTEST_GUILESS_MAIN(TestInProcess)
 
@@ -29,6 +29,7 @@
 #include "../src/output.h"
 #include "../src/mode.h"
 #include "../src/edid.h"
+#include "kscreen_static_backends.h"
 
 // KWayland
 #include <KWayland/Server/display.h>
@@ -36,7 +37,12 @@
 
 #include "waylandtestserver.h"
 
+#ifndef KSCREEN_STATIC_BACKENDS
+// Otherwise the backend linked into the test defines it
 Q_LOGGING_CATEGORY(KSCREEN_WAYLAND, "kscreen.kwayland")
+#endif
+
+KSCREEN_IMPORT_STATIC_BACKENDS
 
 using namespace KScreen;
 
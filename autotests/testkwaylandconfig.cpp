@@ -29,10 +29,16 @@
 #include "output.h"
 #include "mode.h"
 #include "edid.h"
+#include "kscreen_static_backends.h"
 
 #include "waylandtestserver.h"
 
+#ifndef KSCREEN_STATIC_BACKENDS
+// Otherwise the backend linked into the test defines it
 Q_LOGGING_CATEGORY(KSCREEN_WAYLAND, "kscreen.kwayland")
+#endif
+
+KSCREEN_IMPORT_STATIC_BACKENDS
 
 using namespace KScreen;
 
@@ -53,6 +59,7 @@ private Q_SLOTS:
     void testRotationChange_data();
     void testScaleChange();
     void testModeChange();
+    void testServerSideChanges();
 
 private:
 
@@ -258,8 +265,51 @@ void TestKWaylandConfig::testModeChange()
     QCOMPARE(serverSpy.count(), 1);
 
     QCOMPARE(configSpy.count(), 1);
+
+    // The modes are kept up to date, including which one is current
+    op = new GetConfigOperation();
+    QVERIFY(op->exec());
+    QCOMPARE(op->config()->output(output->id())->currentModeId(), new_mode);
+    QVERIFY(op->config()->output(output->id())->mode(new_mode));
 }
 
+void TestKWaylandConfig::testServerSideChanges()
+{
+    auto op = new GetConfigOperation();
+    QVERIFY(op->exec());
+    auto config = op->config();
+    QVERIFY(config);
+
+    KScreen::ConfigMonitor *monitor = KScreen::ConfigMonitor::instance();
+    monitor->addConfig(config);
+    QSignalSpy configSpy(monitor, &KScreen::ConfigMonitor::configurationChanged);
+
+    // The compositor moves two outputs at once, clients hear about it once
+    const auto serverOutputs = m_server->outputs();
+    QVERIFY(serverOutputs.count() >= 2);
+    QList<QPoint> movedPositions;
+    for (int i = 0; i < 2; ++i) {
+        const QPoint pos = serverOutputs.at(i)->globalPosition() + QPoint(0, 100);
+        serverOutputs.at(i)->setGlobalPosition(pos);
+        movedPositions << pos;
+    }
+
+    QVERIFY(configSpy.wait());
+    QTest::qWait(100);
+    QCOMPARE(configSpy.count(), 1);
+
+    op = new GetConfigOperation();
+    QVERIFY(op->exec());
+    QList<QPoint> positions;
+    Q_FOREACH (const OutputPtr &output, op->config()->outputs()) {
+        positions << output->pos();
+    }
+    Q_FOREACH (const QPoint &pos, movedPositions) {
+        QVERIFY(positions.contains(pos));
+    }
+
+    monitor->removeConfig(config);
+}
 
 QTEST_GUILESS_MAIN(TestKWaylandConfig)
 
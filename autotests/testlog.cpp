@@ -25,6 +25,7 @@
 Q_DECLARE_LOGGING_CATEGORY(KSCREEN_TESTLOG)
 
 Q_LOGGING_CATEGORY(KSCREEN_TESTLOG, "kscreen.testlog")
+Q_LOGGING_CATEGORY(KSCREEN_TESTLOG_RULES, "kscreen.testlog.rules")
 
 using namespace KScreen;
 
@@ -41,6 +42,8 @@ private Q_SLOTS:
     void testContext();
     void testEnabled();
     void testLog();
+    void testRotation();
+    void testLogRules();
 
 private:
     QString m_defaultLogFile;
@@ -110,11 +113,13 @@ void TestLog::testLog()
 
     QString logmsg("This is a log message. ♥");
     Log::log(logmsg);
+    Log::flush();
 
     QVERIFY(lf.exists());
     QVERIFY(lf.remove());
 
     qCDebug(KSCREEN_TESTLOG) << "qCDebug message from testlog";
+    Log::flush();
     QVERIFY(lf.exists());
     QVERIFY(lf.remove());
 
@@ -125,9 +130,11 @@ void TestLog::testLog()
 
     qCDebug(KSCREEN_TESTLOG) << logmsg;
     QCOMPARE(Log::instance()->enabled(), false);
+    Log::flush();
     QVERIFY(!lf.exists());
 
     Log::log(logmsg);
+    Log::flush();
     QVERIFY(!lf.exists());
 
     // Make sure we don't crash on cleanup
@@ -135,6 +142,82 @@ void TestLog::testLog()
     delete Log::instance();
 }
 
+void TestLog::testRotation()
+{
+    qputenv(KSCREEN_LOGGING, QByteArray("true"));
+    qputenv("KSCREEN_LOGFILE_MAXSIZE", QByteArray("1024"));
+    delete Log::instance();
+
+    QFile lf(m_defaultLogFile);
+    QFile rotated(m_defaultLogFile + QStringLiteral(".1"));
+    lf.remove();
+    rotated.remove();
+
+    // Written from the background thread, in order
+    for (int i = 0; i < 100; ++i) {
+        Log::log(QStringLiteral("Message %1").arg(i));
+    }
+    Log::flush();
+    QVERIFY(rotated.exists());
+    QVERIFY(lf.size() < 1024);
+
+    // Messages logged before deleting the log are not lost
+    Log::log(QStringLiteral("Last message"));
+    delete Log::instance();
+
+    QByteArray content;
+    Q_FOREACH (QFile *file, QList<QFile*>() << &rotated << &lf) {
+        QVERIFY(file->open(QIODevice::ReadOnly));
+        content += file->readAll();
+        file->close();
+    }
+    QVERIFY(content.contains("Message 99"));
+    QVERIFY(content.indexOf("Message 98") < content.indexOf("Message 99"));
+    QVERIFY(content.indexOf("Message 99") < content.indexOf("Last message"));
+
+    qunsetenv("KSCREEN_LOGFILE_MAXSIZE");
+    lf.remove();
+    rotated.remove();
+}
+
+void TestLog::testLogRules()
+{
+    qputenv(KSCREEN_LOGGING, QByteArray("true"));
+    delete Log::instance();
+    Log::instance();
+    QCOMPARE(Log::logRules(), QStringLiteral("kscreen.*=debug"));
+    QVERIFY(KSCREEN_TESTLOG().isDebugEnabled());
+    QVERIFY(KSCREEN_TESTLOG_RULES().isDebugEnabled());
+
+    Log::setLogRules(QStringLiteral("kscreen.*=warning; kscreen.testlog.rules=debug"));
+    QVERIFY(!KSCREEN_TESTLOG().isDebugEnabled());
+    QVERIFY(KSCREEN_TESTLOG().isWarningEnabled());
+    QVERIFY(KSCREEN_TESTLOG_RULES().isDebugEnabled());
+
+    // The longest wildcard wins
+    Log::setLogRules(QStringLiteral("kscreen.*=debug,kscreen.testlog*=off"));
+    QVERIFY(!KSCREEN_TESTLOG().isWarningEnabled());
+    QVERIFY(!KSCREEN_TESTLOG_RULES().isCriticalEnabled());
+
+    // Disabled categories don't reach the log file
+    QFile lf(m_defaultLogFile);
+    lf.remove();
+    qCWarning(KSCREEN_TESTLOG) << "filtered message";
+    Log::flush();
+    QVERIFY(!lf.exists());
+
+    Log::setLogRules(QStringLiteral("kscreen.*=critical"));
+    QVERIFY(!KSCREEN_TESTLOG().isWarningEnabled());
+    QVERIFY(KSCREEN_TESTLOG().isCriticalEnabled());
+    qCCritical(KSCREEN_TESTLOG) << "critical message";
+    Log::flush();
+    QVERIFY(lf.exists());
+    QVERIFY(lf.remove());
+
+    Log::setLogRules(QStringLiteral("kscreen.*=debug"));
+    delete Log::instance();
+}
+
 QTEST_MAIN(TestLog)
 
 #include "testlog.moc"
@@ -27,8 +27,14 @@
 #include "../src/edid.h"
 #include "../src/getconfigoperation.h"
 #include "../src/backendmanager_p.h"
+#include "kscreen_static_backends.h"
 
+#ifndef KSCREEN_STATIC_BACKENDS
+// Otherwise the backend linked into the test defines it
 Q_LOGGING_CATEGORY(KSCREEN_QSCREEN, "kscreen.qscreen")
+#endif
+
+KSCREEN_IMPORT_STATIC_BACKENDS
 
 using namespace KScreen;
 
@@ -0,0 +1,126 @@
+/*************************************************************************************
+ *  Copyright 2026 by agent <agent@local>                                            *
+ *                                                                                   *
+ *  This library is free software; you can redistribute it and/or                    *
+ *  modify it under the terms of the GNU Lesser General Public                       *
+ *  License as published by the Free Software Foundation; either                     *
+ *  version 2.1 of the License, or (at your option) any later version.               *
+ *                                                                                   *
+ *  This library is distributed in the hope that it will be useful,                  *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of                   *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU                *
+ *  Lesser General Public License for more details.                                  *
+ *                                                                                   *
+ *  You should have received a copy of the GNU Lesser General Public                 *
+ *  License along with this library; if not, write to the Free Software              *
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA       *
+ *************************************************************************************/
+
+#include <QtTest>
+#include <QObject>
+#include <QTemporaryDir>
+
+#include "../src/tracelog_p.h"
+
+using namespace KScreen;
+
+class TestTraceLog : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testRecords();
+    void testWrapAround();
+    void testConfigDiff();
+
+private:
+    QTemporaryDir m_dir;
+    QString m_fileName;
+};
+
+void TestTraceLog::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_fileName = m_dir.path() + QStringLiteral("/test.trace");
+    // The trace is opened once per process, with the smallest ring
+    qputenv("KSCREEN_TRACE", QFile::encodeName(m_fileName));
+    qputenv("KSCREEN_TRACE_SIZE", "65536");
+    QVERIFY(TraceLog::instance()->isEnabled());
+    QCOMPARE(TraceLog::instance()->fileName(), m_fileName);
+}
+
+void TestTraceLog::testRecords()
+{
+    TraceLog::instance()->record(TraceLog::Message, QStringLiteral("testtracelog"),
+                                 QStringLiteral("context"), QByteArrayLiteral("First message"));
+    TraceLog::instance()->record(TraceLog::Message, QStringLiteral("testtracelog"),
+                                 QString(), QByteArrayLiteral("Second message"));
+
+    QString error;
+    const QVector<TraceLog::Record> records = TraceLog::decode(m_fileName, &error);
+    QVERIFY(error.isEmpty());
+    QCOMPARE(records.count(), 3);
+    QCOMPARE(records[0].event, quint16(TraceLog::Start));
+    QCOMPARE(records[1].event, quint16(TraceLog::Message));
+    QCOMPARE(records[1].category, QStringLiteral("testtracelog"));
+    QCOMPARE(records[1].context, QStringLiteral("context"));
+    QCOMPARE(records[1].payload, QByteArrayLiteral("First message"));
+    QCOMPARE(records[2].context, QString());
+    QCOMPARE(records[2].payload, QByteArrayLiteral("Second message"));
+    QVERIFY(records[1].time <= records[2].time);
+    QVERIFY(records[1].wallTime > 0);
+
+    QVERIFY(TraceLog::toText(records[1]).endsWith(QStringLiteral("testtracelog ; context ; Message : First message")));
+    QCOMPARE(TraceLog::toJson(records[2]).value(QStringLiteral("payload")).toString(), QStringLiteral("Second message"));
+}
+
+void TestTraceLog::testWrapAround()
+{
+    // Write several times the size of the ring
+    const QByteArray payload(100, 'x');
+    for (int i = 0; i < 2000; ++i) {
+        TraceLog::instance()->record(TraceLog::Message, QStringLiteral("wrap"), QString(),
+                                     payload + QByteArray::number(i));
+    }
+
+    QString error;
+    const QVector<TraceLog::Record> records = TraceLog::decode(m_fileName, &error);
+    QVERIFY(error.isEmpty());
+    QVERIFY(records.count() > 100);
+    QVERIFY(records.count() < 2000);
+    // The newest records are kept, in order
+    QCOMPARE(records.last().payload, payload + "1999");
+    for (int i = 1; i < records.count(); ++i) {
+        QVERIFY(records[i - 1].time <= records[i].time);
+        QCOMPARE(records[i].category, QStringLiteral("wrap"));
+    }
+}
+
+void TestTraceLog::testConfigDiff()
+{
+    const QJsonObject before = QJsonDocument::fromJson(
+        "{\"outputs\":[{\"id\":1,\"enabled\":true,\"pos\":{\"x\":0,\"y\":0}},"
+        "{\"id\":2,\"enabled\":true}],\"screen\":{\"id\":0,\"currentSize\":{\"width\":1920,\"height\":1080}}}").object();
+    const QJsonObject after = QJsonDocument::fromJson(
+        "{\"outputs\":[{\"id\":1,\"enabled\":false,\"pos\":{\"x\":0,\"y\":0}},"
+        "{\"id\":3,\"enabled\":true}],\"screen\":{\"id\":0,\"currentSize\":{\"width\":1920,\"height\":1080}}}").object();
+
+    const QJsonObject diff = TraceLog::configDiff(before, after);
+    const QJsonObject outputs = diff.value(QStringLiteral("outputs")).toObject();
+    QCOMPARE(outputs.count(), 3);
+    QCOMPARE(outputs.value(QStringLiteral("1")).toObject(), QJsonObject({{QStringLiteral("enabled"), false}}));
+    QVERIFY(outputs.value(QStringLiteral("2")).isNull());
+    QCOMPARE(outputs.value(QStringLiteral("3")).toObject(), after.value(QStringLiteral("outputs")).toArray()[1].toObject());
+    QVERIFY(!diff.contains(QStringLiteral("screen")));
+    QVERIFY(TraceLog::configDiff(after, after).isEmpty());
+
+    TraceLog::instance()->recordConfig(TraceLog::ConfigChanged, QStringLiteral("diff"), before, after);
+    const QVector<TraceLog::Record> records = TraceLog::decode(m_fileName);
+    QCOMPARE(records.last().event, quint16(TraceLog::ConfigChanged));
+    QCOMPARE(TraceLog::toJson(records.last()).value(QStringLiteral("payload")).toObject(), diff);
+}
+
+QTEST_GUILESS_MAIN(TestTraceLog)
+
+#include "testtracelog.moc"
@@ -22,6 +22,7 @@
 #include "config.h"
 #include "edid.h"
 #include <output.h>
+#include <setconfigresult.h>
 
 #include <stdlib.h>
 
@@ -42,6 +43,7 @@ Q_LOGGING_CATEGORY(KSCREEN_FAKE, "kscreen.fake")
 
 Fake::Fake()
     : KScreen::AbstractBackend()
+    , mReady(true)
 {
     QLoggingCategory::setFilterRules(QStringLiteral("kscreen.fake.debug = true"));
 
@@ -60,6 +62,21 @@ void Fake::init(const QVariantMap &arguments)
     mConfigFile = arguments[QStringLiteral("TEST_DATA")].toString();
     qCDebug(KSCREEN_FAKE) << "Fake profile file:" << mConfigFile;
 
+    // Pretends to wait for the windowing system, like the Wayland backend.
+    // A child timer, so that it moves along to the backend thread
+    const int initDelay = arguments[QStringLiteral("INIT_DELAY")].toInt();
+    mReady = initDelay <= 0;
+    if (!mReady) {
+        QTimer *timer = new QTimer(this);
+        timer->setSingleShot(true);
+        connect(timer, &QTimer::timeout, this, [this, timer]() {
+            timer->deleteLater();
+            mReady = true;
+            Q_EMIT ready();
+        });
+        timer->start(initDelay);
+    }
+
 }
 
 void Fake::delayedInit()
@@ -98,11 +115,32 @@ void Fake::setConfig(const ConfigPtr &config)
     emit configChanged(mConfig);
 }
 
+SetConfigResult *Fake::setConfigAsync(const ConfigPtr &config)
+{
+    // Like real backends, refuse outputs that don't exist
+    const KScreen::OutputList outputs = config ? config->outputs() : KScreen::OutputList();
+    Q_FOREACH (const KScreen::OutputPtr &output, outputs) {
+        if (!this->config()->output(output->id())) {
+            SetConfigResult *result = new SetConfigResult(this);
+            result->setError(QStringLiteral("Unknown output %1").arg(output->id()));
+            result->setConfig(this->config());
+            result->emitResult();
+            return result;
+        }
+    }
+    return AbstractBackend::setConfigAsync(config);
+}
+
 bool Fake::isValid() const
 {
     return true;
 }
 
+bool Fake::isReady() const
+{
+    return mReady;
+}
+
 QByteArray Fake::edid(int outputId) const
 {
     Q_UNUSED(outputId);
@@ -172,7 +210,7 @@ void Fake::setCurrentModeId(int outputId, const QString &modeId)
     }
 
     output->setCurrentModeId(modeId);
-    Q_EMIT configChanged(mConfig);
+    Q_EMIT outputUpdated(output);
 }
 
 void Fake::setRotation(int outputId, int rotation)
@@ -184,7 +222,7 @@ void Fake::setRotation(int outputId, int rotation)
     }
 
     output->setRotation(rot);
-    Q_EMIT configChanged(mConfig);
+    Q_EMIT outputUpdated(output);
 }
 
 void Fake::addOutput(int outputId, const QString &name)
@@ -193,11 +231,11 @@ void Fake::addOutput(int outputId, const QString &name)
     output->setId(outputId);
     output->setName(name);
     mConfig->addOutput(output);
-    Q_EMIT configChanged(mConfig);
+    Q_EMIT outputAdded(output);
 }
 
 void Fake::removeOutput(int outputId)
 {
     mConfig->removeOutput(outputId);
-    Q_EMIT configChanged(mConfig);
+    Q_EMIT outputRemoved(outputId);
 }
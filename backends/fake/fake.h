@@ -27,10 +27,10 @@
 class Fake : public KScreen::AbstractBackend
 {
     Q_OBJECT
-    Q_PLUGIN_METADATA(IID "org.kf5.kscreen.backends.fake")
+    Q_PLUGIN_METADATA(IID "org.kf5.kscreen.backends.fake" FILE "fake.json")
 
 public:
-    explicit Fake();
+    Q_INVOKABLE explicit Fake();
     virtual ~Fake();
 
     void init(const QVariantMap &arguments) Q_DECL_OVERRIDE;
@@ -39,16 +39,19 @@ public:
     QString serviceName() const Q_DECL_OVERRIDE;
     KScreen::ConfigPtr config() const Q_DECL_OVERRIDE;
     void setConfig(const KScreen::ConfigPtr &config) Q_DECL_OVERRIDE;
+    KScreen::SetConfigResult *setConfigAsync(const KScreen::ConfigPtr &config) Q_DECL_OVERRIDE;
     QByteArray edid(int outputId) const Q_DECL_OVERRIDE;
     bool isValid() const Q_DECL_OVERRIDE;
+    bool isReady() const Q_DECL_OVERRIDE;
 
-    void setConnected(int outputId, bool connected);
-    void setEnabled(int outputId, bool enabled);
-    void setPrimary(int outputId, bool primary);
-    void setCurrentModeId(int outputId, const QString &modeId);
-    void setRotation(int outputId, int rotation);
-    void addOutput(int outputId, const QString &name);
-    void removeOutput(int outputId);
+    // Invokable, so that in-process tests can call them on the backend thread
+    Q_INVOKABLE void setConnected(int outputId, bool connected);
+    Q_INVOKABLE void setEnabled(int outputId, bool enabled);
+    Q_INVOKABLE void setPrimary(int outputId, bool primary);
+    Q_INVOKABLE void setCurrentModeId(int outputId, const QString &modeId);
+    Q_INVOKABLE void setRotation(int outputId, int rotation);
+    Q_INVOKABLE void addOutput(int outputId, const QString &name);
+    Q_INVOKABLE void removeOutput(int outputId);
 
 private Q_SLOTS:
     void delayedInit();
@@ -56,6 +59,7 @@ private Q_SLOTS:
 
 private:
     QString mConfigFile;
+    bool mReady;
     mutable KScreen::ConfigPtr mConfig;
 };
 Q_DECLARE_LOGGING_CATEGORY(KSCREEN_FAKE)
@@ -24,6 +24,8 @@
 
 #include <configmonitor.h>
 #include <mode.h>
+#include <setconfigresult.h>
+#include <tracing_p.h>
 
 #include <QSettings>
 #include <QStandardPaths>
@@ -35,15 +37,15 @@ Q_LOGGING_CATEGORY(KSCREEN_WAYLAND, "kscreen.kwayland")
 
 WaylandBackend::WaylandBackend()
     : KScreen::AbstractBackend()
-    , m_isValid(true)
-    , m_config(nullptr)
     , m_internalConfig(new WaylandConfig(this))
 {
     qCDebug(KSCREEN_WAYLAND) << "Loading Wayland backend.";
-    m_internalConfig = new WaylandConfig(this);
-    m_config = m_internalConfig->toKScreenConfig();
     connect(m_internalConfig, &WaylandConfig::configChanged,
             this, &WaylandBackend::emitConfigChanged);
+    // The connection is set up in the background, BackendManager waits
+    // for ready() before asking for the config
+    connect(m_internalConfig, &WaylandConfig::initialized,
+            this, &WaylandBackend::ready);
 }
 
 QString WaylandBackend::name() const
@@ -70,11 +72,54 @@ void WaylandBackend::setConfig(const KScreen::ConfigPtr &newconfig)
     m_internalConfig->applyConfig(newconfig);
 }
 
+SetConfigResult *WaylandBackend::setConfigAsync(const KScreen::ConfigPtr &newconfig)
+{
+    // Finished by the compositor's answer rather than right away
+    SetConfigResult *result = new SetConfigResult(this);
+    if (!newconfig) {
+        result->setError(QStringLiteral("No config to apply"));
+        result->emitResult();
+        return result;
+    }
+    m_internalConfig->applyConfig(newconfig, result);
+    return result;
+}
+
 void WaylandBackend::emitConfigChanged(const KScreen::ConfigPtr &cfg)
 {
+    // The internal config emits right from the Wayland event handlers
+    Tracing::markOrigin(cfg, Tracing::now());
     Q_EMIT configChanged(cfg);
 }
 
+ConfigPtr WaylandBackend::validateConfig(const KScreen::ConfigPtr &config, KScreen::ConfigViolations *violations) const
+{
+    const ConfigPtr normalized = AbstractBackend::validateConfig(config, violations);
+    if (!normalized) {
+        return normalized;
+    }
+
+    // What the compositor rejects in an output configuration
+    bool anyEnabled = false;
+    Q_FOREACH (const OutputPtr &output, normalized->outputs()) {
+        const WaylandOutput *wlOutput = m_internalConfig->outputMap().value(output->id());
+        if (!wlOutput || !output->isEnabled()) {
+            continue;
+        }
+        anyEnabled = true;
+        if (wlOutput->toKWaylandModeId(output->currentModeId()) < 0) {
+            violations->append(ConfigViolation(ConfigViolation::InvalidMode, output->id(),
+                                               QStringLiteral("The compositor has no mode %1 for output %2")
+                                                    .arg(output->currentModeId(), output->name())));
+        }
+    }
+    if (!anyEnabled && !normalized->outputs().isEmpty()) {
+        violations->append(ConfigViolation(ConfigViolation::Rejected, -1,
+                                           QStringLiteral("The compositor does not disable all outputs")));
+    }
+    return normalized;
+}
+
 QByteArray WaylandBackend::edid(int outputId) const
 {
     WaylandOutput *output = m_internalConfig->outputMap().value(outputId);
@@ -86,7 +131,12 @@ QByteArray WaylandBackend::edid(int outputId) const
 
 bool WaylandBackend::isValid() const
 {
-    return m_isValid;
+    return m_internalConfig->isValid();
+}
+
+bool WaylandBackend::isReady() const
+{
+    return m_internalConfig->isInitialized();
 }
 
 void WaylandBackend::updateConfig(ConfigPtr &config)
@@ -32,7 +32,7 @@ class WaylandConfig;
 class WaylandBackend : public KScreen::AbstractBackend
 {
     Q_OBJECT
-    Q_PLUGIN_METADATA(IID "org.kf5.kscreen.backends.kwayland")
+    Q_PLUGIN_METADATA(IID "org.kf5.kscreen.backends.kwayland" FILE "kwayland.json")
 
 public:
     explicit WaylandBackend();
@@ -42,14 +42,16 @@ public:
     QString serviceName() const Q_DECL_OVERRIDE;
     KScreen::ConfigPtr config() const Q_DECL_OVERRIDE;
     void setConfig(const KScreen::ConfigPtr &config) Q_DECL_OVERRIDE;
+    KScreen::SetConfigResult *setConfigAsync(const KScreen::ConfigPtr &config) Q_DECL_OVERRIDE;
     bool isValid() const Q_DECL_OVERRIDE;
+    bool isReady() const Q_DECL_OVERRIDE;
     QByteArray edid(int outputId) const Q_DECL_OVERRIDE;
+    KScreen::ConfigPtr validateConfig(const KScreen::ConfigPtr &config,
+                                      KScreen::ConfigViolations *violations) const Q_DECL_OVERRIDE;
 
     void updateConfig(KScreen::ConfigPtr &config);
 
 private:
-    bool m_isValid;
-    KScreen::ConfigPtr m_config;
     WaylandConfig *m_internalConfig;
     void emitConfigChanged(const KScreen::ConfigPtr &cfg);
 };
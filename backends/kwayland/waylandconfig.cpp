@@ -32,10 +32,12 @@
 
 
 // Qt
+#include <QPointer>
 #include <QTimer>
 
 #include <configmonitor.h>
 #include <mode.h>
+#include <setconfigresult.h>
 
 
 using namespace KScreen;
@@ -43,31 +45,30 @@ using namespace KScreen;
 
 WaylandConfig::WaylandConfig(QObject *parent)
     : QObject(parent)
+    , m_queue(nullptr)
     , m_outputManagement(nullptr)
     , m_registryInitialized(false)
+    , m_connected(false)
+    , m_initialized(false)
+    , m_valid(true)
     , m_blockSignals(true)
+    , m_initializationTimer(new QTimer(this))
     , m_newOutputId(0)
     , m_kscreenConfig(nullptr)
     , m_screen(new WaylandScreen(this))
 {
-    connect(this, &WaylandConfig::initialized, &m_syncLoop, &QEventLoop::quit);
-    QTimer::singleShot(1000, this, [this] {
-        if (m_syncLoop.isRunning()) {
-            qCWarning(KSCREEN_WAYLAND) << "Connection to Wayland server at socket:" << m_connection->socketName() << "timed out.";
-            m_syncLoop.quit();
-            m_thread->quit();
-            m_thread->wait();
-        }
-    });
+    // A child rather than a single shot, so that it moves along when the
+    // backend is moved to a thread of its own
+    m_initializationTimer->setSingleShot(true);
+    m_initializationTimer->setInterval(1000);
+    connect(m_initializationTimer, &QTimer::timeout, this, &WaylandConfig::initializationTimedOut);
+    m_initializationTimer->start();
     initConnection();
-    m_syncLoop.exec();
 }
 
 WaylandConfig::~WaylandConfig()
 {
-    m_thread->quit();
-    m_thread->wait();
-    m_syncLoop.quit();
+    stopThread();
 }
 
 void WaylandConfig::initConnection()
@@ -83,10 +84,9 @@ void WaylandConfig::initConnection()
             this, &WaylandConfig::disconnected, Qt::QueuedConnection);
     connect(m_connection, &KWayland::Client::ConnectionThread::failed, this, [this] {
         qCWarning(KSCREEN_WAYLAND) << "Failed to connect to Wayland server at socket:" << m_connection->socketName();
-        m_syncLoop.quit();
-        m_thread->quit();
-        m_thread->wait();
-    });
+        stopThread();
+        finishInitialization(false);
+    }, Qt::QueuedConnection);
 
     m_thread->start();
     m_connection->moveToThread(m_thread);
@@ -94,6 +94,54 @@ void WaylandConfig::initConnection()
 
 }
 
+void WaylandConfig::stopThread()
+{
+    if (m_thread) {
+        m_thread->quit();
+        m_thread->wait();
+    }
+}
+
+void WaylandConfig::initializationTimedOut()
+{
+    if (m_initialized) {
+        return;
+    }
+    if (!m_connected) {
+        qCWarning(KSCREEN_WAYLAND) << "Connection to Wayland server at socket:" << m_connection->socketName() << "timed out.";
+        stopThread();
+        finishInitialization(false);
+        return;
+    }
+    // The server is just slow, go on with what it announced so far, the
+    // rest comes in as regular changes
+    qCWarning(KSCREEN_WAYLAND) << "Wayland server at socket:" << m_connection->socketName()
+                               << "did not announce all outputs in time.";
+    m_screen->setOutputs(m_outputMap.values());
+    finishInitialization(true);
+}
+
+void WaylandConfig::finishInitialization(bool valid)
+{
+    if (m_initialized) {
+        return;
+    }
+    m_initializationTimer->stop();
+    m_initialized = true;
+    m_valid = valid;
+    Q_EMIT initialized();
+}
+
+bool WaylandConfig::isInitialized() const
+{
+    return m_initialized;
+}
+
+bool WaylandConfig::isValid() const
+{
+    return m_valid;
+}
+
 void WaylandConfig::blockSignals()
 {
     Q_ASSERT(m_blockSignals == false);
@@ -137,6 +185,7 @@ void WaylandConfig::disconnected()
 
 void WaylandConfig::setupRegistry()
 {
+    m_connected = true;
     m_queue = new KWayland::Client::EventQueue(this);
     m_queue->setup(m_connection);
 
@@ -156,9 +205,14 @@ void WaylandConfig::setupRegistry()
 
     connect(m_registry, &KWayland::Client::Registry::interfacesAnnounced,
             this, [this] {
+                const bool late = m_initialized;
                 m_registryInitialized = true;
                 unblockSignals();
                 checkInitialized();
+                // Initialization timed out before, clients still have the partial config
+                if (late) {
+                    Q_EMIT configChanged(toKScreenConfig());
+                }
             }
     );
 
@@ -195,20 +249,63 @@ void WaylandConfig::addOutput(quint32 name, quint32 version)
             m_screen->setOutputs(m_outputMap.values());
             Q_EMIT configChanged(toKScreenConfig());
         }
-        connect(waylandoutput, &WaylandOutput::changed, this, [this]() {
-            if (!m_blockSignals) {
-                Q_EMIT configChanged(toKScreenConfig());
-            }
+        connect(waylandoutput, &WaylandOutput::changed, this, [this, waylandoutput]() {
+            outputChanged(waylandoutput);
         });
     });
 }
 
+void WaylandConfig::outputChanged(WaylandOutput *output)
+{
+    if (m_blockSignals) {
+        // Applying a config, the whole config is emitted once that is done
+        return;
+    }
+    // Every output device reports its changes with its own done event. The
+    // event queue dispatches all events of a server roundtrip in one go, so
+    // emitting from the event loop covers all outputs changed together.
+    if (m_changedOutputs.isEmpty()) {
+        QMetaObject::invokeMethod(this, "emitOutputChanges", Qt::QueuedConnection);
+    }
+    m_changedOutputs.insert(output->id());
+}
+
+void WaylandConfig::emitOutputChanges()
+{
+    const QSet<int> changedOutputs = m_changedOutputs;
+    m_changedOutputs.clear();
+    if (changedOutputs.isEmpty() || m_blockSignals) {
+        return;
+    }
+
+    // Only the changed outputs are converted again, the others are as
+    // clients have seen them last
+    bool known = m_kscreenConfig && m_kscreenConfig->screen();
+    Q_FOREACH (int id, changedOutputs) {
+        known = known && m_outputMap.contains(id) && m_kscreenConfig->output(id);
+    }
+    if (!known) {
+        Q_EMIT configChanged(toKScreenConfig());
+        return;
+    }
+
+    Q_FOREACH (int id, changedOutputs) {
+        KScreen::OutputPtr kscreenOutput = m_kscreenConfig->output(id);
+        m_outputMap.value(id)->updateKScreenOutput(kscreenOutput);
+    }
+    // Positions, sizes and scales make up the screen size
+    m_screen->setOutputs(m_outputMap.values());
+    KScreen::ScreenPtr screen = m_kscreenConfig->screen();
+    m_screen->updateKScreenScreen(screen);
+    Q_EMIT configChanged(m_kscreenConfig);
+}
+
 void WaylandConfig::checkInitialized()
 {
     if (!m_blockSignals && m_registryInitialized &&
         m_initializingOutputs.isEmpty() && m_outputMap.count() && m_outputManagement != nullptr) {
         m_screen->setOutputs(m_outputMap.values());
-        Q_EMIT initialized();
+        finishInitialization(true);
     }
 }
 
@@ -274,9 +371,18 @@ QMap<int, WaylandOutput*> WaylandConfig::outputMap() const
     return m_outputMap;
 }
 
-void WaylandConfig::applyConfig(const KScreen::ConfigPtr &newConfig)
+void WaylandConfig::applyConfig(const KScreen::ConfigPtr &newConfig, KScreen::SetConfigResult *result)
 {
     using namespace KWayland::Client;
+    if (!m_outputManagement) {
+        // The server did not announce it (yet)
+        qCWarning(KSCREEN_WAYLAND) << "Cannot apply config without output management";
+        if (result) {
+            result->setError(QStringLiteral("The compositor does not support output management"));
+            result->emitResult();
+        }
+        return;
+    }
     // Create a new configuration object
     auto wlOutputConfiguration = m_outputManagement->createConfiguration();
 
@@ -320,15 +426,27 @@ void WaylandConfig::applyConfig(const KScreen::ConfigPtr &newConfig)
     // We now block changes in order to compress events while the compositor is doing its thing
     // once it's done or failed, we'll trigger configChanged() only once, and not per individual
     // property change.
-    connect(wlOutputConfiguration, &OutputConfiguration::applied, this, [this, wlOutputConfiguration] {
+    const QPointer<KScreen::SetConfigResult> pendingResult(result);
+    connect(wlOutputConfiguration, &OutputConfiguration::applied, this, [this, wlOutputConfiguration, pendingResult] {
         wlOutputConfiguration->deleteLater();
         unblockSignals();
-        Q_EMIT configChanged(toKScreenConfig());
+        const KScreen::ConfigPtr config = toKScreenConfig();
+        if (pendingResult) {
+            pendingResult->setConfig(config->clone());
+            pendingResult->emitResult();
+        }
+        Q_EMIT configChanged(config);
     });
-    connect(wlOutputConfiguration, &OutputConfiguration::failed, this, [this, wlOutputConfiguration] {
+    connect(wlOutputConfiguration, &OutputConfiguration::failed, this, [this, wlOutputConfiguration, pendingResult] {
         wlOutputConfiguration->deleteLater();
         unblockSignals();
-        Q_EMIT configChanged(toKScreenConfig());
+        const KScreen::ConfigPtr config = toKScreenConfig();
+        if (pendingResult) {
+            pendingResult->setError(QStringLiteral("The compositor failed to apply the configuration"));
+            pendingResult->setConfig(config->clone());
+            pendingResult->emitResult();
+        }
+        Q_EMIT configChanged(config);
     });
     blockSignals();
     // Now ask the compositor to apply the changes
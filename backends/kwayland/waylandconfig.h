@@ -23,13 +23,14 @@
 #include "config.h"
 
 #include <QDir>
-#include <QEventLoop>
 #include <QScreen>
+#include <QSet>
 #include <QSize>
 #include <QThread>
 #include <QLoggingCategory>
 #include <QSocketNotifier>
 
+class QTimer;
 
 namespace KWayland {
     namespace Client {
@@ -44,6 +45,7 @@ namespace KWayland {
 namespace KScreen
 {
 class Output;
+class SetConfigResult;
 class WaylandOutput;
 class WaylandScreen;
 
@@ -55,10 +57,12 @@ class WaylandScreen;
  * configuration out to the "clients" that receive the config from the backend.
  * We initialize a wayland connection, using a threaded event queue when
  * querying the wayland server for data.
- * Initially, the creation of a WaylandConfig blocks until all data has been
- * received, signalled by the initialized() signal. This means that the
- * wayland client has received information about all interfaces, and that all
- * outputs are completely initialized. From then on, we properly notifyUpdate().
+ * The connection is set up asynchronously, initialized() is emitted once all
+ * data has been received. This means that the wayland client has received
+ * information about all interfaces, and that all outputs are completely
+ * initialized. It is also emitted when connecting failed or the server took
+ * too long, isValid() tells whether the config can be used.
+ * From then on, we properly notifyUpdate().
 */
 class WaylandConfig : public QObject
 {
@@ -68,6 +72,16 @@ public:
     explicit WaylandConfig(QObject *parent = nullptr);
     virtual ~WaylandConfig();
 
+    /**
+     * Whether initialized() has been emitted
+     */
+    bool isInitialized() const;
+    /**
+     * Whether the connection to the server works, true until it is known
+     * to have failed
+     */
+    bool isValid() const;
+
     KScreen::ConfigPtr toKScreenConfig();
     void updateKScreenConfig(KScreen::ConfigPtr &config) const;
 
@@ -76,7 +90,13 @@ public:
     void addOutput(quint32 name, quint32 version);
     void removeOutput(quint32 name);
 
-    void applyConfig(const KScreen::ConfigPtr &newConfig);
+    /**
+     * Sends @p newConfig to the compositor
+     *
+     * @p result, if given, is finished once the compositor applied or
+     * rejected the configuration.
+     */
+    void applyConfig(const KScreen::ConfigPtr &newConfig, KScreen::SetConfigResult *result = nullptr);
 
 Q_SIGNALS:
     void configChanged(const KScreen::ConfigPtr &config);
@@ -86,10 +106,15 @@ Q_SIGNALS:
 private Q_SLOTS:
     void setupRegistry();
     void checkInitialized();
+    void initializationTimedOut();
     void disconnected();
+    void emitOutputChanges();
 
 private:
     void initConnection();
+    void finishInitialization(bool valid);
+    void outputChanged(WaylandOutput *output);
+    void stopThread();
     void blockSignals();
     void unblockSignals();
 
@@ -105,10 +130,15 @@ private:
     // key: wayland's name, value: kscreen id
     QMap<int, int> m_outputIds;
     QList<int> m_initializingOutputs;
+    // KScreen ids of the outputs that changed since the last emission
+    QSet<int> m_changedOutputs;
     bool m_registryInitialized;
+    bool m_connected;
+    bool m_initialized;
+    bool m_valid;
     int m_lastOutputId = -1;
     bool m_blockSignals;
-    QEventLoop m_syncLoop;
+    QTimer *m_initializationTimer;
     int m_newOutputId;
     KScreen::ConfigPtr m_kscreenConfig;
     WaylandScreen *m_screen;
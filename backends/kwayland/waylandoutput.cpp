@@ -33,6 +33,7 @@ WaylandOutput::WaylandOutput(quint32 id, WaylandConfig *parent)
     : QObject(parent)
     , m_id(id)
     , m_output(nullptr)
+    , m_complete(false)
 {
     m_rotationMap = {
         {KWayland::Client::OutputDevice::Transform::Normal, KScreen::Output::None},
@@ -59,18 +60,22 @@ KWayland::Client::OutputDevice::Transform WaylandOutput::toKWaylandTransform(con
 
 QString WaylandOutput::toKScreenModeId(int kwaylandmodeid) const
 {
-    if (!m_modeIdMap.values().contains(kwaylandmodeid)) {
-        qCWarning(KSCREEN_WAYLAND) << "Invalid kwayland mode id:" << kwaylandmodeid << m_modeIdMap;
+    const auto it = m_kscreenModeIds.constFind(kwaylandmodeid);
+    if (it == m_kscreenModeIds.constEnd()) {
+        qCWarning(KSCREEN_WAYLAND) << "Invalid kwayland mode id:" << kwaylandmodeid << m_kscreenModeIds;
+        return QStringLiteral("invalid_mode_id");
     }
-    return m_modeIdMap.key(kwaylandmodeid, QStringLiteral("invalid_mode_id"));
+    return it.value();
 }
 
 int WaylandOutput::toKWaylandModeId(const QString &kscreenmodeid) const
 {
-    if (!m_modeIdMap.contains(kscreenmodeid)) {
-        qCWarning(KSCREEN_WAYLAND) << "Invalid kscreen mode id:" << kscreenmodeid << m_modeIdMap;
+    const auto it = m_kwaylandModeIds.constFind(kscreenmodeid);
+    if (it == m_kwaylandModeIds.constEnd()) {
+        qCWarning(KSCREEN_WAYLAND) << "Invalid kscreen mode id:" << kscreenmodeid << m_kwaylandModeIds;
+        return -1;
     }
-    return m_modeIdMap.value(kscreenmodeid, -1);
+    return it.value();
 }
 
 WaylandOutput::~WaylandOutput()
@@ -100,16 +105,47 @@ void WaylandOutput::bindOutputDevice(KWayland::Client::Registry* registry, KWayl
     }
     m_output = op;
 
+    // The server sends done again after every batch of changes, only the
+    // first one completes the output
     connect(m_output, &KWayland::Client::OutputDevice::done, this, [this]() {
+                if (m_complete) {
+                    return;
+                }
+                m_complete = true;
                 Q_EMIT complete();
                 connect(m_output, &KWayland::Client::OutputDevice::changed,
                         this, &WaylandOutput::changed);
 
     });
 
+    // The modes are kept up to date as the server announces them, rather
+    // than converted again on every change of the output
+    connect(m_output, &KWayland::Client::OutputDevice::modeAdded,
+            this, &WaylandOutput::updateMode);
+    connect(m_output, &KWayland::Client::OutputDevice::modeChanged,
+            this, &WaylandOutput::updateMode);
+
     m_output->setup(registry->bindOutputDevice(name, version));
 }
 
+void WaylandOutput::updateMode(const KWayland::Client::OutputDevice::Mode &m)
+{
+    KScreen::ModePtr mode = m_modes.value(m.id);
+    if (!mode) {
+        const QString modeid = QString::number(m.id);
+        mode = KScreen::ModePtr(new KScreen::Mode());
+        mode->setId(modeid);
+        m_modes.insert(m.id, mode);
+        m_modeList.insert(modeid, mode);
+        // Update the kscreen <=> kwayland mode id translation maps
+        m_kscreenModeIds.insert(m.id, modeid);
+        m_kwaylandModeIds.insert(modeid, m.id);
+    }
+    mode->setRefreshRate(m.refreshRate);
+    mode->setSize(m.size);
+    mode->setName(modeName(m));
+}
+
 KScreen::OutputPtr WaylandOutput::toKScreenOutput()
 {
     KScreen::OutputPtr output(new KScreen::Output());
@@ -130,39 +166,17 @@ void WaylandOutput::updateKScreenOutput(KScreen::OutputPtr &output)
     output->setSizeMm(m_output->physicalSize());
     output->setPos(m_output->globalPosition());
     output->setRotation(m_rotationMap[m_output->transform()]);
-    KScreen::ModeList modeList;
-    m_modeIdMap.clear();
-    QString currentModeId = QStringLiteral("-1");
-    Q_FOREACH (const KWayland::Client::OutputDevice::Mode &m, m_output->modes()) {
-        KScreen::ModePtr mode(new KScreen::Mode());
-        const QString modename = modeName(m);
-        QString modeid = QString::number(m.id);
-        if (modeid.isEmpty()) {
-            qCDebug(KSCREEN_WAYLAND) << "Could not create mode id from" << m.id << ", using" << modename << "instead.";
-            modeid = modename;
-        }
-        if (m_modeIdMap.keys().contains(modeid)) {
-            qCWarning(KSCREEN_WAYLAND) << "Mode id already in use:" << modeid;
-        }
-
-        mode->setId(modeid);
-        mode->setRefreshRate(m.refreshRate);
-        mode->setSize(m.size);
-        mode->setName(modename);
-        if (m.flags.testFlag(KWayland::Client::OutputDevice::Mode::Flag::Current)) {
-            currentModeId = modeid;
-        }
-        // Update the kscreen => kwayland mode id translation map
-        m_modeIdMap.insert(modeid, m.id);
-        // Add to the modelist which gets set on the output
-        modeList[modeid] = mode;
-    }
+    const int kwaylandCurrentModeId = m_output->currentMode().id;
+    const QString currentModeId = m_kscreenModeIds.value(kwaylandCurrentModeId, QStringLiteral("-1"));
     if (currentModeId == QLatin1String("-1")) {
-        qCWarning(KSCREEN_WAYLAND) << "Could not find the current mode id" << modeList;
+        qCWarning(KSCREEN_WAYLAND) << "Could not find the current mode id" << kwaylandCurrentModeId << m_modeList;
     }
     output->setCurrentModeId(currentModeId);
 
-    output->setModes(modeList);
+    // The same Mode objects as last time, unless the server added some
+    if (output->modes() != m_modeList) {
+        output->setModes(m_modeList);
+    }
     output->setScale(m_output->scale());
 }
 
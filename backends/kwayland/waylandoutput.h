@@ -27,6 +27,7 @@
 // Own
 #include "waylandconfig.h"
 
+#include <QHash>
 #include <QScreen>
 #include <QSize>
 #include <QLoggingCategory>
@@ -66,21 +67,27 @@ public:
 Q_SIGNALS:
     void complete();
 
-    // only emitted after complete()
+    // only emitted after complete(), once per done event of the output device
     void changed();
 
 private:
     friend WaylandConfig;
     explicit WaylandOutput(quint32 id, WaylandConfig *parent = nullptr);
     void showOutput();
+    void updateMode(const KWayland::Client::OutputDevice::Mode &m);
     QString modeName(const KWayland::Client::OutputDevice::Mode &m) const;
 
     quint32 m_id;
     KWayland::Client::OutputDevice* m_output;
     KWayland::Client::Registry* m_registry;
+    bool m_complete;
 
     QMap<KWayland::Client::OutputDevice::Transform, KScreen::Output::Rotation> m_rotationMap;
-    QMap<QString, int> m_modeIdMap; // left-hand-side: KScreen::Mode, right-hand-side: kwayland's mode.id
+    // The modes by kwayland's mode.id, and the same modes by KScreen::Mode id
+    QHash<int, KScreen::ModePtr> m_modes;
+    KScreen::ModeList m_modeList;
+    QHash<int, QString> m_kscreenModeIds; // kwayland's mode.id => KScreen::Mode id
+    QHash<QString, int> m_kwaylandModeIds; // KScreen::Mode id => kwayland's mode.id
 };
 
 } // namespace
@@ -33,7 +33,7 @@ class QScreenConfig;
 class QScreenBackend : public KScreen::AbstractBackend
 {
     Q_OBJECT
-    Q_PLUGIN_METADATA(IID "org.kf5.kscreen.backends.qscreen")
+    Q_PLUGIN_METADATA(IID "org.kf5.kscreen.backends.qscreen" FILE "qscreen.json")
 
 public:
     explicit QScreenBackend();
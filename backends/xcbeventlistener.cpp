@@ -17,16 +17,131 @@
  *************************************************************************************/
 
 #include "xcbeventlistener.h"
+#include "tracing_p.h"
 
-#include <QX11Info>
-#include <QGuiApplication>
+#include <QThread>
 
 #include <QRect>
 
+#include <cstring>
+
 Q_LOGGING_CATEGORY(KSCREEN_XCB_HELPER, "kscreen.xcb.helper")
 
-XCBEventListener::XCBEventListener():
-    QObject(),
+/*
+ * Blocks on the backend's XCB connection and forwards RandR events to the
+ * listener. Everything that arrives in one go is queued before the listener
+ * is woken up, so bursts of events (hotplug, mode switch, ...) are delivered
+ * to the listener as a single batch.
+ */
+class XCBEventReader : public QThread
+{
+public:
+    explicit XCBEventReader(XCBEventListener *listener)
+        : QThread()
+        , m_listener(listener)
+    {
+    }
+
+    void stop()
+    {
+        m_stopping.store(1);
+
+        // xcb_wait_for_event() has no timeout, wake it up by sending an event
+        // to our own window
+        xcb_client_message_event_t event;
+        memset(&event, 0, sizeof(event));
+        event.response_type = XCB_CLIENT_MESSAGE;
+        event.format = 32;
+        event.window = m_listener->m_window;
+        event.type = XCB_ATOM_NONE;
+        xcb_send_event(m_listener->m_connection, false, m_listener->m_window,
+                       XCB_EVENT_MASK_NO_EVENT, reinterpret_cast<const char*>(&event));
+        xcb_flush(m_listener->m_connection);
+
+        wait();
+    }
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        xcb_connection_t *c = m_listener->m_connection;
+        while (!m_stopping.load()) {
+            xcb_generic_event_t *e = xcb_wait_for_event(c);
+            if (!e) {
+                qCWarning(KSCREEN_XCB_HELPER) << "XCB connection broken, stopping event reader";
+                return;
+            }
+            // Where a change starts for tracing, before any handoff
+            const qint64 time = KScreen::Tracing::now();
+
+            bool wakeUp = false;
+            while (e) {
+                if (m_listener->isRandrEvent(e)) {
+                    wakeUp |= m_listener->m_queue.push(e, time);
+                } else {
+                    free(e);
+                }
+                e = xcb_poll_for_queued_event(c);
+            }
+
+            if (wakeUp) {
+                QMetaObject::invokeMethod(m_listener, "processPendingEvents", Qt::QueuedConnection);
+            }
+        }
+    }
+
+private:
+    XCBEventListener *m_listener;
+    QAtomicInt m_stopping;
+};
+
+
+XCBEventQueue::XCBEventQueue()
+    : m_head(Q_NULLPTR)
+{
+}
+
+XCBEventQueue::~XCBEventQueue()
+{
+    Q_FOREACH (const Entry &entry, takeAll()) {
+        free(entry.event);
+    }
+}
+
+bool XCBEventQueue::push(xcb_generic_event_t *event, qint64 time)
+{
+    Node *node = new Node;
+    node->entry.event = event;
+    node->entry.time = time;
+
+    Node *head;
+    do {
+        head = m_head.loadAcquire();
+        node->next = head;
+    } while (!m_head.testAndSetRelease(head, node));
+
+    return head == Q_NULLPTR;
+}
+
+QVector<XCBEventQueue::Entry> XCBEventQueue::takeAll()
+{
+    // Events are pushed to the front, so the list we take is newest first
+    Node *node = m_head.fetchAndStoreAcquire(Q_NULLPTR);
+
+    QVector<Entry> entries;
+    while (node) {
+        entries.prepend(node->entry);
+        Node *next = node->next;
+        delete node;
+        node = next;
+    }
+
+    return entries;
+}
+
+
+XCBEventListener::XCBEventListener(xcb_connection_t *connection, int screen, QObject *parent):
+    QObject(parent),
     m_isRandrPresent(false),
     m_randrBase(0),
     m_randrErrorBase(0),
@@ -34,9 +149,11 @@ XCBEventListener::XCBEventListener():
     m_eventType(0),
     m_versionMajor(0),
     m_versionMinor(0),
-    m_window(0)
+    m_window(0),
+    m_connection(connection),
+    m_reader(Q_NULLPTR)
 {
-    xcb_connection_t* c = QX11Info::connection();
+    xcb_connection_t* c = m_connection;
     xcb_prefetch_extension_data(c, &xcb_randr_id);
     auto cookie = xcb_randr_query_version(c, XCB_RANDR_MAJOR_VERSION, XCB_RANDR_MINOR_VERSION);
     const auto *queryExtension = xcb_get_extension_data(c, &xcb_randr_id);
@@ -68,7 +185,7 @@ XCBEventListener::XCBEventListener():
     qCDebug(KSCREEN_XCB_HELPER) << "Event Base: " << m_randrBase;
     qCDebug(KSCREEN_XCB_HELPER) << "Event Error: "<< m_randrErrorBase;
 
-    uint32_t rWindow = QX11Info::appRootWindow();
+    uint32_t rWindow = XCB::screenOfDisplay(c, screen)->root;
     m_window = xcb_generate_id(c);
     xcb_create_window(c, XCB_COPY_FROM_PARENT, m_window,
                       rWindow,
@@ -81,14 +198,24 @@ XCBEventListener::XCBEventListener():
             XCB_RANDR_NOTIFY_MASK_CRTC_CHANGE |
             XCB_RANDR_NOTIFY_MASK_OUTPUT_PROPERTY
     );
+    xcb_flush(c);
 
-    qApp->installNativeEventFilter(this);
+    // Events are selected on our own connection, so nobody else is going to
+    // read them for us
+    m_reader = new XCBEventReader(this);
+    m_reader->start();
 }
 
 XCBEventListener::~XCBEventListener()
 {
-    if (m_window && QX11Info::connection()) {
-        xcb_destroy_window(QX11Info::connection(), m_window);
+    if (m_reader) {
+        m_reader->stop();
+        delete m_reader;
+    }
+
+    if (m_window && m_connection) {
+        xcb_destroy_window(m_connection, m_window);
+        xcb_flush(m_connection);
     }
 }
 
@@ -126,26 +253,38 @@ QString XCBEventListener::connectionToString(xcb_randr_connection_t connection)
     return QString("invalid value (%1)").arg(connection);
 }
 
-bool XCBEventListener::nativeEventFilter(const QByteArray& eventType, void* message, long int* result)
+bool XCBEventListener::isRandrEvent(xcb_generic_event_t *e) const
 {
-    Q_UNUSED(result);
+    const uint8_t xEventType = e->response_type & ~0x80;
+    return xEventType == m_randrBase + XCB_RANDR_SCREEN_CHANGE_NOTIFY
+        || xEventType == m_randrBase + XCB_RANDR_NOTIFY;
+}
 
-    if (eventType != "xcb_generic_event_t") {
-        return false;
+void XCBEventListener::processPendingEvents()
+{
+    const QVector<XCBEventQueue::Entry> entries = m_queue.takeAll();
+    if (entries.isEmpty()) {
+        return;
     }
 
-    xcb_generic_event_t* e = static_cast<xcb_generic_event_t *>(message);
+    qCDebug(KSCREEN_XCB_HELPER) << "Processing" << entries.count() << "queued events";
+    Q_EMIT eventsReceived(entries.first().time);
+    Q_FOREACH (const XCBEventQueue::Entry &entry, entries) {
+        handleEvent(entry.event);
+        free(entry.event);
+    }
+}
+
+void XCBEventListener::handleEvent(xcb_generic_event_t *e)
+{
     const uint8_t xEventType = e->response_type & ~0x80;
 
-    //If this event is not xcb_randr_notify, we don't want it
     if (xEventType == m_randrBase + XCB_RANDR_SCREEN_CHANGE_NOTIFY) {
         handleScreenChange(e);
     }
     if (xEventType == m_randrBase + XCB_RANDR_NOTIFY) {
         handleXRandRNotify(e);
     }
-
-    return false;
 }
 
 void XCBEventListener::handleScreenChange(xcb_generic_event_t* e)
@@ -200,8 +339,8 @@ void XCBEventListener::handleXRandRNotify(xcb_generic_event_t* e)
     } else if(randrEvent->subCode == XCB_RANDR_NOTIFY_OUTPUT_PROPERTY) {
         xcb_randr_output_property_t property = randrEvent->u.op;
 
-        XCB::ScopedPointer<xcb_get_atom_name_reply_t> reply(xcb_get_atom_name_reply(QX11Info::connection(),
-                xcb_get_atom_name(QX11Info::connection(), property.atom), NULL));
+        XCB::ScopedPointer<xcb_get_atom_name_reply_t> reply(xcb_get_atom_name_reply(m_connection,
+                xcb_get_atom_name(m_connection, property.atom), NULL));
 
         qCDebug(KSCREEN_XCB_HELPER) << "RRNotify_OutputProperty (ignored)";
         qCDebug(KSCREEN_XCB_HELPER) << "\tOutput: " << property.output;
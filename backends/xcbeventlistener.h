@@ -21,23 +21,57 @@
 
 #include <QObject>
 #include <QLoggingCategory>
-#include <QAbstractNativeEventFilter>
+#include <QAtomicPointer>
+#include <QVector>
 #include <QRect>
 
 #include "xcbwrapper.h"
 
-class XCBEventListener : public QObject,
-                         public QAbstractNativeEventFilter
+class XCBEventReader;
+
+/**
+ * Lock-free queue used to hand events read by the XCBEventReader thread
+ * over to the thread the XCBEventListener lives in. Any number of threads
+ * can push, a single thread takes the queued events out in one batch.
+ */
+class XCBEventQueue
+{
+    public:
+        XCBEventQueue();
+        ~XCBEventQueue();
+
+        struct Entry {
+            xcb_generic_event_t *event;
+            /* Tracing::now() when the reader received the event */
+            qint64 time;
+        };
+
+        /* Returns true when the queue was empty before @p event was added */
+        bool push(xcb_generic_event_t *event, qint64 time);
+        /* Takes all queued events out of the queue, oldest first */
+        QVector<Entry> takeAll();
+
+    private:
+        struct Node {
+            Entry entry;
+            Node *next;
+        };
+        QAtomicPointer<Node> m_head;
+};
+
+class XCBEventListener : public QObject
 {
     Q_OBJECT
 
     public:
-        XCBEventListener();
+        XCBEventListener(xcb_connection_t *connection, int screen, QObject *parent = Q_NULLPTR);
         ~XCBEventListener();
 
-        bool nativeEventFilter(const QByteArray& eventType, void* message, long int* result) Q_DECL_OVERRIDE;
-
     Q_SIGNALS:
+        /* Emitted before the signals of a batch of events, with the
+         * Tracing::now() time the first of them was read from the server */
+        void eventsReceived(qint64 time);
+
         /* Emitted when only XRandR 1.1 or older is available */
         void screenChanged(xcb_randr_rotation_t rotation,
                            const QSize &sizePx,
@@ -55,7 +89,14 @@ class XCBEventListener : public QObject,
                            xcb_randr_connection_t connection);
         void outputPropertyChanged(xcb_randr_output_t output);
 
+    private Q_SLOTS:
+        void processPendingEvents();
+
     private:
+        friend class XCBEventReader;
+
+        bool isRandrEvent(xcb_generic_event_t *e) const;
+        void handleEvent(xcb_generic_event_t *e);
         QString rotationToString(xcb_randr_rotation_t rotation);
         QString connectionToString(xcb_randr_connection_t connection);
         void handleScreenChange(xcb_generic_event_t *e);
@@ -72,6 +113,11 @@ class XCBEventListener : public QObject,
         int m_versionMinor;
 
         uint32_t m_window;
+
+    private:
+        xcb_connection_t *m_connection;
+        XCBEventReader *m_reader;
+        XCBEventQueue m_queue;
 };
 
 Q_DECLARE_LOGGING_CATEGORY(KSCREEN_XCB_HELPER)
@@ -22,22 +22,31 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "xcbwrapper.h"
 
 static xcb_connection_t *sXRandR11XCBConnection = 0;
+static int sXRandR11DefaultScreen = 0;
 
 xcb_connection_t* XCB::connection()
 {
     // Use our own connection to make sure that we won't mess up Qt's connection
     // if something goes wrong on our side.
     if (sXRandR11XCBConnection == 0) {
-        sXRandR11XCBConnection = xcb_connect(0, 0);
+        sXRandR11XCBConnection = xcb_connect(0, &sXRandR11DefaultScreen);
     }
     return sXRandR11XCBConnection;
 }
 
+int XCB::defaultScreen()
+{
+    // The screen number is taken from $DISPLAY when connecting
+    connection();
+    return sXRandR11DefaultScreen;
+}
+
 void XCB::closeConnection()
 {
     if (sXRandR11XCBConnection) {
         xcb_disconnect(sXRandR11XCBConnection);
         sXRandR11XCBConnection = 0;
+        sXRandR11DefaultScreen = 0;
     }
 }
 
@@ -55,13 +64,14 @@ xcb_screen_t* XCB::screenOfDisplay(xcb_connection_t* c, int screen)
 }
 
 
-XCB::GrabServer::GrabServer()
+XCB::GrabServer::GrabServer(xcb_connection_t *c)
+    : m_connection(c)
 {
-    xcb_grab_server(connection());
+    xcb_grab_server(m_connection);
 }
 
 XCB::GrabServer::~GrabServer()
 {
-    xcb_ungrab_server(connection());
-    xcb_flush(connection());
+    xcb_ungrab_server(m_connection);
+    xcb_flush(m_connection);
 }
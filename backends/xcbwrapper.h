@@ -25,7 +25,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <functional>
 #include <type_traits>
 
-#include <QX11Info>
 #include <QScopedPointer>
 
 #include <xcb/xcb.h>
@@ -38,13 +37,17 @@ template<typename T>
 using ScopedPointer = QScopedPointer<T, QScopedPointerPodDeleter>;
 
 xcb_connection_t *connection();
+int defaultScreen();
 void closeConnection();
 xcb_screen_t *screenOfDisplay(xcb_connection_t *c, int screen);
 
 struct GrabServer
 {
-    GrabServer();
+    explicit GrabServer(xcb_connection_t *c);
     ~GrabServer();
+
+private:
+    xcb_connection_t *m_connection;
 };
 
 template <typename Reply,
@@ -58,21 +61,24 @@ class Wrapper
 {
 public:
     Wrapper()
-    : m_retrieved(false)
+    : m_connection(Q_NULLPTR)
+    , m_retrieved(false)
     , m_window(XCB_WINDOW_NONE)
     , m_reply(Q_NULLPTR)
     {
         m_cookie.sequence = 0;
     }
-    explicit Wrapper(const RequestFuncArgs& ... args)
-    : m_retrieved(false)
-    , m_cookie(requestFunc(connection(), args ...))
+    explicit Wrapper(xcb_connection_t *c, const RequestFuncArgs& ... args)
+    : m_connection(c)
+    , m_retrieved(false)
+    , m_cookie(requestFunc(c, args ...))
     , m_window(requestWindow<RequestFuncArgs ...>(args ...))
     , m_reply(Q_NULLPTR)
     {
     }
     explicit Wrapper(const Wrapper &other)
-    : m_retrieved(other.m_retrieved)
+    : m_connection(other.m_connection)
+    , m_retrieved(other.m_retrieved)
     , m_cookie(other.m_cookie)
     , m_window(other.m_window)
     , m_reply(Q_NULLPTR)
@@ -87,6 +93,7 @@ public:
             // if we had managed a reply, free it
             cleanup();
             // copy members
+            m_connection = other.m_connection;
             m_retrieved = other.m_retrieved;
             m_cookie = other.m_cookie;
             m_window = other.m_window;
@@ -142,14 +149,14 @@ protected:
         if (m_retrieved || !m_cookie.sequence) {
             return;
         }
-        m_reply = replyFunc(connection(), m_cookie, NULL);
+        m_reply = replyFunc(m_connection, m_cookie, NULL);
         m_retrieved = true;
     }
 
 private:
     inline void cleanup() {
         if (!m_retrieved && m_cookie.sequence) {
-            xcb_discard_reply(connection(), m_cookie.sequence);
+            xcb_discard_reply(m_connection, m_cookie.sequence);
         } else if (m_reply) {
             free(m_reply);
         }
@@ -170,6 +177,7 @@ private:
                     : static_cast<xcb_window_t>(XCB_WINDOW_NONE);
     }
 
+    xcb_connection_t *m_connection;
     mutable bool m_retrieved;
     Cookie m_cookie;
     xcb_window_t m_window;
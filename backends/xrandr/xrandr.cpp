@@ -25,7 +25,9 @@
 
 #include "config.h"
 #include "output.h"
+#include "screen.h"
 #include "edid.h"
+#include "tracing_p.h"
 
 #include <QtCore/QFile>
 #include <QtCore/qplugin.h>
@@ -34,43 +36,56 @@
 #include <QTimer>
 #include <QTime>
 
-#include <QX11Info>
-#include <QGuiApplication>
-
-xcb_screen_t* XRandR::s_screen = 0;
-xcb_window_t XRandR::s_rootWindow = 0;
-XRandRConfig* XRandR::s_internalConfig = 0;
-int XRandR::s_randrBase = 0;
-int XRandR::s_randrError = 0;
-bool XRandR::s_monitorInitialized = false;
-bool XRandR::s_has_1_3 = false;
-bool XRandR::s_xorgCacheInitialized = false;
-
 using namespace KScreen;
 
 Q_LOGGING_CATEGORY(KSCREEN_XRANDR, "kscreen.xrandr")
 
 XRandR::XRandR()
     : KScreen::AbstractBackend()
+    , m_connection(0)
+    , m_screen(0)
+    , m_rootWindow(0)
+    , m_internalConfig(0)
+    , m_randrBase(0)
+    , m_randrError(0)
+    , m_has_1_3(false)
+    , m_xorgCacheInitialized(false)
     , m_x11Helper(0)
     , m_isValid(false)
     , m_configChangeCompressor(0)
+    , m_changeOrigin(0)
+    , m_eventsTime(0)
+    , m_screenChanged(false)
 {
     qRegisterMetaType<xcb_randr_output_t>("xcb_randr_output_t");
     qRegisterMetaType<xcb_randr_crtc_t>("xcb_randr_crtc_t");
     qRegisterMetaType<xcb_randr_mode_t>("xcb_randr_mode_t");
     qRegisterMetaType<xcb_randr_connection_t>("xcb_randr_connection_t");
     qRegisterMetaType<xcb_randr_rotation_t>("xcb_randr_rotation_t");
+}
+
+void XRandR::init(const QVariantMap &arguments)
+{
+    // Each instance serves a single display, $DISPLAY unless the caller asked
+    // for a specific one. Use our own connection to make sure that we won't
+    // mess up Qt's connection if something goes wrong on our side.
+    const QByteArray display = arguments.value(QStringLiteral("DISPLAY")).toString().toLocal8Bit();
+    int screenNumber = 0;
+    m_connection = xcb_connect(display.isEmpty() ? Q_NULLPTR : display.constData(), &screenNumber);
+    if (xcb_connection_has_error(m_connection)) {
+        qCWarning(KSCREEN_XRANDR) << "Failed to connect to display" << (display.isEmpty() ? qgetenv("DISPLAY") : display);
+        xcb_disconnect(m_connection);
+        m_connection = 0;
+        return;
+    }
 
-    // Use our own connection to make sure that we won't mess up Qt's connection
-    // if something goes wrong on our side.
     xcb_generic_error_t *error = 0;
-    xcb_randr_query_version_reply_t* version;
-    XCB::connection();
-    version = xcb_randr_query_version_reply(XCB::connection(), xcb_randr_query_version(XCB::connection(), XCB_RANDR_MAJOR_VERSION, XCB_RANDR_MINOR_VERSION), &error);
+    XCB::ScopedPointer<xcb_randr_query_version_reply_t> version(xcb_randr_query_version_reply(m_connection,
+            xcb_randr_query_version(m_connection, XCB_RANDR_MAJOR_VERSION, XCB_RANDR_MINOR_VERSION), &error));
 
     if (!version || error) {
-        XCB::closeConnection();
+        xcb_disconnect(m_connection);
+        m_connection = 0;
         free(error);
         return;
     }
@@ -78,55 +93,56 @@ XRandR::XRandR()
     if ((version->major_version > 1) || ((version->major_version == 1) && (version->minor_version >= 2))) {
         m_isValid = true;
     } else {
-        XCB::closeConnection();
+        xcb_disconnect(m_connection);
+        m_connection = 0;
         qCWarning(KSCREEN_XRANDR) << "XRandR extension not available or unsupported version";
         return;
     }
 
-    if (s_screen == 0) {
-        s_screen = XCB::screenOfDisplay(XCB::connection(), QX11Info::appScreen());
-        s_rootWindow = s_screen->root;
-
-        xcb_prefetch_extension_data(XCB::connection(), &xcb_randr_id);
-        auto  reply = xcb_get_extension_data(XCB::connection(), &xcb_randr_id);
-        s_randrBase = reply->first_event;
-        s_randrError = reply->first_error;
-    }
-
-    XRandR::s_has_1_3 = (version->major_version > 1 || (version->major_version == 1 && version->minor_version >= 3));
-
-    if (s_internalConfig == 0) {
-        s_internalConfig = new XRandRConfig();
-    }
-
-    if (!s_monitorInitialized) {
-        m_x11Helper = new XCBEventListener();
-        connect(m_x11Helper, &XCBEventListener::outputChanged,
-                this, &XRandR::outputChanged,
-                Qt::QueuedConnection);
-        connect(m_x11Helper, &XCBEventListener::crtcChanged,
-                this, &XRandR::crtcChanged,
-                Qt::QueuedConnection);
-        connect(m_x11Helper, &XCBEventListener::screenChanged,
-                this, &XRandR::screenChanged,
-                Qt::QueuedConnection);
-
-        m_configChangeCompressor = new QTimer(this);
-        m_configChangeCompressor->setSingleShot(true);
-        m_configChangeCompressor->setInterval(500);
-        connect(m_configChangeCompressor, &QTimer::timeout,
-                [&]() {
-                    qCDebug(KSCREEN_XRANDR) << "Emitting configChanged()";
-                    Q_EMIT configChanged(config());
-                });
-
-        s_monitorInitialized = true;
-    }
+    m_screen = XCB::screenOfDisplay(m_connection, screenNumber);
+    m_rootWindow = m_screen->root;
+
+    xcb_prefetch_extension_data(m_connection, &xcb_randr_id);
+    auto reply = xcb_get_extension_data(m_connection, &xcb_randr_id);
+    m_randrBase = reply->first_event;
+    m_randrError = reply->first_error;
+
+    m_has_1_3 = (version->major_version > 1 || (version->major_version == 1 && version->minor_version >= 3));
+
+    m_internalConfig = new XRandRConfig(this);
+
+    // Parented, so that they follow the backend when it is moved to a thread
+    m_x11Helper = new XCBEventListener(m_connection, screenNumber, this);
+    // Queued like the events themselves, so it arrives right before them
+    connect(m_x11Helper, &XCBEventListener::eventsReceived,
+            this, &XRandR::eventsReceived,
+            Qt::QueuedConnection);
+    connect(m_x11Helper, &XCBEventListener::outputChanged,
+            this, &XRandR::outputChanged,
+            Qt::QueuedConnection);
+    connect(m_x11Helper, &XCBEventListener::crtcChanged,
+            this, &XRandR::crtcChanged,
+            Qt::QueuedConnection);
+    connect(m_x11Helper, &XCBEventListener::screenChanged,
+            this, &XRandR::screenChanged,
+            Qt::QueuedConnection);
+
+    m_configChangeCompressor = new QTimer(this);
+    m_configChangeCompressor->setSingleShot(true);
+    m_configChangeCompressor->setInterval(500);
+    connect(m_configChangeCompressor, &QTimer::timeout,
+            this, &XRandR::emitChanges);
 }
 
 XRandR::~XRandR()
 {
+    // The event listener and the internal config still talk to the X server,
+    // so they have to go before the connection
     delete m_x11Helper;
+    delete m_internalConfig;
+    if (m_connection) {
+        xcb_disconnect(m_connection);
+    }
 }
 
 QString XRandR::name() const
@@ -143,43 +159,60 @@ QString XRandR::serviceName() const
 void XRandR::outputChanged(xcb_randr_output_t output, xcb_randr_crtc_t crtc,
                            xcb_randr_mode_t mode, xcb_randr_connection_t connection)
 {
-    XRandROutput *xOutput = s_internalConfig->output(output);
-    XCB::PrimaryOutput primary(XRandR::rootWindow());
+    XRandROutput *xOutput = m_internalConfig->output(output);
+    XCB::PrimaryOutput primary(m_connection, m_rootWindow);
     if (!xOutput) {
-        s_internalConfig->addNewOutput(output);
+        m_internalConfig->addNewOutput(output);
+        if (m_internalConfig->output(output)) {
+            m_removedOutputs.remove(output);
+            m_addedOutputs.insert(output);
+        }
     } else {
         switch (crtc == XCB_NONE && mode == XCB_NONE && connection == XCB_RANDR_CONNECTION_DISCONNECTED) {
         case true: {
-            XCB::OutputInfo info(output, XCB_TIME_CURRENT_TIME);
+            XCB::OutputInfo info(m_connection, output, XCB_TIME_CURRENT_TIME);
             if (info.isNull()) {
-                s_internalConfig->removeOutput(output);
+                m_internalConfig->removeOutput(output);
                 qCDebug(KSCREEN_XRANDR) << "Output" << output << " removed";
+                // Clients never learnt about an output added since the last
+                // emission
+                if (!m_addedOutputs.remove(output)) {
+                    m_removedOutputs.insert(output);
+                }
+                m_changedOutputs.remove(output);
                 break;
             }
             // info is valid: fall-through
         }
         case false: {
             xOutput->update(crtc, mode, connection, (primary->output == output));
+            m_changedOutputs.insert(output);
             qCDebug(KSCREEN_XRANDR) << "Output" << xOutput->id() << ": connected =" << xOutput->isConnected() << ", enabled =" << xOutput->isEnabled();
             break;
         }
         } // switch
     }
 
-    m_configChangeCompressor->start();
+    scheduleConfigChange();
 }
 
 void XRandR::crtcChanged(xcb_randr_crtc_t crtc, xcb_randr_mode_t mode,
                          xcb_randr_rotation_t rotation, const QRect& geom)
 {
-    XRandRCrtc *xCrtc = s_internalConfig->crtc(crtc);
+    XRandRCrtc *xCrtc = m_internalConfig->crtc(crtc);
     if (!xCrtc) {
-        s_internalConfig->addNewCrtc(crtc);
+        m_internalConfig->addNewCrtc(crtc);
     } else {
         xCrtc->update(mode, rotation, geom);
+        // The outputs take their position and rotation from the CRTC
+        Q_FOREACH (xcb_randr_output_t output, xCrtc->outputs()) {
+            if (m_internalConfig->output(output)) {
+                m_changedOutputs.insert(output);
+            }
+        }
     }
 
-    m_configChangeCompressor->start();
+    scheduleConfigChange();
 }
 
 void XRandR::screenChanged(xcb_randr_rotation_t rotation,
@@ -192,33 +225,99 @@ void XRandR::screenChanged(xcb_randr_rotation_t rotation,
         newSizePx.transpose();
     }
 
-    XRandRScreen *xScreen = s_internalConfig->screen();
+    XRandRScreen *xScreen = m_internalConfig->screen();
     Q_ASSERT(xScreen);
     xScreen->update(newSizePx);
+    m_screenChanged = true;
+
+    scheduleConfigChange();
+}
+
+void XRandR::eventsReceived(qint64 time)
+{
+    m_eventsTime = time;
+}
 
+void XRandR::scheduleConfigChange()
+{
+    // The first event of a burst is where the change started, as read by
+    // the event reader thread
+    if (!m_configChangeCompressor->isActive()) {
+        m_changeOrigin = m_eventsTime > 0 ? m_eventsTime : KScreen::Tracing::now();
+    }
     m_configChangeCompressor->start();
 }
 
+void XRandR::emitChanges()
+{
+    // Only the outputs and the screen that changed are converted, building
+    // the whole config for every event burst is what clients used to wait for
+    qCDebug(KSCREEN_XRANDR) << "Emitting changes of outputs" << m_addedOutputs << m_changedOutputs
+                            << "removed" << m_removedOutputs << "screen" << m_screenChanged;
+    Q_FOREACH (xcb_randr_output_t output, m_removedOutputs) {
+        Q_EMIT outputRemoved(output);
+    }
+    Q_FOREACH (xcb_randr_output_t output, m_addedOutputs) {
+        if (const XRandROutput *xOutput = m_internalConfig->output(output)) {
+            const KScreen::OutputPtr kscreenOutput = xOutput->toKScreenOutput();
+            KScreen::Tracing::markOrigin(kscreenOutput.data(), m_changeOrigin);
+            Q_EMIT outputAdded(kscreenOutput);
+        }
+    }
+    Q_FOREACH (xcb_randr_output_t output, m_changedOutputs) {
+        const XRandROutput *xOutput = m_internalConfig->output(output);
+        if (xOutput && !m_addedOutputs.contains(output)) {
+            const KScreen::OutputPtr kscreenOutput = xOutput->toKScreenOutput();
+            KScreen::Tracing::markOrigin(kscreenOutput.data(), m_changeOrigin);
+            Q_EMIT outputUpdated(kscreenOutput);
+        }
+    }
+    if (m_screenChanged) {
+        const KScreen::ScreenPtr kscreenScreen = m_internalConfig->screen()->toKScreenScreen();
+        KScreen::Tracing::markOrigin(kscreenScreen.data(), m_changeOrigin);
+        Q_EMIT screenUpdated(kscreenScreen);
+    }
+
+    m_addedOutputs.clear();
+    m_changedOutputs.clear();
+    m_removedOutputs.clear();
+    m_screenChanged = false;
+}
 
 ConfigPtr XRandR::config() const
 {
-    return s_internalConfig->toKScreenConfig();
+    if (!m_internalConfig) {
+        return ConfigPtr();
+    }
+    return m_internalConfig->toKScreenConfig();
 }
 
 void XRandR::setConfig(const ConfigPtr &config)
 {
-    if (!config) {
+    if (!config || !m_internalConfig) {
         return;
     }
 
     qCDebug(KSCREEN_XRANDR) << "XRandR::setConfig";
-    s_internalConfig->applyKScreenConfig(config);
+    m_internalConfig->applyKScreenConfig(config);
     qCDebug(KSCREEN_XRANDR) << "XRandR::setConfig done!";
 }
 
+ConfigPtr XRandR::validateConfig(const ConfigPtr &config, KScreen::ConfigViolations *violations) const
+{
+    const ConfigPtr normalized = AbstractBackend::validateConfig(config, violations);
+    if (normalized && m_internalConfig) {
+        m_internalConfig->validateKScreenConfig(normalized, violations);
+    }
+    return normalized;
+}
+
 QByteArray XRandR::edid(int outputId) const
 {
-    const XRandROutput *output = s_internalConfig->output(outputId);
+    if (!m_internalConfig) {
+        return QByteArray();
+    }
+    const XRandROutput *output = m_internalConfig->output(outputId);
     if (!output) {
         return QByteArray();
     }
@@ -231,14 +330,14 @@ bool XRandR::isValid() const
     return m_isValid;
 }
 
-quint8* XRandR::getXProperty(xcb_randr_output_t output, xcb_atom_t atom, size_t &len)
+quint8* XRandR::getXProperty(xcb_randr_output_t output, xcb_atom_t atom, size_t &len) const
 {
     quint8 *result;
 
-    auto cookie = xcb_randr_get_output_property(XCB::connection(), output, atom,
+    auto cookie = xcb_randr_get_output_property(m_connection, output, atom,
                                                 XCB_ATOM_ANY,
                                                 0, 100, false, false);
-    auto reply = xcb_randr_get_output_property_reply(XCB::connection(), cookie, NULL);
+    auto reply = xcb_randr_get_output_property_reply(m_connection, cookie, NULL);
     if (reply->type == XCB_ATOM_INTEGER && reply->format == 8) {
         result = new quint8[reply->num_items];
         memcpy(result, xcb_randr_get_output_property_data(reply), reply->num_items);
@@ -251,19 +350,19 @@ quint8* XRandR::getXProperty(xcb_randr_output_t output, xcb_atom_t atom, size_t
     return result;
 }
 
-quint8 *XRandR::outputEdid(xcb_randr_output_t outputId, size_t &len)
+quint8 *XRandR::outputEdid(xcb_randr_output_t outputId, size_t &len) const
 {
     quint8 *result;
 
-    auto edid_atom = XCB::InternAtom(false, 4, "EDID")->atom;
-    result = XRandR::getXProperty(outputId, edid_atom, len);
+    auto edid_atom = XCB::InternAtom(m_connection, false, 4, "EDID")->atom;
+    result = getXProperty(outputId, edid_atom, len);
     if (result == NULL) {
-        auto edid_atom = XCB::InternAtom(false, 9, "EDID_DATA")->atom;
-        result = XRandR::getXProperty(outputId, edid_atom, len);
+        auto edid_atom = XCB::InternAtom(m_connection, false, 9, "EDID_DATA")->atom;
+        result = getXProperty(outputId, edid_atom, len);
     }
     if (result == NULL) {
-        auto edid_atom = XCB::InternAtom(false, 25, "XFree86_DDC_EDID1_RAWDATA")->atom;
-        result = XRandR::getXProperty(outputId, edid_atom, len);
+        auto edid_atom = XCB::InternAtom(m_connection, false, 25, "XFree86_DDC_EDID1_RAWDATA")->atom;
+        result = getXProperty(outputId, edid_atom, len);
     }
 
     if (result) {
@@ -278,35 +377,40 @@ quint8 *XRandR::outputEdid(xcb_randr_output_t outputId, size_t &len)
     return 0;
 }
 
-xcb_randr_get_screen_resources_reply_t* XRandR::screenResources()
+xcb_randr_get_screen_resources_reply_t* XRandR::screenResources() const
 {
-    if (XRandR::s_has_1_3) {
-        if (XRandR::s_xorgCacheInitialized) {
+    if (m_has_1_3) {
+        if (m_xorgCacheInitialized) {
             // HACK: This abuses the fact that xcb_randr_get_screen_resources_reply_t
             // and xcb_randr_get_screen_resources_current_reply_t are the same
             return reinterpret_cast<xcb_randr_get_screen_resources_reply_t*>(
-                xcb_randr_get_screen_resources_current_reply(XCB::connection(),
-                    xcb_randr_get_screen_resources_current(XCB::connection(), XRandR::rootWindow()),
+                xcb_randr_get_screen_resources_current_reply(m_connection,
+                    xcb_randr_get_screen_resources_current(m_connection, m_rootWindow),
                     NULL));
         } else {
             /* XRRGetScreenResourcesCurrent is faster then XRRGetScreenResources
              * because it returns cached values. However the cached values are not
              * available until someone calls XRRGetScreenResources first. In case
              * we happen to be the first ones, we need to fill the cache first. */
-            XRandR::s_xorgCacheInitialized = true;
+            m_xorgCacheInitialized = true;
         }
     }
 
-    return xcb_randr_get_screen_resources_reply(XCB::connection(),
-        xcb_randr_get_screen_resources(XCB::connection(), XRandR::rootWindow()), NULL);
+    return xcb_randr_get_screen_resources_reply(m_connection,
+        xcb_randr_get_screen_resources(m_connection, m_rootWindow), NULL);
+}
+
+xcb_connection_t* XRandR::connection() const
+{
+    return m_connection;
 }
 
-xcb_window_t XRandR::rootWindow()
+xcb_window_t XRandR::rootWindow() const
 {
-    return s_rootWindow;
+    return m_rootWindow;
 }
 
-xcb_screen_t* XRandR::screen()
+xcb_screen_t* XRandR::screen() const
 {
-    return s_screen;
+    return m_screen;
 }
@@ -22,6 +22,7 @@
 
 #include "abstractbackend.h"
 
+#include <QtCore/QSet>
 #include <QtCore/QSize>
 #include <QLoggingCategory>
 
@@ -39,23 +40,28 @@ namespace KScreen {
 class XRandR : public KScreen::AbstractBackend
 {
     Q_OBJECT
-    Q_PLUGIN_METADATA(IID "org.kf5.kscreen.backends.xrandr")
+    Q_PLUGIN_METADATA(IID "org.kf5.kscreen.backends.xrandr" FILE "xrandr.json")
 
     public:
-        explicit XRandR();
+        // Invokable, so that the launcher can create one instance per display
+        Q_INVOKABLE explicit XRandR();
         virtual ~XRandR();
 
+        void init(const QVariantMap &arguments) Q_DECL_OVERRIDE;
         QString name() const Q_DECL_OVERRIDE;
         QString serviceName() const Q_DECL_OVERRIDE;
         KScreen::ConfigPtr config() const Q_DECL_OVERRIDE;
         void setConfig(const KScreen::ConfigPtr &config) Q_DECL_OVERRIDE;
         bool isValid() const Q_DECL_OVERRIDE;
         QByteArray edid(int outputId) const Q_DECL_OVERRIDE;
+        KScreen::ConfigPtr validateConfig(const KScreen::ConfigPtr &config,
+                                          KScreen::ConfigViolations *violations) const Q_DECL_OVERRIDE;
 
-        static quint8 *outputEdid(xcb_randr_output_t outputId, size_t &len);
-        static xcb_randr_get_screen_resources_reply_t* screenResources();
-        static xcb_screen_t* screen();
-        static xcb_window_t rootWindow();
+        quint8 *outputEdid(xcb_randr_output_t outputId, size_t &len) const;
+        xcb_randr_get_screen_resources_reply_t* screenResources() const;
+        xcb_connection_t* connection() const;
+        xcb_screen_t* screen() const;
+        xcb_window_t rootWindow() const;
 
     private Q_SLOTS:
         void outputChanged(xcb_randr_output_t output,
@@ -69,25 +75,38 @@ class XRandR : public KScreen::AbstractBackend
         void screenChanged(xcb_randr_rotation_t rotation,
                            const QSize &sizePx,
                            const QSize &sizeMm);
+        void eventsReceived(qint64 time);
 
     private:
-        static quint8* getXProperty(xcb_randr_output_t output,
-                                    xcb_atom_t atom,
-                                    size_t &len);
-
-        static xcb_screen_t *s_screen;
-        static xcb_window_t s_rootWindow;
-        static XRandRConfig *s_internalConfig;
-        static int s_randrBase;
-        static int s_randrError;
-        static bool s_monitorInitialized;
-        static bool s_has_1_3;
-        static bool s_xorgCacheInitialized;
+        void scheduleConfigChange();
+        void emitChanges();
+
+        quint8* getXProperty(xcb_randr_output_t output,
+                             xcb_atom_t atom,
+                             size_t &len) const;
+
+        xcb_connection_t *m_connection;
+        xcb_screen_t *m_screen;
+        xcb_window_t m_rootWindow;
+        XRandRConfig *m_internalConfig;
+        int m_randrBase;
+        int m_randrError;
+        bool m_has_1_3;
+        mutable bool m_xorgCacheInitialized;
 
         XCBEventListener *m_x11Helper;
         bool m_isValid;
 
         QTimer *m_configChangeCompressor;
+        qint64 m_changeOrigin;
+        // When the event reader got the batch being handled
+        qint64 m_eventsTime;
+        // Changes collected by the compressor, announced one by one instead
+        // of building the whole config
+        QSet<xcb_randr_output_t> m_addedOutputs;
+        QSet<xcb_randr_output_t> m_changedOutputs;
+        QSet<xcb_randr_output_t> m_removedOutputs;
+        bool m_screenChanged;
 };
 
 Q_DECLARE_LOGGING_CATEGORY(KSCREEN_XRANDR)
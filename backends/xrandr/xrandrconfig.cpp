@@ -26,22 +26,23 @@
 #include "config.h"
 #include "output.h"
 #include "edid.h"
+#include "usdt_p.h"
 
 #include "../xcbwrapper.h"
 
-#include <QX11Info>
 #include <QRect>
 #include <QScopedPointer>
 
 using namespace KScreen;
 
-XRandRConfig::XRandRConfig()
-    : QObject()
+XRandRConfig::XRandRConfig(XRandR *backend)
+    : QObject(backend)
+    , m_backend(backend)
     , m_screen(Q_NULLPTR)
 {
     m_screen = new XRandRScreen(this);
 
-    XCB::ScopedPointer<xcb_randr_get_screen_resources_reply_t> resources(XRandR::screenResources());
+    XCB::ScopedPointer<xcb_randr_get_screen_resources_reply_t> resources(m_backend->screenResources());
     xcb_randr_crtc_t *crtcs = xcb_randr_get_screen_resources_crtcs(resources.data());
     for (int i = 0, c = xcb_randr_get_screen_resources_crtcs_length(resources.data()); i < c; ++i) {
         addNewCrtc(crtcs[i]);
@@ -60,6 +61,11 @@ XRandRConfig::~XRandRConfig()
     delete m_screen;
 }
 
+XRandR* XRandRConfig::backend() const
+{
+    return m_backend;
+}
+
 XRandROutput::Map XRandRConfig::outputs() const
 {
     return m_outputs;
@@ -122,6 +128,7 @@ KScreen::ConfigPtr XRandRConfig::toKScreenConfig() const
 void XRandRConfig::applyKScreenConfig(const KScreen::ConfigPtr &config)
 {
     const KScreen::OutputList kscreenOutputs = config->outputs();
+    KSCREEN_PROBE1(xrandr_apply_entry, kscreenOutputs.count());
     const QSize newScreenSize = screenSize(config);
     const QSize currentScreenSize = m_screen->currentSize();
     // When the current screen configuration is bigger than the new size (like
@@ -218,13 +225,15 @@ void XRandRConfig::applyKScreenConfig(const KScreen::ConfigPtr &config)
     if (newScreenSize.width() > kscreenScreen->maxSize().width() ||
         newScreenSize.height() > kscreenScreen->maxSize().height()) {
         qCDebug(KSCREEN_XRANDR) << "The new screen size is too big - requested: " << newScreenSize << ", maximum: " << kscreenScreen->maxSize();
+        KSCREEN_PROBE1(xrandr_apply_return, -1);
         return;
     }
 
     qCDebug(KSCREEN_XRANDR) << "Needed CRTCs: " << neededCrtcs;
-    XCB::ScopedPointer<xcb_randr_get_screen_resources_reply_t> screenResources(XRandR::screenResources());
+    XCB::ScopedPointer<xcb_randr_get_screen_resources_reply_t> screenResources(m_backend->screenResources());
     if (neededCrtcs > screenResources->num_crtcs) {
         qCDebug(KSCREEN_XRANDR) << "We need more CRTCs than we have available - requested: " << neededCrtcs << ", available: " << screenResources->num_crtcs;
+            KSCREEN_PROBE1(xrandr_apply_return, -1);
             return;
     }
 
@@ -255,19 +264,22 @@ void XRandRConfig::applyKScreenConfig(const KScreen::ConfigPtr &config)
 
     // Grab the server so that no-one else can do changes to XRandR and to block
     // change notifications until we are done
-    XCB::GrabServer grabber;
+    XCB::GrabServer grabber(m_backend->connection());
+    KSCREEN_PROBE3(xrandr_apply_plan, toDisable.count(), toChange.count(), toEnable.count());
 
     //If there is nothing to do, not even bother
     if (oldPrimaryOutput == primaryOutput && toDisable.isEmpty() && toEnable.isEmpty() && toChange.isEmpty()) {
         if (newScreenSize != currentScreenSize) {
             setScreenSize(newScreenSize);
         }
+        KSCREEN_PROBE1(xrandr_apply_return, 0);
         return;
     }
 
     Q_FOREACH(const KScreen::OutputPtr &output, toDisable) {
         disableOutput(output);
     }
+    KSCREEN_PROBE1(xrandr_apply_disabled, toDisable.count());
 
     if (intermediateScreenSize != currentScreenSize) {
         setScreenSize(intermediateScreenSize);
@@ -285,6 +297,7 @@ void XRandRConfig::applyKScreenConfig(const KScreen::ConfigPtr &config)
             }
         }
     }
+    KSCREEN_PROBE1(xrandr_apply_changed, toChange.count());
 
     Q_FOREACH(const KScreen::OutputPtr &output, toEnable) {
         if (!enableOutput(output)) {
@@ -293,6 +306,7 @@ void XRandRConfig::applyKScreenConfig(const KScreen::ConfigPtr &config)
             forceScreenSizeUpdate = true;
         }
     }
+    KSCREEN_PROBE1(xrandr_apply_enabled, toEnable.count());
 
     if (oldPrimaryOutput != primaryOutput) {
         setPrimaryOutput(primaryOutput);
@@ -306,6 +320,48 @@ void XRandRConfig::applyKScreenConfig(const KScreen::ConfigPtr &config)
         }
         setScreenSize(newSize);
     }
+    KSCREEN_PROBE1(xrandr_apply_return, 1);
+}
+
+void XRandRConfig::validateKScreenConfig(const KScreen::ConfigPtr &config,
+                                         KScreen::ConfigViolations *violations) const
+{
+    // Outputs that get disabled release their CRTC before the others are
+    // enabled, like in applyKScreenConfig()
+    QList<XRandRCrtc*> freeCrtcs;
+    Q_FOREACH (XRandRCrtc *crtc, m_crtcs) {
+        if (crtc->isFree()) {
+            freeCrtcs << crtc;
+        }
+    }
+    KScreen::OutputList toEnable;
+    Q_FOREACH (const KScreen::OutputPtr &kscreenOutput, config->outputs()) {
+        const XRandROutput *xOutput = output(kscreenOutput->id());
+        if (!xOutput) {
+            continue;
+        }
+        if (!kscreenOutput->isEnabled() && xOutput->crtc()) {
+            freeCrtcs << xOutput->crtc();
+        } else if (kscreenOutput->isEnabled() && !xOutput->crtc()) {
+            toEnable.insert(kscreenOutput->id(), kscreenOutput);
+        }
+    }
+
+    Q_FOREACH (const KScreen::OutputPtr &kscreenOutput, toEnable) {
+        XRandRCrtc *freeCrtc = Q_NULLPTR;
+        Q_FOREACH (XRandRCrtc *crtc, freeCrtcs) {
+            if (crtc->possibleOutputs().contains(kscreenOutput->id())) {
+                freeCrtc = crtc;
+                break;
+            }
+        }
+        if (!freeCrtc) {
+            violations->append(KScreen::ConfigViolation(KScreen::ConfigViolation::NoCrtcAvailable, kscreenOutput->id(),
+                                                        QStringLiteral("No free CRTC for output %1").arg(kscreenOutput->name())));
+            continue;
+        }
+        freeCrtcs.removeOne(freeCrtc);
+    }
 }
 
 void XRandRConfig::printConfig(const ConfigPtr &config) const
@@ -428,7 +484,8 @@ QSize XRandRConfig::screenSize(const KScreen::ConfigPtr &config) const
 
 bool XRandRConfig::setScreenSize(const QSize &size) const
 {
-    const double dpi = (25.4 * XRandR::screen()->height_in_pixels / XRandR::screen()->height_in_millimeters);
+    const xcb_screen_t *xScreen = m_backend->screen();
+    const double dpi = (25.4 * xScreen->height_in_pixels / xScreen->height_in_millimeters);
     const int widthMM =  ((25.4 * size.width()) / dpi);
     const int heightMM = ((25.4 * size.height()) / dpi);
 
@@ -437,7 +494,7 @@ bool XRandRConfig::setScreenSize(const QSize &size) const
     qCDebug(KSCREEN_XRANDR) << "\tSize:" << size;
     qCDebug(KSCREEN_XRANDR) << "\tSizeMM:" << QSize(widthMM, heightMM);
 
-    xcb_randr_set_screen_size(XCB::connection(), XRandR::rootWindow(),
+    xcb_randr_set_screen_size(m_backend->connection(), m_backend->rootWindow(),
                               size.width(), size.height(), widthMM, heightMM);
     m_screen->update(size);
     return true;
@@ -447,7 +504,7 @@ void XRandRConfig::setPrimaryOutput(xcb_randr_output_t outputId) const
 {
     qCDebug(KSCREEN_XRANDR) << "RRSetOutputPrimary";
     qCDebug(KSCREEN_XRANDR) << "\tNew primary:" << outputId;
-    xcb_randr_set_output_primary(XCB::connection(), XRandR::rootWindow(), outputId);
+    xcb_randr_set_output_primary(m_backend->connection(), m_backend->rootWindow(), outputId);
 
     for (XRandROutput *output : m_outputs) {
         output->setIsPrimary(output->id() == outputId);
@@ -469,13 +526,13 @@ bool XRandRConfig::disableOutput(const OutputPtr &kscreenOutput) const
     qCDebug(KSCREEN_XRANDR) << "RRSetCrtcConfig (disable output)";
     qCDebug(KSCREEN_XRANDR) << "\tCRTC:" << crtc;
 
-    auto cookie = xcb_randr_set_crtc_config(XCB::connection(), crtc,
+    auto cookie = xcb_randr_set_crtc_config(m_backend->connection(), crtc,
             XCB_CURRENT_TIME, XCB_CURRENT_TIME,
             0, 0,
             XCB_NONE,
             XCB_RANDR_ROTATION_ROTATE_0,
             0, NULL);
-    XCB::ScopedPointer<xcb_randr_set_crtc_config_reply_t> reply(xcb_randr_set_crtc_config_reply(XCB::connection(), cookie, NULL));
+    XCB::ScopedPointer<xcb_randr_set_crtc_config_reply_t> reply(xcb_randr_set_crtc_config_reply(m_backend->connection(), cookie, NULL));
     if (!reply) {
         qCDebug(KSCREEN_XRANDR) << "\tResult: unknown (error)";
         return false;
@@ -524,13 +581,13 @@ bool XRandRConfig::enableOutput(const OutputPtr &kscreenOutput) const
     qCDebug(KSCREEN_XRANDR) << "\tMode:" << kscreenOutput->currentMode() << "Preferred:" << kscreenOutput->preferredModeId();
     qCDebug(KSCREEN_XRANDR) << "\tRotation:" << kscreenOutput->rotation();
 
-    auto cookie = xcb_randr_set_crtc_config(XCB::connection(), freeCrtc->crtc(),
+    auto cookie = xcb_randr_set_crtc_config(m_backend->connection(), freeCrtc->crtc(),
             XCB_CURRENT_TIME, XCB_CURRENT_TIME,
             kscreenOutput->pos().rx(), kscreenOutput->pos().ry(),
             modeId,
             kscreenOutput->rotation(),
             1, outputs);
-    XCB::ScopedPointer<xcb_randr_set_crtc_config_reply_t> reply(xcb_randr_set_crtc_config_reply(XCB::connection(), cookie, NULL));
+    XCB::ScopedPointer<xcb_randr_set_crtc_config_reply_t> reply(xcb_randr_set_crtc_config_reply(m_backend->connection(), cookie, NULL));
     if (!reply) {
         qCDebug(KSCREEN_XRANDR) << "Result: unknown (error)";
         return false;
@@ -565,13 +622,13 @@ bool XRandRConfig::changeOutput(const OutputPtr &kscreenOutput) const
 
     xcb_randr_output_t outputs[1] { static_cast<xcb_randr_output_t>(kscreenOutput->id()) };
 
-    auto cookie = xcb_randr_set_crtc_config(XCB::connection(), xOutput->crtc()->crtc(),
+    auto cookie = xcb_randr_set_crtc_config(m_backend->connection(), xOutput->crtc()->crtc(),
             XCB_CURRENT_TIME, XCB_CURRENT_TIME,
             kscreenOutput->pos().rx(), kscreenOutput->pos().ry(),
             modeId,
             kscreenOutput->rotation(),
             1, outputs);
-    XCB::ScopedPointer<xcb_randr_set_crtc_config_reply_t> reply(xcb_randr_set_crtc_config_reply(XCB::connection(), cookie, NULL));
+    XCB::ScopedPointer<xcb_randr_set_crtc_config_reply_t> reply(xcb_randr_set_crtc_config_reply(m_backend->connection(), cookie, NULL));
     if (!reply) {
         qCDebug(KSCREEN_XRANDR) << "\tResult: unknown (error)";
         return false;
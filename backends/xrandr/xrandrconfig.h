@@ -21,6 +21,8 @@
 
 #include <QObject>
 
+#include "configviolation.h"
+
 #include "xrandr.h"
 #include "xrandrcrtc.h"
 #include "xrandroutput.h"
@@ -35,9 +37,11 @@ class XRandRConfig : public QObject
     Q_OBJECT
 
 public:
-    explicit XRandRConfig();
+    explicit XRandRConfig(XRandR *backend);
     virtual ~XRandRConfig();
 
+    XRandR *backend() const;
+
     XRandROutput::Map outputs() const;
     XRandROutput *output(xcb_randr_output_t output) const;
 
@@ -52,6 +56,9 @@ public:
 
     KScreen::ConfigPtr toKScreenConfig() const;
     void applyKScreenConfig(const KScreen::ConfigPtr &config);
+    // Adds what applyKScreenConfig() would fail on to @p violations
+    void validateKScreenConfig(const KScreen::ConfigPtr &config,
+                               KScreen::ConfigViolations *violations) const;
 
 private:
     /**
@@ -67,6 +74,7 @@ private:
     bool enableOutput(const KScreen::OutputPtr &output) const;
     bool changeOutput(const KScreen::OutputPtr &output) const;
 
+    XRandR *m_backend;
     XRandROutput::Map m_outputs;
     XRandRCrtc::Map m_crtcs;
     XRandRScreen *m_screen;
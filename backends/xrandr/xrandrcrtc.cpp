@@ -27,6 +27,7 @@
 
 XRandRCrtc::XRandRCrtc(xcb_randr_crtc_t crtc, XRandRConfig *config)
     : QObject(config)
+    , m_config(config)
     , m_crtc(crtc)
     , m_mode(0)
     , m_rotation(XCB_RANDR_ROTATION_ROTATE_0)
@@ -96,7 +97,7 @@ bool XRandRCrtc::isFree() const
 
 void XRandRCrtc::update()
 {
-    XCB::CRTCInfo crtcInfo(m_crtc, XCB_TIME_CURRENT_TIME);
+    XCB::CRTCInfo crtcInfo(m_config->backend()->connection(), m_crtc, XCB_TIME_CURRENT_TIME);
     m_mode = crtcInfo->mode;
     m_rotation = (xcb_randr_rotation_t) crtcInfo->rotation;
     m_geometry = QRect(crtcInfo->x, crtcInfo->y, crtcInfo->width, crtcInfo->height);
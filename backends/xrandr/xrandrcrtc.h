@@ -57,6 +57,7 @@ public:
     void update(xcb_randr_crtc_t mode, xcb_randr_rotation_t rotation, const QRect &geom);
 
 private:
+    XRandRConfig *m_config;
     xcb_randr_crtc_t m_crtc;
     xcb_randr_mode_t m_mode;
     xcb_randr_rotation_t m_rotation;
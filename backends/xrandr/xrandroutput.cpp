@@ -105,7 +105,7 @@ QByteArray XRandROutput::edid() const
 {
     if (m_edid.isNull()) {
         size_t len;
-        quint8 *data = XRandR::outputEdid(m_id, len);
+        quint8 *data = m_config->backend()->outputEdid(m_id, len);
         if (data) {
             m_edid = QByteArray((char *) data, len);
             delete[] data;
@@ -156,7 +156,7 @@ void XRandROutput::update(xcb_randr_crtc_t crtc, xcb_randr_mode_t mode, xcb_rand
     } else if (conn == XCB_RANDR_CONNECTION_CONNECTED) {
         // the output changed in some way, let's update the internal
         // list of modes, as it may have changed
-        XCB::OutputInfo outputInfo(m_id, XCB_TIME_CURRENT_TIME);
+        XCB::OutputInfo outputInfo(m_config->backend()->connection(), m_id, XCB_TIME_CURRENT_TIME);
         if (outputInfo) {
             updateModes(outputInfo);
         }
@@ -191,13 +191,14 @@ void XRandROutput::setIsPrimary(bool primary)
 
 void XRandROutput::init()
 {
-    XCB::OutputInfo outputInfo(m_id, XCB_TIME_CURRENT_TIME);
+    const XRandR *backend = m_config->backend();
+    XCB::OutputInfo outputInfo(backend->connection(), m_id, XCB_TIME_CURRENT_TIME);
     Q_ASSERT(outputInfo);
     if (!outputInfo) {
         return;
     }
 
-    XCB::PrimaryOutput primary(XRandR::rootWindow());
+    XCB::PrimaryOutput primary(backend->connection(), backend->rootWindow());
 
     m_name = QString::fromUtf8((const char *) xcb_randr_get_output_info_name(outputInfo.data()), outputInfo->name_len);
     m_type = fetchOutputType(m_id, m_name);
@@ -221,7 +222,7 @@ void XRandROutput::init()
 void XRandROutput::updateModes(const XCB::OutputInfo &outputInfo)
 {
     /* Init modes */
-    XCB::ScopedPointer<xcb_randr_get_screen_resources_reply_t> screenResources(XRandR::screenResources());
+    XCB::ScopedPointer<xcb_randr_get_screen_resources_reply_t> screenResources(m_config->backend()->screenResources());
     Q_ASSERT(screenResources);
     if (!screenResources) {
         return;
@@ -251,7 +252,7 @@ void XRandROutput::updateModes(const XCB::OutputInfo &outputInfo)
     }
 }
 
-KScreen::Output::Type XRandROutput::fetchOutputType(xcb_randr_output_t outputId, const QString &name)
+KScreen::Output::Type XRandROutput::fetchOutputType(xcb_randr_output_t outputId, const QString &name) const
 {
     QByteArray type = typeFromProperty(outputId);
     if (type.isEmpty()) {
@@ -307,20 +308,21 @@ KScreen::Output::Type XRandROutput::fetchOutputType(xcb_randr_output_t outputId,
 
 }
 
-QByteArray XRandROutput::typeFromProperty(xcb_randr_output_t outputId)
+QByteArray XRandROutput::typeFromProperty(xcb_randr_output_t outputId) const
 {
     QByteArray type;
 
-    XCB::InternAtom atomType(true, 13, "ConnectorType");
+    xcb_connection_t *connection = m_config->backend()->connection();
+    XCB::InternAtom atomType(connection, true, 13, "ConnectorType");
     if (!atomType) {
         return type;
     }
 
     char *connectorType;
 
-    auto cookie = xcb_randr_get_output_property(XCB::connection(), outputId, atomType->atom,
+    auto cookie = xcb_randr_get_output_property(connection, outputId, atomType->atom,
                                                 XCB_ATOM_ANY, 0, 100, false, false);
-    XCB::ScopedPointer<xcb_randr_get_output_property_reply_t> reply(xcb_randr_get_output_property_reply(XCB::connection(), cookie, NULL));
+    XCB::ScopedPointer<xcb_randr_get_output_property_reply_t> reply(xcb_randr_get_output_property_reply(connection, cookie, NULL));
     if (!reply) {
         return type;
     }
@@ -330,7 +332,7 @@ QByteArray XRandROutput::typeFromProperty(xcb_randr_output_t outputId)
     }
 
     const uint8_t *prop = xcb_randr_get_output_property_data(reply.data());
-    XCB::AtomName atomName(*reinterpret_cast<const xcb_atom_t*>(prop));
+    XCB::AtomName atomName(connection, *reinterpret_cast<const xcb_atom_t*>(prop));
     if (!atomName) {
         return type;
     }
@@ -74,8 +74,8 @@ private:
     void init();
     void updateModes(const XCB::OutputInfo &outputInfo);
 
-    static KScreen::Output::Type fetchOutputType(xcb_randr_output_t outputId, const QString &name);
-    static QByteArray typeFromProperty(xcb_randr_output_t outputId);
+    KScreen::Output::Type fetchOutputType(xcb_randr_output_t outputId, const QString &name) const;
+    QByteArray typeFromProperty(xcb_randr_output_t outputId) const;
 
     XRandRConfig *m_config;
     xcb_randr_output_t m_id;
@@ -22,14 +22,14 @@
 #include "screen.h"
 #include "config.h"
 
-#include <QX11Info>
 
 #include "../xcbwrapper.h"
 
 XRandRScreen::XRandRScreen(XRandRConfig *config)
     : QObject(config)
+    , m_config(config)
 {
-    XCB::ScreenSize size(XRandR::rootWindow());
+    XCB::ScreenSize size(m_config->backend()->connection(), m_config->backend()->rootWindow());
     m_maxSize = QSize(size->max_width, size->max_height);
     m_minSize = QSize(size->min_width, size->min_height);
     update();
@@ -41,7 +41,7 @@ XRandRScreen::~XRandRScreen()
 
 void XRandRScreen::update()
 {
-    xcb_screen_t *screen = XCB::screenOfDisplay(XCB::connection(), QX11Info::appScreen());
+    xcb_screen_t *screen = m_config->backend()->screen();
     m_currentSize = QSize(screen->width_in_pixels, screen->height_in_pixels);
 }
 
@@ -63,7 +63,7 @@ KScreen::ScreenPtr XRandRScreen::toKScreenScreen() const
     kscreenScreen->setMinSize(m_minSize);
     kscreenScreen->setCurrentSize(m_currentSize);
 
-    XCB::ScopedPointer<xcb_randr_get_screen_resources_reply_t> screenResources(XRandR::screenResources());
+    XCB::ScopedPointer<xcb_randr_get_screen_resources_reply_t> screenResources(m_config->backend()->screenResources());
     kscreenScreen->setMaxActiveOutputsCount(screenResources->num_crtcs);
 
     return kscreenScreen;
@@ -47,6 +47,7 @@ public:
     QSize currentSize();
 
 private:
+    XRandRConfig *m_config;
     int m_id;
     QSize m_minSize;
     QSize m_maxSize;
@@ -56,7 +56,7 @@ XRandR11::XRandR11()
         return;
     }
 
-    m_x11Helper = new XCBEventListener();
+    m_x11Helper = new XCBEventListener(XCB::connection(), XCB::defaultScreen());
 
     connect(m_x11Helper, &XCBEventListener::outputsChanged,
             this, &XRandR11::updateConfig);
@@ -66,8 +66,9 @@ XRandR11::XRandR11()
 
 XRandR11::~XRandR11()
 {
-    XCB::closeConnection();
+    // The listener still needs the connection to stop its event reader
     delete m_x11Helper;
+    XCB::closeConnection();
 }
 
 QString XRandR11::name() const
@@ -92,10 +93,10 @@ KScreen::ConfigPtr XRandR11::config() const
     auto features = KScreen::Config::Feature::Writable | KScreen::Config::Feature::PrimaryDisplay;
     config->setSupportedFeatures(features);
 
-    const int screenId = QX11Info::appScreen();
+    const int screenId = XCB::defaultScreen();
     xcb_screen_t* xcbScreen = XCB::screenOfDisplay(XCB::connection(), screenId);
-    const XCB::ScreenInfo info(xcbScreen->root);
-    const XCB::ScreenSize size(xcbScreen->root);
+    const XCB::ScreenInfo info(XCB::connection(), xcbScreen->root);
+    const XCB::ScreenSize size(XCB::connection(), xcbScreen->root);
 
     if (info->config_timestamp == m_currentTimestamp) {
         return m_currentConfig;
@@ -167,10 +168,10 @@ void XRandR11::setConfig(const KScreen::ConfigPtr &config)
     const KScreen::OutputPtr output = config->outputs().take(1);
     const KScreen::ModePtr mode = output->currentMode();
 
-    const int screenId = QX11Info::appScreen();
+    const int screenId = XCB::defaultScreen();
     xcb_screen_t* xcbScreen = XCB::screenOfDisplay(XCB::connection(), screenId);
 
-    const XCB::ScreenInfo info(xcbScreen->root);
+    const XCB::ScreenInfo info(XCB::connection(), xcbScreen->root);
     xcb_generic_error_t *err;
     const int sizeId = mode->id().split("-").first().toInt();
     auto cookie = xcb_randr_set_screen_config(XCB::connection(), xcbScreen->root,
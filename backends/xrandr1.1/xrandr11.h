@@ -30,7 +30,7 @@ class XCBEventListener;
 class XRandR11 : public KScreen::AbstractBackend
 {
     Q_OBJECT
-    Q_PLUGIN_METADATA(IID "org.kf5.kscreen.backends.xrandr11")
+    Q_PLUGIN_METADATA(IID "org.kf5.kscreen.backends.xrandr11" FILE "xrandr11.json")
 
 public:
     explicit XRandR11();
@@ -18,6 +18,13 @@
 
 
 #include "abstractbackend.h"
+#include "config.h"
+#include "mode.h"
+#include "output.h"
+#include "screen.h"
+#include "setconfigresult.h"
+
+#include <QRect>
 
 void KScreen::AbstractBackend::init(const QVariantMap &arguments)
 {
@@ -29,3 +36,102 @@ QByteArray KScreen::AbstractBackend::edid(int outputId) const
     Q_UNUSED(outputId);
     return QByteArray();
 }
+
+bool KScreen::AbstractBackend::isReady() const
+{
+    return true;
+}
+
+KScreen::SetConfigResult *KScreen::AbstractBackend::setConfigAsync(const KScreen::ConfigPtr &config)
+{
+    KScreen::SetConfigResult *result = new KScreen::SetConfigResult(this);
+    setConfig(config);
+    result->setConfig(this->config());
+    result->emitResult();
+    return result;
+}
+
+KScreen::ConfigPtr KScreen::AbstractBackend::validateConfig(const KScreen::ConfigPtr &config,
+                                                            KScreen::ConfigViolations *violations) const
+{
+    Q_ASSERT(violations);
+    if (!config) {
+        violations->append(ConfigViolation(ConfigViolation::Rejected, -1, QStringLiteral("No config")));
+        return ConfigPtr();
+    }
+    const ConfigPtr current = this->config();
+    if (!current) {
+        violations->append(ConfigViolation(ConfigViolation::Rejected, -1, QStringLiteral("The backend has no config")));
+        return ConfigPtr();
+    }
+
+    const ConfigPtr normalized = config->clone();
+    QRect bounds;
+    int enabledOutputs = 0;
+    Q_FOREACH (const OutputPtr &output, normalized->outputs()) {
+        const OutputPtr currentOutput = current->output(output->id());
+        if (!currentOutput) {
+            violations->append(ConfigViolation(ConfigViolation::UnknownOutput, output->id(),
+                                               QStringLiteral("Output %1 does not exist").arg(output->id())));
+            continue;
+        }
+        if (!output->isEnabled()) {
+            // Only enabled outputs can be primary
+            output->setPrimary(false);
+            continue;
+        }
+        ++enabledOutputs;
+
+        if (!currentOutput->isConnected()) {
+            violations->append(ConfigViolation(ConfigViolation::OutputNotConnected, output->id(),
+                                               QStringLiteral("Output %1 is not connected").arg(output->name())));
+            continue;
+        }
+        if (output->currentModeId().isEmpty()) {
+            output->setCurrentModeId(currentOutput->preferredModeId());
+        }
+        const ModePtr mode = currentOutput->mode(output->currentModeId());
+        if (!mode) {
+            violations->append(ConfigViolation(ConfigViolation::InvalidMode, output->id(),
+                                               QStringLiteral("Output %1 has no mode %2").arg(output->name(), output->currentModeId())));
+            continue;
+        }
+        if (output->scale() <= 0) {
+            violations->append(ConfigViolation(ConfigViolation::InvalidScale, output->id(),
+                                               QStringLiteral("Output %1 has an invalid scale %2").arg(output->name()).arg(output->scale())));
+            continue;
+        }
+
+        QSize size = mode->size() / output->scale();
+        if (!output->isHorizontal()) {
+            size.transpose();
+        }
+        bounds = bounds.united(QRect(output->pos(), size));
+    }
+
+    const ScreenPtr screen = current->screen();
+    if (screen) {
+        if (enabledOutputs > screen->maxActiveOutputsCount()) {
+            violations->append(ConfigViolation(ConfigViolation::TooManyOutputs, -1,
+                                               QStringLiteral("%1 outputs enabled, at most %2 supported")
+                                                    .arg(enabledOutputs).arg(screen->maxActiveOutputsCount())));
+        }
+        const QSize maxSize = screen->maxSize();
+        if (maxSize.isValid() && (bounds.width() > maxSize.width() || bounds.height() > maxSize.height())) {
+            violations->append(ConfigViolation(ConfigViolation::ScreenTooLarge, -1,
+                                               QStringLiteral("The outputs span %1x%2, at most %3x%4 supported")
+                                                    .arg(bounds.width()).arg(bounds.height())
+                                                    .arg(maxSize.width()).arg(maxSize.height())));
+        }
+        const QSize minSize = screen->minSize();
+        if (enabledOutputs > 0 && minSize.isValid()
+                && (bounds.width() < minSize.width() || bounds.height() < minSize.height())) {
+            violations->append(ConfigViolation(ConfigViolation::ScreenTooSmall, -1,
+                                               QStringLiteral("The outputs span %1x%2, at least %3x%4 required")
+                                                    .arg(bounds.width()).arg(bounds.height())
+                                                    .arg(minSize.width()).arg(minSize.height())));
+        }
+    }
+
+    return normalized;
+}
@@ -21,6 +21,7 @@
 #define ABSTRACT_BACKEND_H
 
 #include "kscreen_export.h"
+#include "configviolation.h"
 #include "types.h"
 
 #include <QString>
@@ -29,6 +30,7 @@
 namespace KScreen {
     class Config;
     class Edid;
+    class SetConfigResult;
 
 /**
  * Abstract class for backends.
@@ -78,14 +80,47 @@ public:
      */
     virtual void setConfig(const KScreen::ConfigPtr &config) = 0;
 
+    /**
+     * Apply a config object to the system and tell when it is done
+     *
+     * Backends that apply asynchronously, like when a compositor has to
+     * confirm the change, should reimplement this to finish the returned
+     * result only once the outcome is known. The default implementation
+     * calls setConfig() and finishes the result with config().
+     *
+     * The result is finished from the event loop, connect to its finished()
+     * signal right away. It is a child of the backend, so it lives in the
+     * backend thread.
+     *
+     * @param config Configuration to apply
+     * @return a handle finished with the applied config, or an error
+     * @since 5.12
+     */
+    virtual KScreen::SetConfigResult *setConfigAsync(const KScreen::ConfigPtr &config);
+
     /**
      * Returns whether the backend is in valid state.
      *
      * Backends should use this to tell BackendLauncher whether they are capable
-     * of operating on current platform
+     * of operating on current platform. Backends that are not ready yet return
+     * true unless they already know they cannot operate.
      */
     virtual bool isValid() const = 0;
 
+    /**
+     * Returns whether the backend has finished initializing
+     *
+     * Backends that have to wait for the windowing system before they know
+     * the configuration, or whether they can operate at all, should return
+     * false until then and emit ready() once they are done. isValid() and
+     * config() are only meaningful once the backend is ready.
+     *
+     * The default implementation returns true.
+     *
+     * @since 5.12
+     */
+    virtual bool isReady() const;
+
     /**
      * Returns encoded EDID data for given output
      *
@@ -96,7 +131,36 @@ public:
      */
     virtual QByteArray edid(int outputId) const;
 
+    /**
+     * Checks whether @p config can be applied, without applying anything
+     *
+     * Returns the config as setConfig() would apply it, for example with the
+     * preferred mode filled in for enabled outputs without a current mode, and
+     * adds the reasons why it cannot be applied to @p violations. The config is
+     * achievable if no violations were added.
+     *
+     * The default implementation checks the outputs, modes, scales, the number
+     * of enabled outputs and the screen size limits against config(). Backends
+     * should reimplement it to add their own constraints.
+     *
+     * @param config the configuration to check, it is not modified
+     * @param violations the reasons @p config cannot be applied are appended to it
+     * @return the normalized configuration
+     * @since 5.12
+     */
+    virtual KScreen::ConfigPtr validateConfig(const KScreen::ConfigPtr &config,
+                                              KScreen::ConfigViolations *violations) const;
+
 Q_SIGNALS:
+    /**
+     * Emitted once when a backend that was not ready after init() finished
+     * initializing, whether it ended up valid or not
+     *
+     * @see isReady()
+     * @since 5.12
+     */
+    void ready();
+
     /**
      * Emitted when backend detects a change in configuration
      *
@@ -108,6 +172,52 @@ Q_SIGNALS:
      */
     void configChanged(const KScreen::ConfigPtr &config);
 
+    /**
+     * Emitted when an output appeared in the configuration
+     *
+     * The incremental change signals are optional: backends that emit them
+     * instead of configChanged() for changes that touch a few outputs don't
+     * have to build the whole configuration for every change. Backends that
+     * don't implement them keep emitting configChanged(). Both kinds of
+     * emissions may be mixed, a full configuration replaces all incremental
+     * changes collected before it.
+     *
+     * The emitted objects are copied before they leave the backend thread,
+     * the backend may keep modifying them afterwards.
+     *
+     * @param output the new output
+     * @since 5.12
+     */
+    void outputAdded(const KScreen::OutputPtr &output);
+
+    /**
+     * Emitted when an output disappeared from the configuration
+     *
+     * @param outputId ID of the removed output
+     * @see outputAdded()
+     * @since 5.12
+     */
+    void outputRemoved(int outputId);
+
+    /**
+     * Emitted when any property of an output changed, including its list
+     * of modes
+     *
+     * @param output the output with all of its current properties
+     * @see outputAdded()
+     * @since 5.12
+     */
+    void outputUpdated(const KScreen::OutputPtr &output);
+
+    /**
+     * Emitted when the screen, like its current size, changed
+     *
+     * @param screen the screen with all of its current properties
+     * @see outputAdded()
+     * @since 5.12
+     */
+    void screenUpdated(const KScreen::ScreenPtr &screen);
+
 };
 
 } // namespace KScreen
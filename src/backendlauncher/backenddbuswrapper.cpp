@@ -24,34 +24,93 @@
 
 #include "src/configserializer_p.h"
 #include "src/config.h"
+#include "src/output.h"
+#include "src/screen.h"
+#include "src/setconfigresult.h"
 #include "src/abstractbackend.h"
+#include "src/tracelog_p.h"
+#include "src/tracing_p.h"
+#include "src/usdt_p.h"
 
+#include <QCoreApplication>
 #include <QDBusConnection>
 #include <QDBusError>
+#include <QJsonArray>
 
-BackendDBusWrapper::BackendDBusWrapper(KScreen::AbstractBackend* backend)
+// Last writer wins, per output: outputs not in @p newer keep the state
+// requested before
+static KScreen::ConfigPtr mergeConfigs(const KScreen::ConfigPtr &pending, const KScreen::ConfigPtr &newer)
+{
+    if (!pending || !newer) {
+        return newer ? newer : pending;
+    }
+    KScreen::OutputList outputs = pending->outputs();
+    Q_FOREACH (const KScreen::OutputPtr &output, newer->outputs()) {
+        outputs.insert(output->id(), output);
+    }
+    newer->setOutputs(outputs);
+    if (!newer->screen()) {
+        newer->setScreen(pending->screen());
+    }
+    return newer;
+}
+
+BackendDBusWrapper::BackendDBusWrapper(KScreen::AbstractBackend* backend, const QString &objectPath)
     : QObject()
     , mBackend(backend)
+    , mObjectPath(objectPath)
+    , mRequestCount(0)
+    , mApplyCount(0)
+    , mApplying(false)
+    , mTransactionId(0)
+    , mLastTransactionId(0)
+    , mFullConfigChanges(QCoreApplication::arguments().contains(QStringLiteral("--full-config-changes")))
 {
     connect(mBackend, &KScreen::AbstractBackend::configChanged,
             this, &BackendDBusWrapper::backendConfigChanged);
+    connect(mBackend, &KScreen::AbstractBackend::outputAdded,
+            this, &BackendDBusWrapper::backendOutputUpdated);
+    connect(mBackend, &KScreen::AbstractBackend::outputUpdated,
+            this, &BackendDBusWrapper::backendOutputUpdated);
+    connect(mBackend, &KScreen::AbstractBackend::outputRemoved,
+            this, &BackendDBusWrapper::backendOutputRemoved);
+    connect(mBackend, &KScreen::AbstractBackend::screenUpdated,
+            this, &BackendDBusWrapper::backendScreenUpdated);
 
     mChangeCollector.setSingleShot(true);
     mChangeCollector.setInterval(200); // wait for 200 msecs without any change
                                        // before actually emitting configChanged
     connect(&mChangeCollector, &QTimer::timeout,
             this, &BackendDBusWrapper::doEmitConfigChanged);
+
+    mRevertTimer.setSingleShot(true);
+    connect(&mRevertTimer, &QTimer::timeout,
+            this, &BackendDBusWrapper::revertConfig);
+
+    // A compositor that never answers must not hold up all later requests,
+    // and clients give up on their D-Bus call after 25 seconds anyway
+    mApplyTimeout.setSingleShot(true);
+    mApplyTimeout.setInterval(10000);
+    connect(&mApplyTimeout, &QTimer::timeout,
+            this, &BackendDBusWrapper::applyTimedOut);
 }
 
 BackendDBusWrapper::~BackendDBusWrapper()
 {
+    // Applies still running in the backend are lost, but what is pending
+    // can still be applied
+    flushPendingConfig();
+    // Don't leave an unconfirmed config behind when the launcher quits
+    if (mRevertConfig) {
+        mBackend->setConfig(mRevertConfig);
+    }
 }
 
 bool BackendDBusWrapper::init()
 {
     QDBusConnection dbus = QDBusConnection::sessionBus();
     new BackendAdaptor(this);
-    if (!dbus.registerObject(QLatin1String("/backend"), this, QDBusConnection::ExportAdaptors)) {
+    if (!dbus.registerObject(mObjectPath, this, QDBusConnection::ExportAdaptors)) {
         qCWarning(KSCREEN_BACKEND_LAUNCHER) << "Failed to export backend to DBus: another launcher already running?";
         qCWarning(KSCREEN_BACKEND_LAUNCHER) << dbus.lastError().message();
         return false;
@@ -62,6 +121,7 @@ bool BackendDBusWrapper::init()
 
 QVariantMap BackendDBusWrapper::getConfig() const
 {
+    KSCREEN_PROBE(launcher_getconfig_entry);
     const KScreen::ConfigPtr config = mBackend->config();
     Q_ASSERT(!config.isNull());
     if (!config) {
@@ -71,6 +131,7 @@ QVariantMap BackendDBusWrapper::getConfig() const
 
     const QJsonObject obj = KScreen::ConfigSerializer::serializeConfig(mBackend->config());
     Q_ASSERT(!obj.isEmpty());
+    KSCREEN_PROBE1(launcher_getconfig_return, config->outputs().count());
     return obj.toVariantMap();
 }
 
@@ -81,21 +142,300 @@ QVariantMap BackendDBusWrapper::setConfig(const QVariantMap &configMap)
         return QVariantMap();
     }
 
+    // A config set without revert is final, whoever sets it
+    cancelRevert();
     const KScreen::ConfigPtr config = KScreen::ConfigSerializer::deserializeConfig(configMap);
-    mBackend->setConfig(config);
+    if (!calledFromDBus()) {
+        flushPendingConfig();
+        return applyConfig(config);
+    }
+
+    ++mRequestCount;
+    mPendingConfig = mergeConfigs(mPendingConfig, config);
+    // Replied once the backend has finished applying
+    setDelayedReply(true);
+    mPendingReplies << message();
+
+    // Requests that arrive while the backend is applying are merged until it
+    // has finished, see runQueuedApplies()
+    if (!mApplying) {
+        queuePendingConfig();
+    }
+    return QVariantMap();
+}
+
+void BackendDBusWrapper::queuePendingConfig()
+{
+    if (mPendingReplies.isEmpty()) {
+        return;
+    }
+    const KScreen::ConfigPtr config = mPendingConfig;
+    const QList<QDBusMessage> requests = mPendingReplies;
+    mPendingConfig.clear();
+    mPendingReplies.clear();
+
+    ++mApplyCount;
+    if (requests.count() > 1) {
+        qCDebug(KSCREEN_BACKEND_LAUNCHER) << "Merged" << requests.count() << "setConfig requests,"
+                                          << (mRequestCount - mApplyCount) << "skipped so far";
+    }
+
+    enqueueApply([this, config, requests]() {
+        cancelRevert();
+        applyConfigAsync(config, [requests](const QString &error, const QVariantMap &applied) {
+            // Everyone gets the state they ended up with
+            sendReplies(requests, error, applied);
+        });
+    });
+}
+
+void BackendDBusWrapper::flushPendingConfig()
+{
+    if (mPendingReplies.isEmpty()) {
+        return;
+    }
+    const QVariantMap applied = applyConfig(mPendingConfig);
+    sendReplies(mPendingReplies, QString(), applied);
+    ++mApplyCount;
+    mPendingConfig.clear();
+    mPendingReplies.clear();
+}
+
+void BackendDBusWrapper::sendReplies(const QList<QDBusMessage> &requests, const QString &error, const QVariantMap &applied)
+{
+    QDBusConnection dbus = QDBusConnection::sessionBus();
+    Q_FOREACH (const QDBusMessage &request, requests) {
+        dbus.send(error.isEmpty() ? request.createReply(applied)
+                                  : request.createErrorReply(QDBusError::Failed, error));
+    }
+}
+
+void BackendDBusWrapper::enqueueApply(const std::function<void ()> &apply)
+{
+    mQueuedApplies << apply;
+    runQueuedApplies();
+}
 
-    mCurrentConfig = mBackend->config();
+void BackendDBusWrapper::runQueuedApplies()
+{
+    // The backend applies one config at a time
+    while (!mApplying && !mQueuedApplies.isEmpty()) {
+        mQueuedApplies.takeFirst()();
+    }
+    // Then everything that was merged in the meantime
+    if (!mApplying && !mPendingReplies.isEmpty()) {
+        queuePendingConfig();
+    }
+}
+
+QVariantMap BackendDBusWrapper::setConfigStatistics() const
+{
+    QVariantMap statistics;
+    statistics[QStringLiteral("requests")] = mRequestCount;
+    statistics[QStringLiteral("applies")] = mApplyCount;
+    statistics[QStringLiteral("skipped")] = mRequestCount - mApplyCount;
+    statistics[QStringLiteral("pending")] = mPendingReplies.count();
+    return statistics;
+}
+
+QVariantMap BackendDBusWrapper::setConfigWithRevert(const QVariantMap &configMap, uint timeout, uint &transactionId)
+{
+    transactionId = 0;
+    if (timeout == 0) {
+        return setConfig(configMap);
+    }
+    if (configMap.isEmpty()) {
+        qCWarning(KSCREEN_BACKEND_LAUNCHER) << "Received an empty config map";
+        return QVariantMap();
+    }
+
+    const KScreen::ConfigPtr config = KScreen::ConfigSerializer::deserializeConfig(configMap);
+    if (!calledFromDBus()) {
+        flushPendingConfig();
+        const KScreen::ConfigPtr previous = mRevertConfig ? mRevertConfig : mBackend->config()->clone();
+        const QVariantMap applied = applyConfig(config);
+        if (!applied.isEmpty()) {
+            transactionId = startTransaction(previous, timeout);
+        }
+        return applied;
+    }
+
+    setDelayedReply(true);
+    const QDBusMessage request = message();
+    // Keep the order of the requests
+    queuePendingConfig();
+    enqueueApply([this, config, timeout, request]() {
+        // Several unconfirmed changes in a row revert to the state before the first
+        const KScreen::ConfigPtr previous = mRevertConfig ? mRevertConfig : mBackend->config()->clone();
+        applyConfigAsync(config, [this, previous, timeout, request](const QString &error, const QVariantMap &applied) {
+            if (!error.isEmpty()) {
+                sendReplies(QList<QDBusMessage>() << request, error, applied);
+                return;
+            }
+            const uint transactionId = applied.isEmpty() ? 0 : startTransaction(previous, timeout);
+            QDBusConnection::sessionBus().send(request.createReply(QVariantList() << applied << transactionId));
+        });
+    });
+    return QVariantMap();
+}
+
+uint BackendDBusWrapper::startTransaction(const KScreen::ConfigPtr &previous, uint timeout)
+{
+    mRevertConfig = previous;
+    if (++mLastTransactionId == 0) {
+        ++mLastTransactionId; // 0 means no transaction
+    }
+    mTransactionId = mLastTransactionId;
+    mRevertTimer.start(timeout);
+    qCDebug(KSCREEN_BACKEND_LAUNCHER) << "Transaction" << mTransactionId << "is reverted in" << timeout << "ms unless confirmed";
+    return mTransactionId;
+}
+
+bool BackendDBusWrapper::confirm(uint transactionId)
+{
+    if (transactionId == 0 || transactionId != mTransactionId) {
+        qCDebug(KSCREEN_BACKEND_LAUNCHER) << "Transaction" << transactionId << "is not pending";
+        return false;
+    }
+    qCDebug(KSCREEN_BACKEND_LAUNCHER) << "Transaction" << transactionId << "confirmed";
+    cancelRevert();
+    return true;
+}
+
+void BackendDBusWrapper::cancelRevert()
+{
+    mRevertTimer.stop();
+    mRevertConfig.clear();
+    mTransactionId = 0;
+}
+
+void BackendDBusWrapper::revertConfig()
+{
+    if (!mRevertConfig) {
+        return;
+    }
+    const uint transactionId = mTransactionId;
+    const KScreen::ConfigPtr config = mRevertConfig;
+    cancelRevert();
+
+    qCDebug(KSCREEN_BACKEND_LAUNCHER) << "Transaction" << transactionId << "not confirmed in time, reverting";
+    enqueueApply([this, config, transactionId]() {
+        applyConfigAsync(config, [this, transactionId](const QString &error, const QVariantMap &applied) {
+            Q_UNUSED(applied);
+            if (!error.isEmpty()) {
+                qCWarning(KSCREEN_BACKEND_LAUNCHER) << "Failed to revert transaction" << transactionId << ":" << error;
+            }
+            Q_EMIT configReverted(transactionId);
+        });
+    });
+}
+
+void BackendDBusWrapper::recordApply(const KScreen::ConfigPtr &config)
+{
+    KSCREEN_PROBE1(launcher_setconfig_entry, config ? config->outputs().count() : -1);
+    KScreen::TraceLog *trace = KScreen::TraceLog::instance();
+    if (trace->isEnabled()) {
+        trace->recordConfig(KScreen::TraceLog::ConfigApplied, QStringLiteral("launcher"),
+                            KScreen::ConfigSerializer::serializeConfig(mBackend->config()),
+                            KScreen::ConfigSerializer::serializeConfig(config));
+    }
+}
+
+QVariantMap BackendDBusWrapper::configApplied(const KScreen::ConfigPtr &config)
+{
+    clearChanges();
+    mCurrentConfig = config ? config : mBackend->config();
     QMetaObject::invokeMethod(this, "doEmitConfigChanged", Qt::QueuedConnection);
 
-    // TODO: setConfig should return adjusted config that was actually applied
     const QJsonObject obj = KScreen::ConfigSerializer::serializeConfig(mCurrentConfig);
     Q_ASSERT(!obj.isEmpty());
+    KSCREEN_PROBE1(launcher_setconfig_return, mCurrentConfig ? mCurrentConfig->outputs().count() : -1);
     return obj.toVariantMap();
 }
 
+QVariantMap BackendDBusWrapper::applyConfig(const KScreen::ConfigPtr &config)
+{
+    recordApply(config);
+    mBackend->setConfig(config);
+    return configApplied(mBackend->config());
+}
+
+void BackendDBusWrapper::applyConfigAsync(const KScreen::ConfigPtr &config, const ApplyCallback &done)
+{
+    recordApply(config);
+    mApplying = true;
+    mApplyDone = done;
+    mApplyTimeout.start();
+    KScreen::SetConfigResult *result = mBackend->setConfigAsync(config);
+    // Whichever comes first of finished(), destroyed() and the timeout
+    // completes the apply, finishApply() disconnects the others
+    mApplyConnections << connect(result, &KScreen::SetConfigResult::finished,
+                                 this, [this](KScreen::SetConfigResult *finished) {
+        finishApply(finished->hasError() ? finished->errorString() : QString(), finished->config());
+    });
+    mApplyConnections << connect(result, &QObject::destroyed, this, [this]() {
+        finishApply(QStringLiteral("The backend dropped the config without applying it"), KScreen::ConfigPtr());
+    });
+}
+
+void BackendDBusWrapper::applyTimedOut()
+{
+    finishApply(QStringLiteral("The backend did not apply the config within %1 ms").arg(mApplyTimeout.interval()),
+                KScreen::ConfigPtr());
+}
+
+void BackendDBusWrapper::finishApply(const QString &error, const KScreen::ConfigPtr &applied)
+{
+    if (!mApplying) {
+        return;
+    }
+    mApplying = false;
+    mApplyTimeout.stop();
+    Q_FOREACH (const QMetaObject::Connection &connection, mApplyConnections) {
+        disconnect(connection);
+    }
+    mApplyConnections.clear();
+    const ApplyCallback done = mApplyDone;
+    mApplyDone = ApplyCallback();
+
+    if (!error.isEmpty()) {
+        qCWarning(KSCREEN_BACKEND_LAUNCHER) << "Backend failed to apply the config:" << error;
+        // What it ended up with is still news for the clients
+        if (applied) {
+            configApplied(applied);
+        }
+        done(error, QVariantMap());
+    } else {
+        done(QString(), configApplied(applied));
+    }
+    runQueuedApplies();
+}
+
+QVariantMap BackendDBusWrapper::validateConfig(const QVariantMap &configMap, QVariantList &violations) const
+{
+    if (configMap.isEmpty()) {
+        qCWarning(KSCREEN_BACKEND_LAUNCHER) << "Received an empty config map";
+        violations << KScreen::ConfigViolation(KScreen::ConfigViolation::Rejected, -1, QStringLiteral("Empty config")).toMap();
+        return QVariantMap();
+    }
+
+    const KScreen::ConfigPtr config = KScreen::ConfigSerializer::deserializeConfig(configMap);
+    KScreen::ConfigViolations configViolations;
+    const KScreen::ConfigPtr normalized = mBackend->validateConfig(config, &configViolations);
+    qCDebug(KSCREEN_BACKEND_LAUNCHER) << "Validated config:" << configViolations;
+
+    violations = KScreen::ConfigSerializer::serializeViolations(configViolations);
+    if (!normalized) {
+        return QVariantMap();
+    }
+    return KScreen::ConfigSerializer::serializeConfig(normalized).toVariantMap();
+}
+
 QByteArray BackendDBusWrapper::getEdid(int output) const
 {
+    KSCREEN_PROBE1(edid_fetch_entry, output);
     const QByteArray edidData =  mBackend->edid(output);
+    KSCREEN_PROBE2(edid_fetch_return, output, edidData.size());
     if (edidData.isEmpty()) {
         return QByteArray();
     }
@@ -111,21 +451,133 @@ void BackendDBusWrapper::backendConfigChanged(const KScreen::ConfigPtr &config)
         return;
     }
 
+    // The full config contains all the changes collected so far
+    clearChanges();
     mCurrentConfig = config;
+    collectChange(KScreen::Tracing::takeStamps(config));
+}
+
+void BackendDBusWrapper::backendOutputUpdated(const KScreen::OutputPtr &output)
+{
+    Q_ASSERT(!output.isNull());
+    if (!output) {
+        return;
+    }
+
+    mRemovedOutputs.removeAll(output->id());
+    mChangedOutputs.insert(output->id(), output->clone());
+    collectChange(KScreen::Tracing::takeStamps(output.data()));
+}
+
+void BackendDBusWrapper::backendOutputRemoved(int outputId)
+{
+    // An output that appeared and disappeared again within one notification
+    // is still announced as removed, clients may have seen it before
+    mChangedOutputs.remove(outputId);
+    if (!mRemovedOutputs.contains(outputId)) {
+        mRemovedOutputs << outputId;
+    }
+    collectChange(QVariantMap());
+}
+
+void BackendDBusWrapper::backendScreenUpdated(const KScreen::ScreenPtr &screen)
+{
+    Q_ASSERT(!screen.isNull());
+    if (!screen) {
+        return;
+    }
+
+    mChangedScreen = screen->clone();
+    collectChange(KScreen::Tracing::takeStamps(screen.data()));
+}
+
+void BackendDBusWrapper::collectChange(const QVariantMap &trace)
+{
+    // Changes are collected into one notification, which is as old as the
+    // first of them
+    if (!mChangeCollector.isActive() || mCurrentTrace.isEmpty()) {
+        mCurrentTrace = trace;
+    }
     mChangeCollector.start();
 }
 
+void BackendDBusWrapper::clearChanges()
+{
+    mChangedOutputs.clear();
+    mRemovedOutputs.clear();
+    mChangedScreen.clear();
+}
+
 void BackendDBusWrapper::doEmitConfigChanged()
 {
-    Q_ASSERT(!mCurrentConfig.isNull());
-    if (mCurrentConfig.isNull()) {
+    const bool hasChanges = !mChangedOutputs.isEmpty() || !mRemovedOutputs.isEmpty() || mChangedScreen;
+    Q_ASSERT(!mCurrentConfig.isNull() || hasChanges);
+    if (mCurrentConfig.isNull() && !hasChanges) {
         return;
     }
 
-    const QJsonObject obj = KScreen::ConfigSerializer::serializeConfig(mCurrentConfig);
-    Q_EMIT configChanged(obj.toVariantMap());
+    if (mCurrentTrace.isEmpty()) {
+        // The backend does not trace its changes, start here then
+        const qint64 now = KScreen::Tracing::now();
+        KScreen::Tracing::setStamp(mCurrentTrace, KScreen::Tracing::Origin, now);
+        KScreen::Tracing::setStamp(mCurrentTrace, KScreen::Tracing::Backend, now);
+    }
+    KScreen::Tracing::setStamp(mCurrentTrace, KScreen::Tracing::Launcher);
+
+    if (mCurrentConfig) {
+        const QJsonObject obj = KScreen::ConfigSerializer::serializeConfig(mCurrentConfig);
+        KScreen::TraceLog *trace = KScreen::TraceLog::instance();
+        if (trace->isEnabled()) {
+            trace->recordConfig(KScreen::TraceLog::ConfigChanged, QStringLiteral("launcher"), mTracedConfig, obj);
+            mTracedConfig = obj;
+        }
+        QVariantMap map = obj.toVariantMap();
+        map.insert(QStringLiteral("trace"), mCurrentTrace);
+        KSCREEN_PROBE2(launcher_config_changed, mCurrentConfig->outputs().count(),
+                       KScreen::Tracing::stampValue(mCurrentTrace, KScreen::Tracing::Origin));
+        Q_EMIT configChanged(map);
+    }
+
+    // Changes that came after the full config, if there was one
+    if (hasChanges) {
+        // Only what changed, in the format of a config, so that clients can
+        // deserialize it as one
+        QJsonObject obj;
+        if (!mChangedOutputs.isEmpty()) {
+            QJsonArray outputs;
+            Q_FOREACH (const KScreen::OutputPtr &output, mChangedOutputs) {
+                outputs.append(KScreen::ConfigSerializer::serializeOutput(output));
+            }
+            obj[QStringLiteral("outputs")] = outputs;
+        }
+        if (mChangedScreen) {
+            obj[QStringLiteral("screen")] = KScreen::ConfigSerializer::serializeScreen(mChangedScreen);
+        }
+        QVariantMap map = obj.toVariantMap();
+        if (!mRemovedOutputs.isEmpty()) {
+            QVariantList removed;
+            Q_FOREACH (int outputId, mRemovedOutputs) {
+                removed << outputId;
+            }
+            map.insert(QStringLiteral("removedOutputs"), removed);
+        }
+        map.insert(QStringLiteral("trace"), mCurrentTrace);
+        KSCREEN_PROBE2(launcher_config_changed, mChangedOutputs.count(),
+                       KScreen::Tracing::stampValue(mCurrentTrace, KScreen::Tracing::Origin));
+        Q_EMIT configUpdated(map);
+
+        // Clients that only know configChanged() need the whole config, it
+        // is marked so that the ones handling configUpdated() skip it
+        if (mFullConfigChanges) {
+            QVariantMap full = KScreen::ConfigSerializer::serializeConfig(mBackend->config()).toVariantMap();
+            full.insert(QStringLiteral("trace"), mCurrentTrace);
+            full.insert(QStringLiteral("updated"), true);
+            Q_EMIT configChanged(full);
+        }
+    }
 
     mCurrentConfig.clear();
+    mCurrentTrace.clear();
+    clearChanges();
     mChangeCollector.stop();
 }
-
@@ -21,8 +21,13 @@
 #define BACKENDDBUSWRAPPER_H
 
 #include <QObject>
+#include <QDBusContext>
+#include <QDBusMessage>
+#include <QJsonObject>
 #include <QTimer>
 
+#include <functional>
+
 #include "src/types.h"
 
 namespace KScreen
@@ -31,34 +36,95 @@ class AbstractBackend;
 }
 
 class BackendDBusWrapper : public QObject
+                         , protected QDBusContext
 {
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "org.kde.KScreen.Backend")
 
 public:
-    explicit BackendDBusWrapper(KScreen::AbstractBackend *backend);
+    explicit BackendDBusWrapper(KScreen::AbstractBackend *backend,
+                                const QString &objectPath = QStringLiteral("/backend"));
     virtual ~BackendDBusWrapper();
 
     bool init();
 
     QVariantMap getConfig() const;
     QVariantMap setConfig(const QVariantMap &config);
+    QVariantMap setConfigWithRevert(const QVariantMap &config, uint timeout, uint &transactionId);
+    bool confirm(uint transactionId);
+    QVariantMap setConfigStatistics() const;
+    QVariantMap validateConfig(const QVariantMap &config, QVariantList &violations) const;
     QByteArray getEdid(int output) const;
 
     inline KScreen::AbstractBackend *backend() const { return mBackend; }
 
 Q_SIGNALS:
     void configChanged(const QVariantMap &config);
+    void configUpdated(const QVariantMap &changes);
+    void configReverted(uint transactionId);
 
 private Q_SLOTS:
     void backendConfigChanged(const KScreen::ConfigPtr &config);
+    void backendOutputUpdated(const KScreen::OutputPtr &output);
+    void backendOutputRemoved(int outputId);
+    void backendScreenUpdated(const KScreen::ScreenPtr &screen);
     void doEmitConfigChanged();
+    void revertConfig();
+    void applyTimedOut();
 
 
 private:
+    typedef std::function<void (const QString &error, const QVariantMap &applied)> ApplyCallback;
+
+    QVariantMap applyConfig(const KScreen::ConfigPtr &config);
+    void applyConfigAsync(const KScreen::ConfigPtr &config, const ApplyCallback &done);
+    void finishApply(const QString &error, const KScreen::ConfigPtr &applied);
+    void recordApply(const KScreen::ConfigPtr &config);
+    QVariantMap configApplied(const KScreen::ConfigPtr &config);
+    void queuePendingConfig();
+    void flushPendingConfig();
+    void enqueueApply(const std::function<void ()> &apply);
+    void runQueuedApplies();
+    static void sendReplies(const QList<QDBusMessage> &requests, const QString &error, const QVariantMap &applied);
+    uint startTransaction(const KScreen::ConfigPtr &previous, uint timeout);
+    void cancelRevert();
+    void collectChange(const QVariantMap &trace);
+    void clearChanges();
+
     KScreen::AbstractBackend *mBackend;
+    QString mObjectPath;
     QTimer mChangeCollector;
     KScreen::ConfigPtr mCurrentConfig;
+    QVariantMap mCurrentTrace;
+    // Incremental changes collected since the last notification, used when
+    // the backend did not emit a full config in the meantime
+    KScreen::OutputList mChangedOutputs;
+    QList<int> mRemovedOutputs;
+    KScreen::ScreenPtr mChangedScreen;
+    // Last config written to the TraceLog
+    QJsonObject mTracedConfig;
+    // setConfig() requests waiting to be applied together, merged into one
+    // config, and the callers waiting for the reply
+    KScreen::ConfigPtr mPendingConfig;
+    QList<QDBusMessage> mPendingReplies;
+    quint64 mRequestCount;
+    quint64 mApplyCount;
+    // The backend applies asynchronously, one config at a time, the others
+    // wait in the queue
+    bool mApplying;
+    QList<std::function<void ()>> mQueuedApplies;
+    // The apply the backend is working on, given up when it takes too long
+    ApplyCallback mApplyDone;
+    QList<QMetaObject::Connection> mApplyConnections;
+    QTimer mApplyTimeout;
+    // The unconfirmed transaction, reverted to mRevertConfig on timeout
+    QTimer mRevertTimer;
+    KScreen::ConfigPtr mRevertConfig;
+    uint mTransactionId;
+    uint mLastTransactionId;
+    // Also emit the whole config after incremental changes, for clients that
+    // don't handle configUpdated(), enabled with --full-config-changes
+    bool mFullConfigChanges;
 
 };
 
@@ -23,12 +23,17 @@
 #include "debug_p.h"
 #include "src/abstractbackend.h"
 #include "src/backendmanager_p.h"
+#include "src/log.h"
 
-#include <QCoreApplication>
 #include <QDBusConnectionInterface>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDBusServiceWatcher>
 #include <QDir>
+#include <QGuiApplication>
 #include <QPluginLoader>
-#include <QX11Info>
+#include <QProcess>
+#include <QTimer>
 
 #include <memory>
 
@@ -48,13 +53,32 @@ BackendLoader::BackendLoader()
     : QObject()
     , QDBusContext()
     , mLoader(Q_NULLPTR)
-    , mBackend(Q_NULLPTR)
+    , mRestartWatcher(Q_NULLPTR)
+    , mReplaced(false)
+    , mForwardedRequests(0)
 {
 }
 
 BackendLoader::~BackendLoader()
 {
-    delete mBackend;
+    // The plugin instance is deleted when the plugin is unloaded, additional
+    // instances created for other displays are ours
+    // instance() would load the plugin if it is not
+    QObject *pluginInstance = (mLoader && mLoader->isLoaded()) ? mLoader->instance() : Q_NULLPTR;
+    for (BackendDBusWrapper *wrapper : mBackends) {
+        KScreen::AbstractBackend *backend = wrapper->backend();
+        delete wrapper;
+        if (backend != pluginInstance) {
+            delete backend;
+        }
+    }
+    mBackends.clear();
+    for (KScreen::AbstractBackend *backend : mInitializingBackends) {
+        if (backend != pluginInstance) {
+            delete backend;
+        }
+    }
+    mInitializingBackends.clear();
     pluginDeleter(mLoader);
     qCDebug(KSCREEN_BACKEND_LAUNCHER) << "Backend loader destroyed";
 }
@@ -74,8 +98,10 @@ bool BackendLoader::init()
 
 QString BackendLoader::backend() const
 {
-    if (mBackend) {
-        return mBackend->backend()->name();
+    if (!mBackends.isEmpty()) {
+        return mBackends.first()->backend()->name();
+    } else if (!mInitializingBackends.isEmpty()) {
+        return mInitializingBackends.first()->name();
     }
 
     return QString();
@@ -83,35 +109,212 @@ QString BackendLoader::backend() const
 
 bool BackendLoader::requestBackend(const QString &backendName, const QVariantMap &arguments)
 {
-    if (mBackend) {
+    const QString display = arguments.value(QStringLiteral("DISPLAY")).toString();
+    if (mInitializingBackends.contains(display)) {
+        // Same as for a backend that is ready
+        if (!backendName.isEmpty() && mInitializingBackends.value(display)->name() != backendName) {
+            sendErrorReply(QDBusError::Failed, QStringLiteral("Another backend is already active"));
+            return false;
+        }
+        // Answered once the backend is ready
+        setDelayedReply(true);
+        mPendingRequests.insert(display, message());
+        return false;
+    }
+
+    if (mRestartWatcher) {
+        // Answered by the launcher that takes over
+        setDelayedReply(true);
+        if (mReplaced) {
+            forwardRequest(message());
+        } else {
+            mRestartRequests << message();
+        }
+        return false;
+    }
+
+    const QString activeBackend = backend();
+    if (activeBackend.isEmpty() && !qobject_cast<QGuiApplication*>(QCoreApplication::instance())
+            && KScreen::BackendManager::backendRequiresGui(KScreen::BackendManager::preferredBackend(backendName))) {
+        // We were started for a backend that works without GUI, this one
+        // doesn't. Nothing is served yet, so a new launcher can take over.
+        setDelayedReply(true);
+        mRestartRequests << message();
+        restartWithGui();
+        return false;
+    }
+
+    if (!activeBackend.isEmpty()) {
         // If an backend is already loaded, but it's not the same as the one
         // requested, then it's an error
-        if (!backendName.isEmpty() && mBackend->backend()->name() != backendName) {
+        if (!backendName.isEmpty() && activeBackend != backendName) {
             sendErrorReply(QDBusError::Failed, QStringLiteral("Another backend is already active"));
             return false;
-        } else {
+        } else if (mBackends.contains(display)) {
             // If caller requested the same one as already loaded, or did not
             // request a specific backend, hapilly reuse the existing one
             return true;
         }
     }
 
-    KScreen::AbstractBackend *backend = loadBackend(backendName, arguments);
+    KScreen::AbstractBackend *backend = activeBackend.isEmpty() ? loadBackend(backendName, arguments)
+                                                                : createBackendInstance(arguments);
     if (!backend) {
         return false;
     }
 
-    mBackend = new BackendDBusWrapper(backend);
-    if (!mBackend->init()) {
-        delete mBackend;
-        mBackend = Q_NULLPTR;
-        pluginDeleter(mLoader);
-        mLoader = Q_NULLPTR;
+    if (!backend->isReady()) {
+        // Don't block the launcher while the backend talks to the windowing
+        // system, the caller gets its answer once that is done
+        qCDebug(KSCREEN_BACKEND_LAUNCHER) << "Waiting for" << backend->name() << "to initialize";
+        mInitializingBackends.insert(display, backend);
+        mInitializingArguments.insert(display, arguments);
+        mPendingRequests.insert(display, message());
+        setDelayedReply(true);
+        // Queued, the backend may be unloaded in there
+        connect(backend, &KScreen::AbstractBackend::ready, this,
+                [this, display]() {
+                    backendInitialized(display);
+                }, Qt::QueuedConnection);
         return false;
     }
+
+    return serveBackend(display, backend, arguments);
+}
+
+void BackendLoader::backendInitialized(const QString &display)
+{
+    KScreen::AbstractBackend *backend = mInitializingBackends.take(display);
+    const QVariantMap arguments = mInitializingArguments.take(display);
+    const QList<QDBusMessage> requests = mPendingRequests.values(display);
+    mPendingRequests.remove(display);
+    if (!backend) {
+        return;
+    }
+
+    bool served = false;
+    if (backend->isValid()) {
+        served = serveBackend(display, backend, arguments);
+    } else {
+        qCWarning(KSCREEN_BACKEND_LAUNCHER) << backend->name() << "failed to initialize";
+        unloadBackend(backend);
+    }
+
+    QDBusConnection dbus = QDBusConnection::sessionBus();
+    for (const QDBusMessage &request : requests) {
+        dbus.send(request.createReply(served));
+    }
+}
+
+bool BackendLoader::serveBackend(const QString &display, KScreen::AbstractBackend *backend,
+                                 const QVariantMap &arguments)
+{
+    BackendDBusWrapper *wrapper = new BackendDBusWrapper(backend, KScreen::BackendManager::backendObjectPath(arguments));
+    if (!wrapper->init()) {
+        delete wrapper;
+        unloadBackend(backend);
+        return false;
+    }
+
+    qCDebug(KSCREEN_BACKEND_LAUNCHER) << "Serving display" << (display.isEmpty() ? QStringLiteral("(default)") : display)
+                                      << "with" << backend->name();
+    mBackends.insert(display, wrapper);
     return true;
 }
 
+void BackendLoader::restartWithGui()
+{
+    qCDebug(KSCREEN_BACKEND_LAUNCHER) << "Restarting the launcher with GUI support";
+    mRestartWatcher = new QDBusServiceWatcher(QStringLiteral("org.kde.KScreen"), QDBusConnection::sessionBus(),
+                                              QDBusServiceWatcher::WatchForOwnerChange, this);
+    connect(mRestartWatcher, &QDBusServiceWatcher::serviceOwnerChanged,
+            this, &BackendLoader::launcherReplaced);
+
+    // With our options, e.g. --full-config-changes
+    const QStringList arguments = QCoreApplication::arguments().mid(1) << QStringLiteral("--gui");
+    if (!QProcess::startDetached(QCoreApplication::applicationFilePath(), arguments)) {
+        qCWarning(KSCREEN_BACKEND_LAUNCHER) << "Failed to start" << QCoreApplication::applicationFilePath();
+        restartTimedOut();
+        return;
+    }
+    // Cancelled with the watcher
+    QTimer::singleShot(10000, mRestartWatcher, [this]() {
+        restartTimedOut();
+    });
+}
+
+void BackendLoader::launcherReplaced(const QString &service, const QString &oldOwner, const QString &newOwner)
+{
+    Q_UNUSED(service);
+    Q_UNUSED(oldOwner);
+    if (mReplaced || newOwner.isEmpty() || newOwner == QDBusConnection::sessionBus().baseService()) {
+        return;
+    }
+
+    qCDebug(KSCREEN_BACKEND_LAUNCHER) << "Launcher with GUI support took over as" << newOwner;
+    mReplaced = true;
+    const QList<QDBusMessage> requests = mRestartRequests;
+    mRestartRequests.clear();
+    for (const QDBusMessage &request : requests) {
+        forwardRequest(request);
+    }
+}
+
+void BackendLoader::forwardRequest(const QDBusMessage &request)
+{
+    // Sent to the service name, which the new launcher owns now
+    QDBusMessage call = QDBusMessage::createMethodCall(QStringLiteral("org.kde.KScreen"),
+                                                       QStringLiteral("/"),
+                                                       QStringLiteral("org.kde.KScreen"),
+                                                       QStringLiteral("requestBackend"));
+    call.setArguments(request.arguments());
+    ++mForwardedRequests;
+    QDBusPendingCallWatcher *forwarded = new QDBusPendingCallWatcher(QDBusConnection::sessionBus().asyncCall(call), this);
+    connect(forwarded, &QDBusPendingCallWatcher::finished, this,
+            [this, request](QDBusPendingCallWatcher *watcher) {
+                watcher->deleteLater();
+                const QDBusPendingReply<bool> reply = *watcher;
+                QDBusConnection::sessionBus().send(reply.isError() ? request.createErrorReply(reply.error())
+                                                                   : request.createReply(reply.value()));
+                // Clients talk to the new launcher from now on
+                if (--mForwardedRequests == 0) {
+                    quit();
+                }
+            });
+}
+
+void BackendLoader::restartTimedOut()
+{
+    if (mReplaced) {
+        return;
+    }
+
+    qCWarning(KSCREEN_BACKEND_LAUNCHER) << "The launcher with GUI support did not take over";
+    // Called through it, so not deleted right away
+    mRestartWatcher->deleteLater();
+    mRestartWatcher = Q_NULLPTR;
+    const QList<QDBusMessage> requests = mRestartRequests;
+    mRestartRequests.clear();
+    QDBusConnection dbus = QDBusConnection::sessionBus();
+    for (const QDBusMessage &request : requests) {
+        dbus.send(request.createErrorReply(QDBusError::Failed,
+                                           QStringLiteral("Failed to restart the launcher with GUI support")));
+    }
+}
+
+void BackendLoader::unloadBackend(KScreen::AbstractBackend *backend)
+{
+    // The plugin instance goes away with the plugin, but the plugin's code
+    // has to stay as long as other displays are served by instances of it
+    if (mBackends.isEmpty() && mInitializingBackends.isEmpty()
+            && mLoader && mLoader->isLoaded() && mLoader->instance() == backend) {
+        pluginDeleter(mLoader);
+        mLoader = Q_NULLPTR;
+    } else {
+        delete backend;
+    }
+}
+
 KScreen::AbstractBackend *BackendLoader::loadBackend(const QString &name,
                                                      const QVariantMap &arguments)
 {
@@ -122,6 +325,31 @@ KScreen::AbstractBackend *BackendLoader::loadBackend(const QString &name,
     return KScreen::BackendManager::loadBackendPlugin(mLoader, name, arguments);
 }
 
+KScreen::AbstractBackend *BackendLoader::createBackendInstance(const QVariantMap &arguments)
+{
+    // The plugin instance is already in use for the first display, so this
+    // gets us a new instance created through the backend's meta object. That
+    // works for statically linked backends too, which have no plugin file.
+    const QString name = backend();
+    KScreen::AbstractBackend *backend = KScreen::BackendManager::loadBackendPlugin(mLoader, name, arguments);
+    if (!backend) {
+        qCWarning(KSCREEN_BACKEND_LAUNCHER) << name << "cannot serve display"
+                                            << arguments.value(QStringLiteral("DISPLAY")).toString();
+    }
+    return backend;
+}
+
+void BackendLoader::setLogRules(const QString &rules)
+{
+    qCDebug(KSCREEN_BACKEND_LAUNCHER) << "Logging rules:" << rules;
+    KScreen::Log::setLogRules(rules);
+}
+
+QString BackendLoader::logRules() const
+{
+    return KScreen::Log::logRules();
+}
+
 void BackendLoader::quit()
 {
     qApp->quit();
@@ -22,6 +22,10 @@
 
 #include <QObject>
 #include <QDBusContext>
+#include <QDBusMessage>
+#include <QMap>
+
+class QDBusServiceWatcher;
 
 namespace KScreen
 {
@@ -45,14 +49,38 @@ public:
 
     Q_INVOKABLE QString backend() const;
     Q_INVOKABLE bool requestBackend(const QString &name, const QVariantMap &arguments);
+    Q_INVOKABLE void setLogRules(const QString &rules);
+    Q_INVOKABLE QString logRules() const;
     Q_INVOKABLE void quit();
 
+private Q_SLOTS:
+    void backendInitialized(const QString &display);
+    void launcherReplaced(const QString &service, const QString &oldOwner, const QString &newOwner);
+    void restartTimedOut();
+
 private:
     KScreen::AbstractBackend *loadBackend(const QString &name, const QVariantMap &arguments);
+    KScreen::AbstractBackend *createBackendInstance(const QVariantMap &arguments);
+    bool serveBackend(const QString &display, KScreen::AbstractBackend *backend, const QVariantMap &arguments);
+    void unloadBackend(KScreen::AbstractBackend *backend);
+    void restartWithGui();
+    void forwardRequest(const QDBusMessage &request);
 
 private:
     QPluginLoader *mLoader;
-    BackendDBusWrapper *mBackend;
+    // Backends by the display they serve, the default display is an empty string.
+    // All of them are instances of the same plugin.
+    QMap<QString, BackendDBusWrapper*> mBackends;
+    // Backends that are not ready yet, and the requests waiting for them
+    QMap<QString, KScreen::AbstractBackend*> mInitializingBackends;
+    QMap<QString, QVariantMap> mInitializingArguments;
+    QMultiMap<QString, QDBusMessage> mPendingRequests;
+    // Set while a launcher with GUI support takes over from us, the requests
+    // are passed to it once it owns the service
+    QDBusServiceWatcher *mRestartWatcher;
+    QList<QDBusMessage> mRestartRequests;
+    bool mReplaced;
+    int mForwardedRequests;
 };
 
 #endif // BACKENDLAUNCHER_H
@@ -19,18 +19,58 @@
 
 #include <QGuiApplication>
 #include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusReply>
+#include <QScopedPointer>
 
 #include "debug_p.h"
 #include "backendloader.h"
 #include "log.h"
+#include "kscreen_static_backends.h"
+#include "src/backendmanager_p.h"
+
+// Backends linked into the launcher, BackendManager finds them before it
+// looks for plugin files
+KSCREEN_IMPORT_STATIC_BACKENDS
 
 int main(int argc, char **argv)
 {
     KScreen::Log::instance();
-    QGuiApplication::setDesktopSettingsAware(false);
-    QGuiApplication app(argc, argv);
 
-    if (!QDBusConnection::sessionBus().registerService(QStringLiteral("org.kde.KScreen"))) {
+    // Most backends talk to the display server on their own, so we only pay
+    // for the GUI platform plugin when the backend we are going to load asks
+    // for it in its metadata. Clients may still ask for a backend that needs
+    // it later on, the launcher then restarts itself with "--gui".
+    bool gui = false;
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--gui") == 0) {
+            gui = true;
+        }
+    }
+    QScopedPointer<QCoreApplication> app;
+    const QFileInfo backend = KScreen::BackendManager::preferredBackend();
+    if (gui || KScreen::BackendManager::backendRequiresGui(backend)) {
+        qCDebug(KSCREEN_BACKEND_LAUNCHER) << (gui ? QStringLiteral("Restarted") : backend.fileName())
+                                          << "requires GUI, starting as QGuiApplication";
+        QGuiApplication::setDesktopSettingsAware(false);
+        app.reset(new QGuiApplication(argc, argv));
+    } else {
+        app.reset(new QCoreApplication(argc, argv));
+    }
+
+    // The restarted launcher takes the service over from the one that
+    // started it, only a launcher without GUI lets it do that
+    QDBusConnectionInterface::ServiceReplacementOptions replacement = QDBusConnectionInterface::DontAllowReplacement;
+    if (gui) {
+        replacement = QDBusConnectionInterface::ReplaceExistingService;
+    } else if (!qobject_cast<QGuiApplication*>(app.data())) {
+        replacement = QDBusConnectionInterface::AllowReplacement;
+    }
+    const QDBusReply<QDBusConnectionInterface::RegisterServiceReply> reply =
+        QDBusConnection::sessionBus().interface()->registerService(QStringLiteral("org.kde.KScreen"),
+                                                                   QDBusConnectionInterface::DontQueueService,
+                                                                   replacement);
+    if (!reply.isValid() || reply.value() != QDBusConnectionInterface::ServiceRegistered) {
         qCWarning(KSCREEN_BACKEND_LAUNCHER) << "Cannot register org.kde.KScreen service. Another launcher already running?";
         return -1;
     }
@@ -40,7 +80,7 @@ int main(int argc, char **argv)
         return -2;
     }
 
-    const int ret = app.exec();
+    const int ret = app->exec();
 
     // Make sure the backend is destroyed and unloaded before we return (i.e.
     // as long as QApplication object and it's XCB connection still exist
@@ -24,21 +24,30 @@
 #include "abstractbackend.h"
 #include "config.h"
 #include "configmonitor.h"
+#include "context.h"
 #include "backendinterface.h"
 #include "debug_p.h"
 #include "getconfigoperation.h"
 #include "configserializer_p.h"
 #include "log.h"
+#include "output.h"
 
+#include <QDBusArgument>
 #include <QDBusConnection>
 #include <QDBusPendingCall>
 #include <QDBusPendingCallWatcher>
 #include <QDBusPendingReply>
 #include <QDBusConnectionInterface>
+#include <QDateTime>
+#include <QDir>
 #include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMutex>
+#include <QPointer>
 #include <QStandardPaths>
+#include <QSet>
 #include <QThread>
-#include <QX11Info>
 
 #include <memory>
 
@@ -49,24 +58,69 @@ Q_DECLARE_METATYPE(org::kde::kscreen::Backend*)
 
 const int BackendManager::sMaxCrashCount = 4;
 
-BackendManager *BackendManager::sInstance = 0;
+namespace {
 
-BackendManager *BackendManager::instance()
+// Carries a function to the thread of its receiver, posted events to one
+// thread are delivered in order, also across receivers
+class ThreadCall : public QObject
 {
-    if (!sInstance) {
-        sInstance = new BackendManager();
+public:
+    ThreadCall(const QObject *receiver, const std::function<void()> &function)
+        : mReceiver(receiver)
+        , mFunction(function)
+    {
+        moveToThread(receiver->thread());
+    }
+
+    static QEvent::Type eventType()
+    {
+        static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+        return type;
+    }
+
+protected:
+    bool event(QEvent *event) Q_DECL_OVERRIDE
+    {
+        if (event->type() != eventType()) {
+            return QObject::event(event);
+        }
+        if (mReceiver) {
+            mFunction();
+        }
+        // Not deleteLater(), the function may have ended the thread's event loop.
+        // Like for deferred deletes, Qt doesn't touch the object after event()
+        delete this;
+        return true;
     }
 
-    return sInstance;
+private:
+    QPointer<const QObject> mReceiver;
+    std::function<void()> mFunction;
+};
+
 }
 
-BackendManager::BackendManager()
+// Backends currently loaded from a plugin. QPluginLoader hands out the same
+// instance to every loader of a file, so when a second context loads the same
+// plugin it has to get a backend instance of its own.
+static QSet<QObject*> s_loadedBackends;
+
+BackendManager *BackendManager::instance()
+{
+    return Context::defaultContext()->backendManager();
+}
+
+BackendManager::BackendManager(Context *context)
     : QObject()
+    , mContext(context)
     , mInterface(0)
     , mCrashCount(0)
     , mShuttingDown(false)
+    , mRequestAfterShutdown(false)
     , mRequestsCounter(0)
     , mLoader(0)
+    , mBackendThread(Q_NULLPTR)
+    , mThreaded(false)
     , mMethod(OutOfProcess)
 {
     Log::instance();
@@ -79,17 +133,31 @@ BackendManager::BackendManager()
         const QByteArrayList falses({QByteArray("0"), QByteArray("false")});
         if (!falses.contains(_inprocess.toLower())) {
             mMethod = InProcess;
+            mThreaded = (_inprocess.toLower() == QByteArray("threaded"));
         } else {
             mMethod = OutOfProcess;
         }
     } else {
         // For XRandR backends, use out of process
-        if (preferredBackend().fileName().startsWith(QLatin1String("KSC_XRandR"))) {
+        if (preferredBackend(backendName()).fileName().startsWith(QLatin1String("KSC_XRandR"))) {
             mMethod = OutOfProcess;
         } else {
             mMethod = InProcess;
         }
     }
+
+    // The launcher leaving the bus is what tells us a shutdown is complete
+    mLauncherWatcher.setConnection(QDBusConnection::sessionBus());
+    mLauncherWatcher.setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+    connect(&mLauncherWatcher, &QDBusServiceWatcher::serviceUnregistered,
+            this, &BackendManager::finishShutdown);
+    mShutdownTimer.setSingleShot(true);
+    connect(&mShutdownTimer, &QTimer::timeout,
+            this, [=]() {
+                qCWarning(KSCREEN) << "Backend launcher did not quit in time, not waiting for it any longer";
+                finishShutdown();
+            });
+
     initMethod();
 }
 
@@ -116,7 +184,9 @@ void BackendManager::setMethod(BackendManager::Method m)
     if (mMethod == m) {
         return;
     }
-    shutdownBackend();
+    // Requests for the new method which arrive while the old launcher is
+    // still quitting are held back until it's gone
+    shutdownBackendAsync();
     mMethod = m;
     initMethod();
 }
@@ -126,81 +196,331 @@ BackendManager::Method BackendManager::method() const
     return mMethod;
 }
 
-BackendManager::~BackendManager()
+bool BackendManager::isThreaded() const
+{
+    return mThreaded;
+}
+
+void BackendManager::setThreaded(bool threaded)
 {
+    if (mThreaded == threaded) {
+        return;
+    }
     if (mMethod == InProcess) {
         shutdownBackend();
     }
+    mThreaded = threaded;
+}
+
+Context *BackendManager::context() const
+{
+    return mContext;
+}
+
+static QVariantMap parseBackendArguments(const QByteArray &args)
+{
+    QVariantMap arguments;
+    if (!args.isEmpty()) {
+        QList<QByteArray> arglist = args.split(';');
+        Q_FOREACH (const QByteArray &arg, arglist) {
+            const int pos = arg.indexOf('=');
+            if (pos == -1) {
+                continue;
+            }
+            arguments.insert(QString::fromLocal8Bit(arg.left(pos)), QString::fromLocal8Bit(arg.mid(pos + 1)));
+        }
+    }
+    return arguments;
+}
+
+// Contexts created for a specific backend don't pick up the env vars, those
+// are meant for the default context
+static bool usesEnvironment(const Context *context)
+{
+    return context->backendName().isEmpty() && context->backendArguments().isEmpty();
+}
+
+QString BackendManager::backendName() const
+{
+    if (usesEnvironment(mContext)) {
+        return QString::fromLocal8Bit(qgetenv("KSCREEN_BACKEND"));
+    }
+    return mContext->backendName();
+}
+
+QVariantMap BackendManager::backendArguments() const
+{
+    if (usesEnvironment(mContext)) {
+        return parseBackendArguments(qgetenv("KSCREEN_BACKEND_ARGS"));
+    }
+    return mContext->backendArguments();
+}
+
+BackendManager::~BackendManager()
+{
+    // The launcher is shared with other clients, it's not ours to stop here
+    if (mMethod == InProcess) {
+        shutdownInProcessBackend();
+    }
+}
+
+static QString platformName()
+{
+    if (qobject_cast<QGuiApplication*>(QCoreApplication::instance())) {
+        return QGuiApplication::platformName();
+    }
+
+    // Without a QGuiApplication (e.g. in the backend launcher) there is no
+    // platform plugin to ask, so guess it the same way Qt would
+    const QString qpa = QString::fromLocal8Bit(qgetenv("QT_QPA_PLATFORM"));
+    if (!qpa.isEmpty()) {
+        return qpa;
+    }
+    const QByteArray sessionType = qgetenv("XDG_SESSION_TYPE");
+    if (sessionType == "wayland") {
+        return QStringLiteral("wayland");
+    } else if (sessionType == "x11") {
+        return QStringLiteral("xcb");
+    }
+    if (!qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY")) {
+        return QStringLiteral("wayland");
+    } else if (!qEnvironmentVariableIsEmpty("DISPLAY")) {
+        return QStringLiteral("xcb");
+    }
+    return QString();
+}
+
+static bool selectBackend(const QVector<BackendManager::BackendInfo> &candidates,
+                          const QString &backendFilter, const QString &platform,
+                          BackendManager::BackendInfo *selected, BackendManager::BackendInfo *fallback)
+{
+    for (const BackendManager::BackendInfo &info : candidates) {
+        if (!backendFilter.isEmpty()) {
+            // Here's the part where we do the match case-insensitive
+            if (info.name.compare(backendFilter, Qt::CaseInsensitive) == 0
+                || info.file.baseName().toLower() == QStringLiteral("ksc_%1").arg(backendFilter.toLower())) {
+                *selected = info;
+                return true;
+            }
+        } else if (!platform.isEmpty()) {
+            for (const QString &p : info.platforms) {
+                if (platform.startsWith(p)) {
+                    *selected = info;
+                    return true;
+                }
+            }
+        }
+        if (fallback->file.filePath().isEmpty() && info.file.baseName() == QLatin1String("KSC_QScreen")) {
+            *fallback = info;
+        }
+    }
+    return false;
 }
 
 QFileInfo BackendManager::preferredBackend(const QString &backend)
+{
+    return preferredBackendInfo(backend).file;
+}
+
+BackendManager::BackendInfo BackendManager::preferredBackendInfo(const QString &backend)
 {
     /** this is the logic to pick a backend, in order of priority
      *
      * - backend argument is used if not empty
      * - env var KSCREEN_BACKEND is considered
-     * - if platform is X11, the XRandR backend is picked
-     * - if platform is wayland, KWayland backend is picked
+     * - otherwise the backend whose metadata lists the current platform is
+     *   picked: XRandR on X11, KWayland on wayland
      * - if neither is the case, QScreen backend is picked
      * - the QScreen backend is also used as fallback
      *
+     * Backends linked in statically are considered before the installed ones,
+     * the file system is only looked at when none of them fits.
      */
     QString backendFilter;
     const auto env_kscreen_backend = qgetenv("KSCREEN_BACKEND");
     if (!backend.isEmpty()) {
         backendFilter = backend;
     } else if (!env_kscreen_backend.isEmpty()) {
-        backendFilter = env_kscreen_backend;
-    } else {
-        if (QX11Info::isPlatformX11()) {
-            backendFilter = QStringLiteral("XRandR");
-        } else if (QGuiApplication::platformName().startsWith(QLatin1String("wayland"))) {
-            backendFilter = QStringLiteral("KWayland");
-        } else {
-            backendFilter = QStringLiteral("QScreen");
-        }
+        backendFilter = QString::fromLocal8Bit(env_kscreen_backend);
     }
-    QFileInfo fallback;
-    Q_FOREACH (const QFileInfo &f, listBackends()) {
-        // Here's the part where we do the match case-insensitive
-        if (f.baseName().toLower() == QStringLiteral("ksc_%1").arg(backendFilter.toLower())) {
-            return f;
-        }
-        if (f.baseName() == QLatin1String("KSC_QScreen")) {
-            fallback = f;
-        }
+    const QString platform = backendFilter.isEmpty() ? platformName() : QString();
+
+    BackendInfo selected;
+    BackendInfo fallback;
+    if (selectBackend(staticBackends(), backendFilter, platform, &selected, &fallback)
+        || selectBackend(installedBackends(), backendFilter, platform, &selected, &fallback)) {
+        return selected;
     }
 //     qCWarning(KSCREEN) << "No preferred backend found. KSCREEN_BACKEND is set to " << env_kscreen_backend;
-//     qCWarning(KSCREEN) << "falling back to " << fallback.fileName();
+//     qCWarning(KSCREEN) << "falling back to " << fallback.file.fileName();
     return fallback;
 }
 
 QFileInfoList BackendManager::listBackends()
 {
-    // Compile a list of installed backends first
-    const QString backendFilter = QStringLiteral("KSC_*");
-    const QStringList paths = QCoreApplication::libraryPaths();
     QFileInfoList finfos;
+    const QVector<BackendInfo> index = backendIndex();
+    for (const BackendInfo &info : index) {
+        finfos.append(info.file);
+    }
+    return finfos;
+}
+
+static BackendManager::BackendInfo backendInfoFromMetaData(const QJsonObject &metaData)
+{
+    BackendManager::BackendInfo info;
+    info.name = metaData.value(QStringLiteral("Name")).toString();
+    info.platforms = QVariant(metaData.value(QStringLiteral("Platforms")).toArray().toVariantList()).toStringList();
+    info.features = QVariant(metaData.value(QStringLiteral("Features")).toArray().toVariantList()).toStringList();
+    info.requiresGui = metaData.value(QStringLiteral("RequiresGui")).toBool(false);
+    return info;
+}
+
+static BackendManager::BackendInfo readBackendInfo(const QFileInfo &plugin)
+{
+    // Only reads the metadata, the plugin itself is not loaded
+    const QPluginLoader loader(plugin.filePath());
+    BackendManager::BackendInfo info = backendInfoFromMetaData(loader.metaData().value(QStringLiteral("MetaData")).toObject());
+    info.file = plugin;
+    if (info.name.isEmpty()) {
+        info.name = plugin.baseName().mid(4); // strip "KSC_"
+    }
+    return info;
+}
+
+QVector<BackendManager::BackendInfo> BackendManager::staticBackends()
+{
+    // Linked in when the application was built, so this never changes
+    static const QVector<BackendInfo> backends = []() {
+        QVector<BackendInfo> result;
+        const auto plugins = QPluginLoader::staticPlugins();
+        for (const QStaticPlugin &plugin : plugins) {
+            const QJsonObject json = plugin.metaData();
+            if (!json.value(QStringLiteral("IID")).toString().startsWith(QLatin1String("org.kf5.kscreen.backends."))) {
+                continue;
+            }
+            BackendInfo info = backendInfoFromMetaData(json.value(QStringLiteral("MetaData")).toObject());
+            if (info.name.isEmpty()) {
+                info.name = json.value(QStringLiteral("className")).toString();
+            }
+            // There is no file, but the name keeps it recognizable
+            info.file = QFileInfo(QStringLiteral("KSC_") + info.name);
+            info.staticInstance = plugin.instance;
+            result.append(info);
+        }
+        return result;
+    }();
+    return backends;
+}
+
+namespace {
+struct BackendIndexCache
+{
+    QMutex lock;
+    bool valid = false;
+    QStringList libraryPaths;
+    // Plugin directories and their mtime when the index was built
+    QVector<QPair<QString, QDateTime>> directories;
+    QVector<BackendManager::BackendInfo> backends;
+};
+}
+
+Q_GLOBAL_STATIC(BackendIndexCache, s_backendIndex)
+
+QVector<BackendManager::BackendInfo> BackendManager::backendIndex()
+{
+    return staticBackends() + installedBackends();
+}
+
+QVector<BackendManager::BackendInfo> BackendManager::installedBackends()
+{
+    BackendIndexCache *cache = s_backendIndex();
+    QMutexLocker locker(&cache->lock);
+
+    // Stat'ing the directories is a lot cheaper than listing them and reading
+    // the metadata of every plugin in there
+    const QStringList paths = QCoreApplication::libraryPaths();
+    bool valid = cache->valid && cache->libraryPaths == paths;
+    for (int i = 0; valid && i < cache->directories.size(); ++i) {
+        const auto &directory = cache->directories.at(i);
+        valid = (QFileInfo(directory.first).lastModified() == directory.second);
+    }
+    if (valid) {
+        return cache->backends;
+    }
+
+    cache->libraryPaths = paths;
+    cache->directories.clear();
+    cache->backends.clear();
     for (const QString &path : paths) {
-        const QDir dir(path + QLatin1String("/kf5/kscreen/"),
-                       backendFilter,
+        const QString dirPath = path + QLatin1String("/kf5/kscreen/");
+        cache->directories.append(qMakePair(dirPath, QFileInfo(dirPath).lastModified()));
+        const QDir dir(dirPath,
+                       QStringLiteral("KSC_*"),
                        QDir::SortFlags(QDir::QDir::Name),
                        QDir::NoDotAndDotDot | QDir::Files);
-        finfos.append(dir.entryInfoList());
+        Q_FOREACH (const QFileInfo &f, dir.entryInfoList()) {
+            cache->backends.append(readBackendInfo(f));
+        }
     }
-    return finfos;
+    cache->valid = true;
+    return cache->backends;
+}
+
+bool BackendManager::backendRequiresGui(const QFileInfo &plugin)
+{
+    const QVector<BackendInfo> index = backendIndex();
+    for (const BackendInfo &info : index) {
+        if (info.file == plugin) {
+            return info.requiresGui;
+        }
+    }
+    return readBackendInfo(plugin).requiresGui;
+}
+
+QString BackendManager::backendObjectPath(const QVariantMap &arguments)
+{
+    const QString display = arguments.value(QStringLiteral("DISPLAY")).toString();
+    if (display.isEmpty()) {
+        return QStringLiteral("/backend");
+    }
+
+    // DBus object paths only allow [A-Za-z0-9_], so ":1.0" becomes "/backend/display_1_0"
+    QString element = QStringLiteral("display_");
+    for (const QChar &c : display) {
+        element.append((c.isLetterOrNumber() && c.unicode() < 128) ? c : QLatin1Char('_'));
+    }
+    return QStringLiteral("/backend/") + element;
 }
 
 KScreen::AbstractBackend *BackendManager::loadBackendPlugin(QPluginLoader *loader, const QString &name,
                                                      const QVariantMap &arguments)
 {
-    const auto finfo = preferredBackend(name);
-    loader->setFileName(finfo.filePath());
-    QObject *instance = loader->instance();
-    if (!instance) {
-        qCDebug(KSCREEN) << loader->errorString();
+    const BackendInfo info = preferredBackendInfo(name);
+    const QFileInfo finfo = info.file;
+    if (info.requiresGui && !qobject_cast<QGuiApplication*>(QCoreApplication::instance())) {
+        qCWarning(KSCREEN) << finfo.fileName() << "requires a QGuiApplication, refusing to load it";
         return nullptr;
     }
+    QObject *instance = nullptr;
+    if (info.staticInstance) {
+        instance = info.staticInstance();
+    } else {
+        loader->setFileName(finfo.filePath());
+        instance = loader->instance();
+        if (!instance) {
+            qCDebug(KSCREEN) << loader->errorString();
+            return nullptr;
+        }
+    }
+
+    if (s_loadedBackends.contains(instance)) {
+        instance = instance->metaObject()->newInstance();
+        if (!instance) {
+            qCWarning(KSCREEN) << finfo.fileName() << "is already in use and cannot create another backend instance";
+            return nullptr;
+        }
+    }
 
     auto backend = qobject_cast<KScreen::AbstractBackend*>(instance);
     if (backend) {
@@ -211,6 +531,11 @@ KScreen::AbstractBackend *BackendManager::loadBackendPlugin(QPluginLoader *loade
             return nullptr;
         }
         //qCDebug(KSCREEN) << "Loaded" << backend->name() << "backend";
+        s_loadedBackends.insert(backend);
+        QObject::connect(backend, &QObject::destroyed,
+                         [](QObject *obj) {
+                             s_loadedBackends.remove(obj);
+                         });
         return backend;
     } else {
         qCDebug(KSCREEN) << finfo.fileName() << "does not provide valid KScreen backend";
@@ -235,21 +560,40 @@ KScreen::AbstractBackend *BackendManager::loadBackendInProcess(const QString &na
     if (mLoader == nullptr) {
         mLoader = new QPluginLoader(this);
     }
-    QVariantMap arguments;
-    auto beargs = QString::fromLocal8Bit(qgetenv("KSCREEN_BACKEND_ARGS"));
-    if (beargs.startsWith("TEST_DATA=")) {
-        arguments["TEST_DATA"] = beargs.remove("TEST_DATA=");
-    }
+    const QVariantMap arguments = backendArguments();
     auto backend = BackendManager::loadBackendPlugin(mLoader, name, arguments);
-    //qCDebug(KSCREEN) << "Connecting ConfigMonitor to backend.";
-    ConfigMonitor::instance()->connectInProcessBackend(backend);
+    if (backend && mThreaded) {
+        if (backendRequiresGui(preferredBackend(name))) {
+            qCWarning(KSCREEN) << backend->name() << "backend requires the GUI thread, not moving it to a thread of its own";
+        } else {
+            mBackendThread = new QThread(this);
+            mBackendThread->setObjectName(QStringLiteral("KScreen backend"));
+            backend->moveToThread(mBackendThread);
+            mBackendThread->start();
+        }
+    }
+    if (backend) {
+        //qCDebug(KSCREEN) << "Connecting ConfigMonitor to backend.";
+        mContext->configMonitor()->connectInProcessBackend(backend);
+    }
     m_inProcessBackend = qMakePair<KScreen::AbstractBackend*, QVariantMap>(backend, arguments);
     return backend;
 }
 
+void BackendManager::invokeInThread(const QObject *receiver, const std::function<void()> &function)
+{
+    QCoreApplication::postEvent(new ThreadCall(receiver, function), new QEvent(ThreadCall::eventType()));
+}
+
 void BackendManager::requestBackend()
 {
     Q_ASSERT(mMethod == OutOfProcess);
+    // Asking now would only find the launcher which is about to quit
+    if (mShuttingDown) {
+        mRequestAfterShutdown = true;
+        return;
+    }
+
     if (mInterface && mInterface->isValid()) {
         ++mRequestsCounter;
         QMetaObject::invokeMethod(this, "emitBackendReady", Qt::QueuedConnection);
@@ -262,29 +606,16 @@ void BackendManager::requestBackend()
     }
     ++mRequestsCounter;
 
-    const QByteArray args = qgetenv("KSCREEN_BACKEND_ARGS");
-    QVariantMap arguments;
-    if (!args.isEmpty()) {
-        QList<QByteArray> arglist = args.split(';');
-        Q_FOREACH (const QByteArray &arg, arglist) {
-            const int pos = arg.indexOf('=');
-            if (pos == -1) {
-                continue;
-            }
-            arguments.insert(arg.left(pos), arg.mid(pos + 1));
-        }
-    }
-
-    startBackend(QString::fromLatin1(qgetenv("KSCREEN_BACKEND")), arguments);
+    startBackend(backendName(), backendArguments());
 }
 
 void BackendManager::emitBackendReady()
 {
-    Q_ASSERT(mMethod == OutOfProcess);
     Q_EMIT backendReady(mInterface);
     --mRequestsCounter;
-    if (mShutdownLoop.isRunning()) {
-        mShutdownLoop.quit();
+    // A shutdown waits for pending requests to be answered
+    if (mShuttingDown && mRequestsCounter == 0) {
+        quitLauncher();
     }
 }
 
@@ -295,6 +626,7 @@ void BackendManager::startBackend(const QString &backend, const QVariantMap &arg
     //   a) if the launcher is started it will force it to load the correct backend,
     //   b) if the launcher is already running it will make sure it's running with
     //      the same backend as the one we requested and send an error otherwise
+    mBackendArguments = arguments;
     QDBusConnection conn = QDBusConnection::sessionBus();
     QDBusMessage call = QDBusMessage::createMethodCall(QStringLiteral("org.kde.KScreen"),
                                                        QStringLiteral("/"),
@@ -309,7 +641,8 @@ void BackendManager::startBackend(const QString &backend, const QVariantMap &arg
 
 void BackendManager::onBackendRequestDone(QDBusPendingCallWatcher *watcher)
 {
-    Q_ASSERT(mMethod == OutOfProcess);
+    // Not asserting the method here: setMethod() may have switched it while
+    // this request was on its way, the shutdown it started waits for us
     watcher->deleteLater();
     QDBusPendingReply<bool> reply = *watcher;
     // Most probably we requested an explicit backend that is different than the
@@ -337,7 +670,7 @@ void BackendManager::onBackendRequestDone(QDBusPendingCallWatcher *watcher)
         invalidateInterface();
     }
     mInterface = new org::kde::kscreen::Backend(QStringLiteral("org.kde.KScreen"),
-                                                QStringLiteral("/backend"),
+                                                backendObjectPath(mBackendArguments),
                                                 QDBusConnection::sessionBus());
     if (!mInterface->isValid()) {
         qCWarning(KSCREEN) << "Backend successfully requested, but we failed to obtain a valid DBus interface for it";
@@ -346,12 +679,18 @@ void BackendManager::onBackendRequestDone(QDBusPendingCallWatcher *watcher)
         return;
     }
 
+    // Answer the pending requests, the launcher gets stopped right after
+    if (mShuttingDown) {
+        emitBackendReady();
+        return;
+    }
+
     // The backend is GO, so let's watch for it's possible disappearance, so we
     // can invalidate the interface
     mServiceWatcher.addWatchedService(mBackendService);
 
     // Immediatelly request config
-    connect(new GetConfigOperation(GetConfigOperation::NoEDID), &GetConfigOperation::finished,
+    connect(new GetConfigOperation(mContext, GetConfigOperation::NoEDID), &GetConfigOperation::finished,
             [&](ConfigOperation *op) {
                 mConfig = qobject_cast<GetConfigOperation*>(op)->config();
                 emitBackendReady();
@@ -359,8 +698,48 @@ void BackendManager::onBackendRequestDone(QDBusPendingCallWatcher *watcher)
     // And listen for its change.
     connect(mInterface, &org::kde::kscreen::Backend::configChanged,
             [&](const QVariantMap &newConfig) {
+                // Sent for older clients, configUpdated() brings the change
+                if (newConfig.value(QStringLiteral("updated")).toBool()) {
+                    return;
+                }
                 mConfig = KScreen::ConfigSerializer::deserializeConfig(newConfig);
             });
+    connect(mInterface, &org::kde::kscreen::Backend::configUpdated,
+            this, &BackendManager::backendConfigUpdated);
+}
+
+void BackendManager::backendConfigUpdated(const QVariantMap &changesMap)
+{
+    // The config is still on its way, it will include the changes
+    if (!mConfig) {
+        return;
+    }
+
+    // The changed outputs and screen come in the format of a config
+    const ConfigPtr changes = ConfigSerializer::deserializeConfig(changesMap);
+    if (!changes) {
+        qCWarning(KSCREEN) << "Failed to deserialize config from DBus update notification";
+        return;
+    }
+
+    const QVariant removedValue = changesMap.value(QStringLiteral("removedOutputs"));
+    const QVariantList removedList = removedValue.userType() == qMetaTypeId<QDBusArgument>()
+                                        ? qdbus_cast<QVariantList>(removedValue.value<QDBusArgument>())
+                                        : removedValue.toList();
+    Q_FOREACH (const QVariant &outputId, removedList) {
+        mConfig->removeOutput(outputId.toInt());
+    }
+    Q_FOREACH (const OutputPtr &output, changes->outputs()) {
+        const OutputPtr current = mConfig->output(output->id());
+        if (current) {
+            current->apply(output);
+        } else {
+            mConfig->addOutput(output);
+        }
+    }
+    if (changes->screen() && mConfig->screen()) {
+        mConfig->screen()->apply(changes->screen());
+    }
 }
 
 void BackendManager::backendServiceUnregistered(const QString &serviceName)
@@ -374,7 +753,6 @@ void BackendManager::backendServiceUnregistered(const QString &serviceName)
 
 void BackendManager::invalidateInterface()
 {
-    Q_ASSERT(mMethod == OutOfProcess);
     delete mInterface;
     mInterface = 0;
     mBackendService.clear();
@@ -394,36 +772,135 @@ void BackendManager::setConfig(ConfigPtr c)
 void BackendManager::shutdownBackend()
 {
     if (mMethod == InProcess) {
-        delete mLoader;
-        mLoader = nullptr;
-        m_inProcessBackend.second.clear();
-        delete m_inProcessBackend.first;
-        m_inProcessBackend.first = nullptr;
-    } else {
+        shutdownInProcessBackend();
+        return;
+    }
 
-        if (mBackendService.isEmpty() && !mInterface) {
-            return;
-        }
+    if (!mShuttingDown && !mInterface && mRequestsCounter == 0) {
+        return;
+    }
 
-        // If there are some currently pending requests, then wait for them to
-        // finish before quitting
-        while (mRequestsCounter > 0) {
-            mShutdownLoop.exec();
-        }
+    QEventLoop loop;
+    connect(this, &BackendManager::shutdownFinished,
+            &loop, &QEventLoop::quit);
+    shutdownBackendAsync();
+    if (mShuttingDown) {
+        loop.exec(QEventLoop::ExcludeUserInputEvents);
+    }
+}
 
-        mServiceWatcher.removeWatchedService(mBackendService);
-        mShuttingDown = true;
+void BackendManager::shutdownBackendAsync(int timeout)
+{
+    if (mMethod == InProcess) {
+        shutdownInProcessBackend();
+        QMetaObject::invokeMethod(this, "shutdownFinished", Qt::QueuedConnection);
+        return;
+    }
 
-        QDBusMessage call = QDBusMessage::createMethodCall(QStringLiteral("org.kde.KScreen"),
-                                                        QStringLiteral("/"),
-                                                        QStringLiteral("org.kde.KScreen"),
-                                                        QStringLiteral("quit"));
-        // Call synchronously
-        QDBusConnection::sessionBus().call(call);
-        invalidateInterface();
+    if (mShuttingDown) {
+        return;
+    }
+
+    if (!mInterface && mRequestsCounter == 0) {
+        QMetaObject::invokeMethod(this, "shutdownFinished", Qt::QueuedConnection);
+        return;
+    }
+
+    mShuttingDown = true;
+    mShutdownTimer.start(timeout);
+
+    // If there are some currently pending requests, then wait for them to
+    // finish before quitting, emitBackendReady() continues from there
+    if (mRequestsCounter > 0) {
+        return;
+    }
+    quitLauncher();
+}
+
+bool BackendManager::isShuttingDown() const
+{
+    return mShuttingDown;
+}
 
-        while (QDBusConnection::sessionBus().interface()->isServiceRegistered(QStringLiteral("org.kde.KScreen"))) {
-            QThread::msleep(100);
+void BackendManager::quitLauncher()
+{
+    mServiceWatcher.removeWatchedService(mBackendService);
+    invalidateInterface();
+
+    // Watch before asking, so that we can't miss the launcher going away
+    const QString launcher = QStringLiteral("org.kde.KScreen");
+    mLauncherWatcher.addWatchedService(launcher);
+
+    QDBusMessage call = QDBusMessage::createMethodCall(launcher,
+                                                       QStringLiteral("/"),
+                                                       launcher,
+                                                       QStringLiteral("quit"));
+    // Don't start a launcher only to stop it again
+    call.setAutoStartService(false);
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(QDBusConnection::sessionBus().asyncCall(call), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished,
+            this, &BackendManager::onQuitDone);
+}
+
+void BackendManager::onQuitDone(QDBusPendingCallWatcher *watcher)
+{
+    watcher->deleteLater();
+    const QDBusPendingReply<> reply = *watcher;
+    if (!reply.isError()) {
+        // Now wait for the launcher to leave the bus
+        return;
+    }
+
+    // The launcher is not running (anymore), so there is nothing to wait for
+    if (reply.error().type() != QDBusError::ServiceUnknown) {
+        qCWarning(KSCREEN) << "Failed to stop backend launcher:" << reply.error().message();
+    }
+    if (!QDBusConnection::sessionBus().interface()->isServiceRegistered(QStringLiteral("org.kde.KScreen"))) {
+        finishShutdown();
+    }
+}
+
+void BackendManager::finishShutdown()
+{
+    if (!mShuttingDown) {
+        return;
+    }
+    mShutdownTimer.stop();
+    mLauncherWatcher.removeWatchedService(QStringLiteral("org.kde.KScreen"));
+    mShuttingDown = false;
+
+    Q_EMIT shutdownFinished();
+
+    if (mRequestAfterShutdown) {
+        mRequestAfterShutdown = false;
+        if (mMethod == OutOfProcess) {
+            requestBackend();
+        }
+    }
+}
+
+void BackendManager::shutdownInProcessBackend()
+{
+    if (mBackendThread) {
+        // Let the backend finish what was already queued for it, then pull
+        // it back to this thread, so that it can be deleted here
+        QThread *thread = QThread::currentThread();
+        if (m_inProcessBackend.first) {
+            KScreen::AbstractBackend *backend = m_inProcessBackend.first;
+            invokeInThread(backend, [backend, thread]() {
+                backend->moveToThread(thread);
+                QThread::currentThread()->quit();
+            });
+        } else {
+            mBackendThread->quit();
         }
+        mBackendThread->wait();
+        delete mBackendThread;
+        mBackendThread = Q_NULLPTR;
     }
+    delete mLoader;
+    mLoader = nullptr;
+    m_inProcessBackend.second.clear();
+    delete m_inProcessBackend.first;
+    m_inProcessBackend.first = nullptr;
 }
@@ -32,18 +32,24 @@
 #include <QProcess>
 #include <QDBusServiceWatcher>
 #include <QFileInfoList>
+#include <QStringList>
+#include <QVector>
 #include <QTimer>
 #include <QEventLoop>
 
+#include <functional>
+
 #include "types.h"
 #include "kscreen_export.h"
 
 class QDBusPendingCallWatcher;
+class QThread;
 class OrgKdeKscreenBackendInterface;
 
 namespace KScreen {
 
 class AbstractBackend;
+class Context;
 
 class KSCREEN_EXPORT BackendManager : public QObject
 {
@@ -55,9 +61,62 @@ public:
         OutOfProcess
     };
 
+    /** The backend manager of the default context
+     *
+     * @see Context::defaultContext()
+     */
     static BackendManager *instance();
     ~BackendManager();
 
+    /** Metadata of an installed backend plugin
+     *
+     * This is read from the JSON metadata of the plugin, the plugin itself is
+     * not loaded for it.
+     *
+     * @since 5.12
+     */
+    struct BackendInfo {
+        /** The plugin file */
+        QFileInfo file;
+        /** Name of the backend, as passed in KSCREEN_BACKEND */
+        QString name;
+        /** Platforms (QGuiApplication::platformName()) the backend is picked for by default */
+        QStringList platforms;
+        /** Optional features the backend supports */
+        QStringList features;
+        /** Whether the backend needs a QGuiApplication */
+        bool requiresGui = false;
+        /** For backends linked in statically, null otherwise. Their file is
+         * not a real one, it only carries the usual KSC_ name. */
+        QtPluginInstanceFunction staticInstance = nullptr;
+    };
+
+    /** The context this manager belongs to
+     * @since 5.12
+     */
+    KScreen::Context *context() const;
+
+    /** Name of the backend to load
+     *
+     * This is the backend the context asked for or, for contexts which
+     * did not ask for any specific backend, the KSCREEN_BACKEND env var.
+     *
+     * @return name of the backend, empty to use the preferred backend
+     * @since 5.12
+     */
+    QString backendName() const;
+
+    /** Arguments to pass to the backend
+     *
+     * These are the arguments the context was created with or, for contexts
+     * which did not ask for any specific backend, the KSCREEN_BACKEND_ARGS
+     * env var.
+     *
+     * @return arguments for AbstractBackend::init()
+     * @since 5.12
+     */
+    QVariantMap backendArguments() const;
+
     KScreen::ConfigPtr config() const;
     void setConfig(KScreen::ConfigPtr c);
 
@@ -65,11 +124,13 @@ public:
      *
      * This method uses a couple of heuristics to pick the backend to be loaded:
      * - If the @p backend argument is specified and not empty it's used to filter the
-     *   available backend list
+     *   available backend list by name
      * - If specified, the KSCREEN_BACKEND env var is considered (case insensitive)
-     * - Otherwise, the wayland backend is picked when the runtime platform is Wayland
-     *   (we assume kwin in this case
-     * - Otherwise, if the runtime platform is X11, the XRandR backend is picked
+     * - Otherwise, the first backend listing the runtime platform in the "Platforms"
+     *   key of its metadata is picked: KWayland on Wayland (we assume kwin in this
+     *   case), XRandR on X11
+     * - Without a QGuiApplication the platform is guessed from QT_QPA_PLATFORM,
+     *   XDG_SESSION_TYPE, WAYLAND_DISPLAY and DISPLAY
      * - If neither is the case, we fall back to the QScreen backend, since that is the
      *   most generally applicable and may work on platforms not explicitely supported
      *
@@ -84,6 +145,41 @@ public:
      */
     static QFileInfoList listBackends();
 
+    /** Index of the available backends
+     *
+     * The index of installed plugins is built once per process from their
+     * metadata and rebuilt only when QCoreApplication::libraryPaths() changes or
+     * one of the plugin directories gets modified, i.e. plugins were added or
+     * removed. Backends linked in statically (Q_IMPORT_PLUGIN) come first.
+     *
+     * @return metadata of all available backends
+     * @since 5.12
+     */
+    static QVector<BackendInfo> backendIndex();
+
+    /** Whether a backend needs a QGuiApplication to work
+     *
+     * Backends declare this as "RequiresGui" in their plugin metadata. The
+     * plugin is not loaded to find out.
+     *
+     * @param plugin the backend plugin, as returned by preferredBackend()
+     * @return true if the backend can only be loaded in a QGuiApplication
+     * @since 5.12
+     */
+    static bool backendRequiresGui(const QFileInfo &plugin);
+
+    /** DBus object path of the backend serving the given arguments
+     *
+     * The backend launcher can serve several displays at once. Backends
+     * for the default display are exported at /backend, backends requested
+     * with a "DISPLAY" argument get a path of their own.
+     *
+     * @param arguments the arguments the backend was requested with
+     * @return object path of the backend in the launcher
+     * @since 5.12
+     */
+    static QString backendObjectPath(const QVariantMap &arguments);
+
     /** Encapsulates the plugin loading logic.
      *
      * @param loader a pointer to the QPluginLoader, the caller is
@@ -102,19 +198,86 @@ public:
     BackendManager::Method method() const;
     void setMethod(BackendManager::Method m);
 
+    /** Whether in-process backends run on a thread of their own
+     *
+     * A threaded backend does not block the thread using it while it applies
+     * or reads a configuration, operations talking to it complete
+     * asynchronously. Backends which require a QGuiApplication always run on
+     * the main thread.
+     *
+     * Setting KSCREEN_BACKEND_INPROCESS=threaded selects in-process operation
+     * with a threaded backend.
+     *
+     * @return true if in-process backends are moved to a worker thread
+     * @since 5.12
+     */
+    bool isThreaded() const;
+
+    /** Choose whether in-process backends run on a thread of their own
+     *
+     * A running in-process backend is shut down when this changes.
+     *
+     * @param threaded true to run the backend on a worker thread
+     * @since 5.12
+     */
+    void setThreaded(bool threaded);
+
+    /** Runs @p function in the thread @p receiver lives in
+     *
+     * The call is queued behind all events already posted to that thread and
+     * is dropped if @p receiver gets destroyed before.
+     *
+     * @since 5.12
+     */
+    static void invokeInThread(const QObject *receiver, const std::function<void()> &function);
+
     // For out-of-process operation
     void requestBackend();
+
+    /** Shuts the backend down and waits until it's gone
+     *
+     * This spins an event loop until shutdownBackendAsync() has finished.
+     */
     void shutdownBackend();
 
+    /** Shuts the backend down without blocking
+     *
+     * An in-process backend is deleted right away. Out-of-process, requests
+     * which are still pending are answered first, then the backend launcher
+     * is asked to quit and is given up to @p timeout milliseconds to leave
+     * the bus. Backend requests made in the meantime are served by a new
+     * launcher once the old one is gone.
+     *
+     * shutdownFinished() is emitted when done, also when there was no
+     * backend to shut down.
+     *
+     * @param timeout how long to wait for the launcher to quit, in milliseconds
+     * @since 5.12
+     */
+    void shutdownBackendAsync(int timeout = 5000);
+
+    /** Whether shutdownBackendAsync() is still waiting for the backend
+     * @since 5.12
+     */
+    bool isShuttingDown() const;
+
 Q_SIGNALS:
     void backendReady(OrgKdeKscreenBackendInterface *backend);
 
+    /** Emitted when shutdownBackendAsync() is done
+     * @since 5.12
+     */
+    void shutdownFinished();
+
 private Q_SLOTS:
     void emitBackendReady();
+    void onQuitDone(QDBusPendingCallWatcher *watcher);
+    void finishShutdown();
 
     void startBackend(const QString &backend = QString(),
                       const QVariantMap &arguments = QVariantMap());
     void onBackendRequestDone(QDBusPendingCallWatcher *watcher);
+    void backendConfigUpdated(const QVariantMap &changes);
 
     void backendServiceUnregistered(const QString &serviceName);
 
@@ -123,31 +286,43 @@ private:
     friend class InProcessConfigOperationPrivate;
     friend class SetConfigOperation;
     friend class SetConfigOperationPrivate;
+    friend class Context;
+
+    explicit BackendManager(KScreen::Context *context);
 
-    explicit BackendManager();
-    static BackendManager *sInstance;
+    static BackendInfo preferredBackendInfo(const QString &backend);
+    static QVector<BackendInfo> staticBackends();
+    static QVector<BackendInfo> installedBackends();
 
     void initMethod();
+    void shutdownInProcessBackend();
+    void quitLauncher();
 
     // For out-of-process operation
     void invalidateInterface();
     void backendServiceReady();
 
     static const int sMaxCrashCount;
+    KScreen::Context *mContext;
     OrgKdeKscreenBackendInterface *mInterface;
     int mCrashCount;
 
     QString mBackendService;
+    QVariantMap mBackendArguments;
     QDBusServiceWatcher mServiceWatcher;
     KScreen::ConfigPtr mConfig;
     QTimer mResetCrashCountTimer;
     bool mShuttingDown;
+    bool mRequestAfterShutdown;
     int mRequestsCounter;
-    QEventLoop mShutdownLoop;
+    QDBusServiceWatcher mLauncherWatcher;
+    QTimer mShutdownTimer;
 
     // For in-process operation
     QPluginLoader *mLoader;
     QPair<KScreen::AbstractBackend*, QVariantMap> m_inProcessBackend;
+    QThread *mBackendThread;
+    bool mThreaded;
 
     Method mMethod;
 };
@@ -22,6 +22,7 @@
 #include "backendmanager_p.h"
 #include "abstractbackend.h"
 #include "debug_p.h"
+#include "usdt_p.h"
 
 #include <QtCore/QDebug>
 #include <QtCore/QRect>
@@ -340,6 +341,7 @@ void Config::setValid(bool valid)
 
 void Config::apply(const ConfigPtr& other)
 {
+    KSCREEN_PROBE3(config_apply_entry, this, d->outputs.count(), other->d->outputs.count());
     d->screen->apply(other->screen());
 
     // Remove removed outputs
@@ -361,6 +363,7 @@ void Config::apply(const ConfigPtr& other)
 
     // Update validity
     setValid(other->isValid());
+    KSCREEN_PROBE2(config_apply_return, this, d->outputs.count());
 }
 
 #include "config.moc"
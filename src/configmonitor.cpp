@@ -20,11 +20,19 @@
 #include "backendmanager_p.h"
 #include "backendinterface.h"
 #include "abstractbackend.h"
+#include "config.h"
 #include "configserializer_p.h"
 #include "getconfigoperation.h"
+#include "context.h"
 #include "debug_p.h"
+#include "log.h"
 #include "output.h"
+#include "screen.h"
+#include "tracelog_p.h"
+#include "tracing_p.h"
+#include "usdt_p.h"
 
+#include <QDBusArgument>
 #include <QDBusPendingCallWatcher>
 
 using namespace KScreen;
@@ -35,15 +43,19 @@ class ConfigMonitor::Private : public QObject
       Q_OBJECT
 
 public:
-    Private(ConfigMonitor *q);
+    Private(ConfigMonitor *q, Context *context);
 
     void updateConfigs();
     void onBackendReady(org::kde::kscreen::Backend *backend);
     void backendConfigChanged(const QVariantMap &config);
+    void backendConfigUpdated(const QVariantMap &changes);
     void configDestroyed(QObject* removedConfig);
     void getConfigFinished(ConfigOperation *op);
     void updateConfigs(const KScreen::ConfigPtr &newConfig);
+    void applyChanges(const KScreen::ConfigPtr &changes, const QList<int> &removedOutputs);
+    void requestEdid(const KScreen::ConfigPtr &config, int outputId);
     void edidReady(QDBusPendingCallWatcher *watcher);
+    void recordTrace(QVariantMap stamps);
 
     QList<QWeakPointer<KScreen::Config>>  watchedConfigs;
 
@@ -51,20 +63,37 @@ public:
     bool mFirstBackend;
 
     QMap<KScreen::ConfigPtr, QList<int>> mPendingEDIDRequests;
+    // Configs holding incremental changes rather than a full config, with
+    // the IDs of the outputs removed by the change
+    QMap<KScreen::ConfigPtr, QList<int>> mIncrementalChanges;
+
+    static const int s_histogramSize = 32;
+    QVector<int> mHistograms[TotalLatency + 1];
+    qint64 mLastLatencies[TotalLatency + 1];
+
+    // Last config written to the TraceLog
+    QJsonObject mTracedConfig;
+
+    Context * const context;
 private:
     ConfigMonitor *q;
 };
 
-ConfigMonitor::Private::Private(ConfigMonitor *q)
+ConfigMonitor::Private::Private(ConfigMonitor *q, Context *context)
     : QObject(q)
     , mFirstBackend(true)
+    , context(context)
     , q(q)
 {
+    for (int i = BackendLatency; i <= TotalLatency; ++i) {
+        mHistograms[i].fill(0, s_histogramSize);
+        mLastLatencies[i] = -1;
+    }
 }
 
 void ConfigMonitor::Private::onBackendReady(org::kde::kscreen::Backend *backend)
 {
-    Q_ASSERT(BackendManager::instance()->method() == BackendManager::OutOfProcess);
+    Q_ASSERT(context->backendManager()->method() == BackendManager::OutOfProcess);
     if (backend == mBackend) {
         return;
     }
@@ -72,6 +101,8 @@ void ConfigMonitor::Private::onBackendReady(org::kde::kscreen::Backend *backend)
     if (mBackend) {
         disconnect(mBackend.data(), &org::kde::kscreen::Backend::configChanged,
                    this, &ConfigMonitor::Private::backendConfigChanged);
+        disconnect(mBackend.data(), &org::kde::kscreen::Backend::configUpdated,
+                   this, &ConfigMonitor::Private::backendConfigUpdated);
     }
 
     mBackend = QPointer<org::kde::kscreen::Backend>(backend);
@@ -84,19 +115,21 @@ void ConfigMonitor::Private::onBackendReady(org::kde::kscreen::Backend *backend)
     // the result will be invalid. This can happen when KScreen KDED launches and
     // detects changes need to be done.
     if (!mFirstBackend && !watchedConfigs.isEmpty()) {
-        connect(new GetConfigOperation(), &GetConfigOperation::finished,
+        connect(new GetConfigOperation(context), &GetConfigOperation::finished,
                 this, &Private::getConfigFinished);
     }
     mFirstBackend = false;
 
     connect(mBackend.data(), &org::kde::kscreen::Backend::configChanged,
             this, &ConfigMonitor::Private::backendConfigChanged);
+    connect(mBackend.data(), &org::kde::kscreen::Backend::configUpdated,
+            this, &ConfigMonitor::Private::backendConfigUpdated);
 
 }
 
 void ConfigMonitor::Private::getConfigFinished(ConfigOperation* op)
 {
-    Q_ASSERT(BackendManager::instance()->method() == BackendManager::OutOfProcess);
+    Q_ASSERT(context->backendManager()->method() == BackendManager::OutOfProcess);
     if (op->hasError()) {
         qCWarning(KSCREEN) << "Failed to retrieve current config: " << op->errorString();
         return;
@@ -108,22 +141,27 @@ void ConfigMonitor::Private::getConfigFinished(ConfigOperation* op)
 
 void ConfigMonitor::Private::backendConfigChanged(const QVariantMap &configMap)
 {
-    Q_ASSERT(BackendManager::instance()->method() == BackendManager::OutOfProcess);
+    Q_ASSERT(context->backendManager()->method() == BackendManager::OutOfProcess);
+    // Sent for older clients, we got the same change from configUpdated()
+    if (configMap.value(QStringLiteral("updated")).toBool()) {
+        return;
+    }
+
+    QVariantMap stamps = Tracing::fromVariant(configMap.value(QStringLiteral("trace")));
+    if (!stamps.isEmpty()) {
+        Tracing::setStamp(stamps, Tracing::Received);
+    }
+
     ConfigPtr newConfig = ConfigSerializer::deserializeConfig(configMap);
     if (!newConfig) {
         qCWarning(KSCREEN) << "Failed to deserialize config from DBus change notification";
         return;
     }
+    Tracing::setStamps(newConfig, stamps);
 
     Q_FOREACH (OutputPtr output, newConfig->connectedOutputs()) {
         if (!output->edid() && output->isConnected()) {
-            QDBusPendingReply<QByteArray> reply = mBackend->getEdid(output->id());
-            mPendingEDIDRequests[newConfig].append(output->id());
-            QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(reply);
-            watcher->setProperty("outputId", output->id());
-            watcher->setProperty("config", QVariant::fromValue(newConfig));
-            connect(watcher, &QDBusPendingCallWatcher::finished,
-                    this, &ConfigMonitor::Private::edidReady);
+            requestEdid(newConfig, output->id());
         }
     }
 
@@ -134,9 +172,69 @@ void ConfigMonitor::Private::backendConfigChanged(const QVariantMap &configMap)
     }
 }
 
+void ConfigMonitor::Private::backendConfigUpdated(const QVariantMap &changesMap)
+{
+    Q_ASSERT(context->backendManager()->method() == BackendManager::OutOfProcess);
+    QVariantMap stamps = Tracing::fromVariant(changesMap.value(QStringLiteral("trace")));
+    if (!stamps.isEmpty()) {
+        Tracing::setStamp(stamps, Tracing::Received);
+    }
+
+    // The changed outputs and screen come in the format of a config
+    ConfigPtr changes = ConfigSerializer::deserializeConfig(changesMap);
+    if (!changes) {
+        qCWarning(KSCREEN) << "Failed to deserialize config from DBus update notification";
+        return;
+    }
+    Tracing::setStamps(changes, stamps);
+
+    const QVariant removedValue = changesMap.value(QStringLiteral("removedOutputs"));
+    const QVariantList removedList = removedValue.userType() == qMetaTypeId<QDBusArgument>()
+                                        ? qdbus_cast<QVariantList>(removedValue.value<QDBusArgument>())
+                                        : removedValue.toList();
+    QList<int> removedOutputs;
+    Q_FOREACH (const QVariant &outputId, removedList) {
+        removedOutputs << outputId.toInt();
+    }
+    mIncrementalChanges.insert(changes, removedOutputs);
+
+    // Outputs the watched configs already know keep their EDID, only the
+    // ones that just appeared or got connected need it
+    KScreen::ConfigPtr known;
+    Q_FOREACH (const QWeakPointer<Config> &weakConfig, watchedConfigs) {
+        known = weakConfig.toStrongRef();
+        if (known) {
+            break;
+        }
+    }
+    Q_FOREACH (OutputPtr output, changes->connectedOutputs()) {
+        const OutputPtr knownOutput = known ? known->output(output->id()) : OutputPtr();
+        if (!output->edid() && (!knownOutput || !knownOutput->isConnected() || !knownOutput->edid())) {
+            requestEdid(changes, output->id());
+        }
+    }
+
+    if (mPendingEDIDRequests.contains(changes)) {
+        qCDebug(KSCREEN) << "Requesting missing EDID for outputs" << mPendingEDIDRequests[changes];
+    } else {
+        applyChanges(changes, mIncrementalChanges.take(changes));
+    }
+}
+
+void ConfigMonitor::Private::requestEdid(const KScreen::ConfigPtr &config, int outputId)
+{
+    QDBusPendingReply<QByteArray> reply = mBackend->getEdid(outputId);
+    mPendingEDIDRequests[config].append(outputId);
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(reply);
+    watcher->setProperty("outputId", outputId);
+    watcher->setProperty("config", QVariant::fromValue(config));
+    connect(watcher, &QDBusPendingCallWatcher::finished,
+            this, &ConfigMonitor::Private::edidReady);
+}
+
 void ConfigMonitor::Private::edidReady(QDBusPendingCallWatcher* watcher)
 {
-    Q_ASSERT(BackendManager::instance()->method() == BackendManager::OutOfProcess);
+    Q_ASSERT(context->backendManager()->method() == BackendManager::OutOfProcess);
 
     const int outputId = watcher->property("outputId").toInt();
     const ConfigPtr config = watcher->property("config").value<KScreen::ConfigPtr>();
@@ -152,6 +250,7 @@ void ConfigMonitor::Private::edidReady(QDBusPendingCallWatcher* watcher)
         qCWarning(KSCREEN) << "Error when retrieving EDID: " << reply.error().message();
     } else {
         const QByteArray edid = reply.argumentAt<0>();
+        KSCREEN_PROBE2(edid_received, outputId, edid.size());
         if (!edid.isEmpty()) {
             OutputPtr output = config->output(outputId);
             output->setEdid(edid);
@@ -160,14 +259,17 @@ void ConfigMonitor::Private::edidReady(QDBusPendingCallWatcher* watcher)
 
     if (mPendingEDIDRequests[config].isEmpty()) {
         mPendingEDIDRequests.remove(config);
-        updateConfigs(config);
+        if (mIncrementalChanges.contains(config)) {
+            applyChanges(config, mIncrementalChanges.take(config));
+        } else {
+            updateConfigs(config);
+        }
     }
 }
 
 
 void ConfigMonitor::Private::updateConfigs(const KScreen::ConfigPtr &newConfig)
 {
-    Q_ASSERT(BackendManager::instance()->method() == BackendManager::OutOfProcess);
     QMutableListIterator<QWeakPointer<Config>> iter(watchedConfigs);
     while (iter.hasNext()) {
         KScreen::ConfigPtr config = iter.next().toStrongRef();
@@ -180,9 +282,99 @@ void ConfigMonitor::Private::updateConfigs(const KScreen::ConfigPtr &newConfig)
         iter.setValue(config.toWeakRef());
     }
 
+    TraceLog *trace = TraceLog::instance();
+    if (trace->isEnabled()) {
+        const QJsonObject serialized = ConfigSerializer::serializeConfig(newConfig);
+        trace->recordConfig(TraceLog::ConfigChanged, QStringLiteral("monitor"), mTracedConfig, serialized);
+        mTracedConfig = serialized;
+    }
+
+    recordTrace(Tracing::takeStamps(newConfig));
+    Q_EMIT q->configurationChanged();
+}
+
+void ConfigMonitor::Private::applyChanges(const KScreen::ConfigPtr &changes, const QList<int> &removedOutputs)
+{
+    KScreen::ConfigPtr updated;
+    QMutableListIterator<QWeakPointer<Config>> iter(watchedConfigs);
+    while (iter.hasNext()) {
+        KScreen::ConfigPtr config = iter.next().toStrongRef();
+        if (!config) {
+            iter.remove();
+            continue;
+        }
+
+        Q_FOREACH (int outputId, removedOutputs) {
+            config->removeOutput(outputId);
+        }
+        Q_FOREACH (const OutputPtr &output, changes->outputs()) {
+            const OutputPtr current = config->output(output->id());
+            if (!current) {
+                config->addOutput(output->clone());
+            } else if (current != output) {
+                current->apply(output);
+            }
+        }
+        if (changes->screen() && config->screen() && config->screen() != changes->screen()) {
+            config->screen()->apply(changes->screen());
+        }
+        if (!updated) {
+            updated = config;
+        }
+    }
+
+    TraceLog *trace = TraceLog::instance();
+    if (trace->isEnabled() && updated) {
+        const QJsonObject serialized = ConfigSerializer::serializeConfig(updated);
+        trace->recordConfig(TraceLog::ConfigChanged, QStringLiteral("monitor"), mTracedConfig, serialized);
+        mTracedConfig = serialized;
+    }
+
+    recordTrace(Tracing::takeStamps(changes));
     Q_EMIT q->configurationChanged();
 }
 
+void ConfigMonitor::Private::recordTrace(QVariantMap stamps)
+{
+    if (stamps.isEmpty()) {
+        for (int i = BackendLatency; i <= TotalLatency; ++i) {
+            mLastLatencies[i] = -1;
+        }
+        return;
+    }
+    Tracing::setStamp(stamps, Tracing::Delivered);
+
+    static const Tracing::Stamp stageBounds[][2] = {
+        { Tracing::Origin, Tracing::Backend },      // BackendLatency
+        { Tracing::Backend, Tracing::Launcher },    // LauncherLatency
+        { Tracing::Launcher, Tracing::Received },   // TransportLatency
+        { Tracing::Received, Tracing::Delivered },  // ClientLatency
+        { Tracing::Origin, Tracing::Delivered }     // TotalLatency
+    };
+    static const char *const names[] = { "backend", "launcher", "transport", "client", "total" };
+    QString line;
+    for (int i = BackendLatency; i <= TotalLatency; ++i) {
+        const qint64 from = Tracing::stampValue(stamps, stageBounds[i][0]);
+        const qint64 to = Tracing::stampValue(stamps, stageBounds[i][1]);
+        const qint64 latency = (from < 0 || to < 0) ? -1 : qMax<qint64>(to - from, 0);
+        mLastLatencies[i] = latency;
+        if (latency >= 0) {
+            int bucket = 0;
+            while (bucket < s_histogramSize - 1 && (latency >> bucket) > 0) {
+                ++bucket;
+            }
+            ++mHistograms[i][bucket];
+        }
+        line += QStringLiteral("%1%2=%3").arg(line.isEmpty() ? QString() : QStringLiteral(" "),
+                                              QString::fromLatin1(names[i]),
+                                              latency < 0 ? QStringLiteral("-") : QString::number(latency));
+    }
+
+    if (Log::instance()->enabled()) {
+        Log::log(line, QStringLiteral("kscreen.latency"));
+    }
+}
+
 void ConfigMonitor::Private::configDestroyed(QObject *removedConfig)
 {
     for (auto iter = watchedConfigs.begin(); iter != watchedConfigs.end(); ++iter) {
@@ -195,23 +387,18 @@ void ConfigMonitor::Private::configDestroyed(QObject *removedConfig)
 
 ConfigMonitor *ConfigMonitor::instance()
 {
-    static ConfigMonitor *s_instance = Q_NULLPTR;
-
-    if (s_instance == 0) {
-        s_instance = new ConfigMonitor();
-    }
-
-    return s_instance;
+    return Context::defaultContext()->configMonitor();
 }
 
-ConfigMonitor::ConfigMonitor():
+ConfigMonitor::ConfigMonitor(Context *context):
     QObject(),
-    d(new Private(this))
+    d(new Private(this, context))
 {
-    if (BackendManager::instance()->method() == BackendManager::OutOfProcess) {
-        connect(BackendManager::instance(), &BackendManager::backendReady,
+    BackendManager *manager = context->backendManager();
+    if (manager->method() == BackendManager::OutOfProcess) {
+        connect(manager, &BackendManager::backendReady,
                 d, &ConfigMonitor::Private::onBackendReady);
-        BackendManager::instance()->requestBackend();
+        manager->requestBackend();
     }
 }
 
@@ -220,6 +407,11 @@ ConfigMonitor::~ConfigMonitor()
     delete d;
 }
 
+Context *ConfigMonitor::context() const
+{
+    return d->context;
+}
+
 void ConfigMonitor::addConfig(const ConfigPtr &config)
 {
     const QWeakPointer<Config> weakConfig = config.toWeakRef();
@@ -240,15 +432,108 @@ void ConfigMonitor::removeConfig(const ConfigPtr &config)
     }
 }
 
+QVector<int> ConfigMonitor::latencyHistogram(LatencyStage stage) const
+{
+    if (stage < BackendLatency || stage > TotalLatency) {
+        return QVector<int>();
+    }
+    return d->mHistograms[stage];
+}
+
+qint64 ConfigMonitor::lastLatency(LatencyStage stage) const
+{
+    if (stage < BackendLatency || stage > TotalLatency) {
+        return -1;
+    }
+    return d->mLastLatencies[stage];
+}
+
+void ConfigMonitor::resetLatencyStatistics()
+{
+    for (int i = BackendLatency; i <= TotalLatency; ++i) {
+        d->mHistograms[i].fill(0);
+        d->mLastLatencies[i] = -1;
+    }
+}
+
+// Stamps of a change emitted by an in-process backend, which is received
+// right away
+static QVariantMap inProcessStamps(const KScreen::ConfigPtr &config)
+{
+    QVariantMap stamps = Tracing::takeStamps(config);
+    const qint64 now = Tracing::now();
+    if (stamps.isEmpty()) {
+        Tracing::setStamp(stamps, Tracing::Origin, now);
+        Tracing::setStamp(stamps, Tracing::Backend, now);
+    }
+    Tracing::setStamp(stamps, Tracing::Received, now);
+    return stamps;
+}
+
 void ConfigMonitor::connectInProcessBackend(KScreen::AbstractBackend* backend)
 {
-    Q_ASSERT(BackendManager::instance()->method() == BackendManager::InProcess);
+    Q_ASSERT(d->context->backendManager()->method() == BackendManager::InProcess);
+    const bool threaded = backend->thread() != thread();
+
+    // Incremental changes are applied to the watched configs as they come,
+    // there is no launcher collecting them. Objects of a threaded backend are
+    // copied on its thread, like its configs.
+    auto forwardChanges = [=](const KScreen::OutputPtr &output, const KScreen::ScreenPtr &screen,
+                              const QList<int> &removedOutputs) {
+        const KScreen::ConfigPtr changes(new KScreen::Config);
+        if (output) {
+            Tracing::setStamps(changes, Tracing::takeStamps(output.data()));
+            changes->addOutput(threaded ? output->clone() : output);
+        }
+        if (screen) {
+            Tracing::setStamps(changes, Tracing::takeStamps(screen.data()));
+            changes->setScreen(threaded ? screen->clone() : screen);
+        }
+        Tracing::setStamps(changes, inProcessStamps(changes));
+        if (threaded) {
+            BackendManager::invokeInThread(d, [=]() {
+                d->applyChanges(changes, removedOutputs);
+            });
+        } else {
+            d->applyChanges(changes, removedOutputs);
+        }
+    };
+    connect(backend, &AbstractBackend::outputAdded, backend, [=](const KScreen::OutputPtr &output) {
+        forwardChanges(output, KScreen::ScreenPtr(), QList<int>());
+    }, Qt::DirectConnection);
+    connect(backend, &AbstractBackend::outputUpdated, backend, [=](const KScreen::OutputPtr &output) {
+        forwardChanges(output, KScreen::ScreenPtr(), QList<int>());
+    }, Qt::DirectConnection);
+    connect(backend, &AbstractBackend::outputRemoved, backend, [=](int outputId) {
+        forwardChanges(KScreen::OutputPtr(), KScreen::ScreenPtr(), QList<int>() << outputId);
+    }, Qt::DirectConnection);
+    connect(backend, &AbstractBackend::screenUpdated, backend, [=](const KScreen::ScreenPtr &screen) {
+        forwardChanges(KScreen::OutputPtr(), screen, QList<int>());
+    }, Qt::DirectConnection);
+
+    if (threaded) {
+        // The config emitted by a threaded backend keeps being modified on its
+        // thread, so take a copy there and apply it to the watched configs here
+        connect(backend, &AbstractBackend::configChanged, backend, [=](const KScreen::ConfigPtr &config) {
+            if (config.isNull()) {
+                return;
+            }
+            const KScreen::ConfigPtr copy = config->clone();
+            Tracing::setStamps(copy, inProcessStamps(config));
+            BackendManager::invokeInThread(d, [=]() {
+                d->updateConfigs(copy);
+            });
+        }, Qt::DirectConnection);
+        return;
+    }
+
     connect(backend, &AbstractBackend::configChanged, [=](KScreen::ConfigPtr config) {
         if (config.isNull()) {
             return;
         }
         const QWeakPointer<Config> weakConfig = config.toWeakRef();
         if (d->watchedConfigs.contains(weakConfig)) {
+            d->recordTrace(inProcessStamps(config));
             emit configurationChanged();
         }
     });
@@ -21,6 +21,7 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QPointer>
+#include <QtCore/QVector>
 
 #include "config.h"
 #include "kscreen_export.h"
@@ -30,27 +31,87 @@ namespace KScreen
 
 class AbstractBackend;
 class BackendManager;
+class Context;
 
 class KSCREEN_EXPORT ConfigMonitor : public QObject
 {
     Q_OBJECT
 
 public:
+    /**
+     * Stages a change notification passes on its way from the backend event
+     * that caused it to configurationChanged()
+     *
+     * @see latencyHistogram()
+     * @since 5.12
+     */
+    enum LatencyStage {
+        BackendLatency,     ///< from the event to the backend announcing the change
+        LauncherLatency,    ///< changes being collected in the backend launcher
+        TransportLatency,   ///< D-Bus delivery to this process
+        ClientLatency,      ///< deserializing and fetching EDIDs in this process
+        TotalLatency        ///< from the event to configurationChanged()
+    };
+    Q_ENUMS(LatencyStage)
+
+    /**
+     * @return the monitor of the default context
+     * @see Context::configMonitor()
+     */
     static ConfigMonitor* instance();
 
+    /**
+     * @return the context whose backend this monitor watches
+     * @since 5.12
+     */
+    KScreen::Context *context() const;
+
     void addConfig(const KScreen::ConfigPtr &config);
     void removeConfig(const KScreen::ConfigPtr &config);
 
+    /**
+     * Latencies of the change notifications seen by this monitor
+     *
+     * Bucket 0 counts latencies below 1 microsecond, bucket n the ones from
+     * 2^(n-1) up to 2^n microseconds. The last bucket also counts everything
+     * longer than that.
+     *
+     * Stages a notification did not pass are not counted, in-process backends
+     * for example have no launcher. With KSCREEN_LOGGING enabled, every
+     * notification is also written to the KScreen::Log with the category
+     * "kscreen.latency".
+     *
+     * @param stage the stage to return the histogram of
+     * @return 32 buckets of notification counts
+     * @since 5.12
+     */
+    QVector<int> latencyHistogram(LatencyStage stage) const;
+
+    /**
+     * @return the latency of @p stage of the last change notification in
+     *         microseconds, or -1 if it did not pass that stage or there was
+     *         no notification yet
+     * @since 5.12
+     */
+    qint64 lastLatency(LatencyStage stage) const;
+
+    /**
+     * Clears the latency histograms
+     * @since 5.12
+     */
+    void resetLatencyStatistics();
+
 Q_SIGNALS:
     void configurationChanged();
 
 private:
-    explicit ConfigMonitor();
+    explicit ConfigMonitor(KScreen::Context *context);
     virtual ~ConfigMonitor();
 
     Q_DISABLE_COPY(ConfigMonitor)
 
     friend BackendManager;
+    friend Context;
     void connectInProcessBackend(KScreen::AbstractBackend *backend);
 
     class Private;
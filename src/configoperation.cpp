@@ -21,36 +21,109 @@
 #include "configoperation.h"
 #include "configoperation_p.h"
 #include "backendmanager_p.h"
+#include "config.h"
+#include "context.h"
+#include "output.h"
 
 #include "debug_p.h"
+#include "log.h"
+#include "tracelog_p.h"
+
+#include <QMetaEnum>
+
+#include <climits>
 
 using namespace KScreen;
 
-ConfigOperationPrivate::ConfigOperationPrivate(ConfigOperation* qq)
+ConfigOperationPrivate::ConfigOperationPrivate(ConfigOperation* qq, Context *context)
     : QObject()
     , isExec(false)
+    , context(context ? context : Context::defaultContext())
     , q_ptr(qq)
 {
+    for (qint64 &phase : phases) {
+        phase = -1;
+    }
+    timer.start();
 }
 
 ConfigOperationPrivate::~ConfigOperationPrivate()
 {
 }
 
+BackendManager *ConfigOperationPrivate::backendManager() const
+{
+    return context->backendManager();
+}
+
+void ConfigOperationPrivate::normalizeOutputPositions(const ConfigPtr &config)
+{
+    if (!config) {
+        return;
+    }
+    int offsetX = INT_MAX;
+    int offsetY = INT_MAX;
+    Q_FOREACH (const KScreen::OutputPtr &output, config->outputs()) {
+        if (!output->isConnected() || !output->isEnabled()) {
+            continue;
+        }
+        offsetX = qMin(output->pos().x(), offsetX);
+        offsetY = qMin(output->pos().y(), offsetY);
+    }
+
+    if (!offsetX && !offsetY) {
+        return;
+    }
+    qCDebug(KSCREEN) << "Correcting output positions by:" << QPoint(offsetX, offsetY);
+    Q_FOREACH (const KScreen::OutputPtr &output, config->outputs()) {
+        if (!output->isConnected() || !output->isEnabled()) {
+            continue;
+        }
+        QPoint newPos = QPoint(output->pos().x() - offsetX, output->pos().y() - offsetY);
+        qCDebug(KSCREEN) << "Moved output from" << output->pos() << "to" << newPos;
+        output->setPos(newPos);
+    }
+}
+
+void ConfigOperationPrivate::markPhase(ConfigOperation::Phase phase)
+{
+    if (phases[phase] == -1) {
+        phases[phase] = timer.nsecsElapsed();
+    }
+}
+
+QString ConfigOperationPrivate::timingsLogLine() const
+{
+    Q_Q(const ConfigOperation);
+    const QMetaEnum phaseEnum = ConfigOperation::staticMetaObject.enumerator(
+                                    ConfigOperation::staticMetaObject.indexOfEnumerator("Phase"));
+    QString line = QStringLiteral("operation=%1 error=%2").arg(QString::fromLatin1(q->metaObject()->className()),
+                                                             error.isEmpty() ? QStringLiteral("0") : QStringLiteral("1"));
+    for (int i = ConfigOperation::Started; i <= ConfigOperation::Finished; ++i) {
+        QString name = QString::fromLatin1(phaseEnum.valueToKey(i));
+        name[0] = name[0].toLower();
+        line += QStringLiteral(" %1=%2").arg(name, phases[i] == -1 ? QStringLiteral("-")
+                                                                 : QString::number(phases[i] / 1000));
+    }
+    return line;
+}
+
 void ConfigOperationPrivate::requestBackend()
 {
-    Q_ASSERT(BackendManager::instance()->method() == BackendManager::OutOfProcess);
-    connect(BackendManager::instance(), &BackendManager::backendReady,
+    Q_ASSERT(backendManager()->method() == BackendManager::OutOfProcess);
+    connect(backendManager(), &BackendManager::backendReady,
             this, &ConfigOperationPrivate::backendReady);
-    BackendManager::instance()->requestBackend();
+    backendManager()->requestBackend();
 }
 
 void ConfigOperationPrivate::backendReady(org::kde::kscreen::Backend *backend)
 {
-    Q_ASSERT(BackendManager::instance()->method() == BackendManager::OutOfProcess);
-    Q_UNUSED(backend);
+    Q_ASSERT(backendManager()->method() == BackendManager::OutOfProcess);
+    if (backend) {
+        markPhase(ConfigOperation::BackendReady);
+    }
 
-    disconnect(BackendManager::instance(), &BackendManager::backendReady,
+    disconnect(backendManager(), &BackendManager::backendReady,
                this, &ConfigOperationPrivate::backendReady);
 }
 
@@ -58,6 +131,15 @@ void ConfigOperationPrivate::doEmitResult()
 {
     Q_Q(ConfigOperation);
 
+    markPhase(ConfigOperation::Finished);
+    if (Log::instance()->enabled()) {
+        Log::log(timingsLogLine(), QStringLiteral("kscreen.timing"));
+    }
+    TraceLog *trace = TraceLog::instance();
+    if (trace->isEnabled()) {
+        trace->record(TraceLog::OperationFinished, QStringLiteral("timing"), QString(), timingsLogLine().toUtf8());
+    }
+
     Q_EMIT q->finished(q);
 
     // Don't call deleteLater() when this operation is running from exec()
@@ -97,6 +179,15 @@ QString ConfigOperation::errorString() const
     return d->error;
 }
 
+qint64 ConfigOperation::phaseElapsed(Phase phase) const
+{
+    Q_D(const ConfigOperation);
+    if (phase < Started || phase > Finished) {
+        return -1;
+    }
+    return d->phases[phase];
+}
+
 void ConfigOperation::setError(const QString& error)
 {
     Q_D(ConfigOperation);
@@ -111,6 +202,12 @@ void ConfigOperation::emitResult()
     Q_UNUSED(ok);
 }
 
+Context *ConfigOperation::context() const
+{
+    Q_D(const ConfigOperation);
+    return d->context;
+}
+
 bool ConfigOperation::exec()
 {
     Q_D(ConfigOperation);
@@ -132,15 +229,40 @@ bool ConfigOperation::exec()
 
 KScreen::AbstractBackend* ConfigOperationPrivate::loadBackend()
 {
-    Q_ASSERT(BackendManager::instance()->method() == BackendManager::InProcess);
+    Q_ASSERT(backendManager()->method() == BackendManager::InProcess);
     Q_Q(ConfigOperation);
-    const QString &name = qgetenv("KSCREEN_BACKEND").constData();
-    auto backend = KScreen::BackendManager::instance()->loadBackendInProcess(name);
+    const QString name = backendManager()->backendName();
+    auto backend = backendManager()->loadBackendInProcess(name);
     if (backend == nullptr) {
         const QString &e = QStringLiteral("Plugin does not provide valid KScreen backend");
         qCDebug(KSCREEN) << e;
         q->setError(e);
         q->emitResult();
+        return nullptr;
+    }
+
+    if (!backend->isReady()) {
+        // Connect before checking again, a threaded backend may get ready in between
+        backendReadyConnection = QObject::connect(backend, &AbstractBackend::ready, q,
+            [this, q]() {
+                QObject::disconnect(backendReadyConnection);
+                QMetaObject::invokeMethod(q, "start");
+            }, Qt::QueuedConnection);
+        if (!backend->isReady()) {
+            qCDebug(KSCREEN) << "Waiting for" << name << "backend to initialize";
+            return nullptr;
+        }
+        QObject::disconnect(backendReadyConnection);
+    }
+
+    if (!backend->isValid()) {
+        const QString &e = QStringLiteral("Backend %1 failed to initialize").arg(name);
+        qCDebug(KSCREEN) << e;
+        q->setError(e);
+        q->emitResult();
+        return nullptr;
     }
+
+    markPhase(ConfigOperation::BackendReady);
     return backend;
 }
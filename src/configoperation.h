@@ -29,6 +29,7 @@
 namespace KScreen {
 
 class ConfigOperationPrivate;
+class Context;
 
 class KSCREEN_EXPORT ConfigOperation : public QObject
 {
@@ -41,13 +42,57 @@ public:
     };
     Q_DECLARE_FLAGS(Options, Option)
 
+    /**
+     * Phases an operation goes through, see phaseElapsed()
+     *
+     * Not every operation passes every phase: in-process operations don't
+     * deserialize anything and only GetConfigOperation fetches EDIDs.
+     *
+     * @since 5.12
+     */
+    enum Phase {
+        Started,        ///< the operation started running
+        BackendReady,   ///< the backend was available
+        RequestSent,    ///< the request was handed to the backend
+        ReplyReceived,  ///< the backend answered the request
+        Deserialized,   ///< the answer was turned into a Config
+        EdidsReceived,  ///< all EDIDs were retrieved
+        Finished        ///< finished() is about to be emitted
+    };
+    Q_ENUMS(Phase)
+
     virtual ~ConfigOperation();
 
     bool hasError() const;
     QString errorString() const;
 
+    /**
+     * Time it took the operation to reach @p phase
+     *
+     * The times are taken from a monotonic clock and count from the creation
+     * of the operation. They are complete once finished() is emitted, after
+     * that the operation gets deleted, so read them from a slot connected to
+     * finished() or right after exec() returned.
+     *
+     * Setting KSCREEN_LOGGING also writes all phases of every operation to
+     * the KScreen::Log with the category "kscreen.timing", as one line of
+     * "name=value" pairs, in microseconds.
+     *
+     * @param phase the phase to query
+     * @return nanoseconds since the creation of the operation, or -1 if the
+     *         operation did not pass @p phase
+     * @since 5.12
+     */
+    qint64 phaseElapsed(Phase phase) const;
+
     virtual KScreen::ConfigPtr config() const = 0;
 
+    /**
+     * @return the context this operation talks to
+     * @since 5.12
+     */
+    KScreen::Context *context() const;
+
     bool exec();
 
 Q_SIGNALS:
@@ -18,6 +18,7 @@
  */
 
 #include <QObject>
+#include <QElapsedTimer>
 
 #include "configoperation.h"
 #include "abstractbackend.h"
@@ -26,19 +27,32 @@
 namespace KScreen
 {
 
+class BackendManager;
+class Context;
+
 class ConfigOperationPrivate : public QObject
 {
     Q_OBJECT
 
 public:
-    ConfigOperationPrivate(ConfigOperation *qq);
+    ConfigOperationPrivate(ConfigOperation *qq, Context *context);
     virtual ~ConfigOperationPrivate();
 
+    BackendManager *backendManager() const;
+
+    // Moves the enabled outputs so that the top left one is at 0,0
+    static void normalizeOutputPositions(const KScreen::ConfigPtr &config);
+
+    // Records the first time @p phase is reached
+    void markPhase(ConfigOperation::Phase phase);
+    QString timingsLogLine() const;
+
     // For out-of-process
     void requestBackend();
     virtual void backendReady(org::kde::kscreen::Backend *backend);
 
-    // For in-process
+    // For in-process. Returns nullptr when the operation has failed, or
+    // when it is started again once the backend has finished initializing
     KScreen::AbstractBackend* loadBackend();
 
 public Q_SLOTS:
@@ -47,8 +61,12 @@ public Q_SLOTS:
 private:
     QString error;
     bool isExec;
+    QElapsedTimer timer;
+    qint64 phases[ConfigOperation::Finished + 1];
+    QMetaObject::Connection backendReadyConnection;
 
 protected:
+    Context * const context;
     ConfigOperation * const q_ptr;
     Q_DECLARE_PUBLIC(ConfigOperation)
 
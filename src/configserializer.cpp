@@ -25,6 +25,7 @@
 #include "screen.h"
 #include "edid.h"
 #include "debug_p.h"
+#include "usdt_p.h"
 
 #include <QtDBus/QDBusArgument>
 #include <QJsonDocument>
@@ -56,6 +57,7 @@ QJsonObject ConfigSerializer::serializeConfig(const ConfigPtr &config)
     if (!config) {
         return obj;
     }
+    KSCREEN_PROBE2(serialize_config_entry, config.data(), config->outputs().count());
 
     QJsonArray outputs;
     Q_FOREACH (const OutputPtr &output, config->outputs()) {
@@ -66,6 +68,7 @@ QJsonObject ConfigSerializer::serializeConfig(const ConfigPtr &config)
         obj[QLatin1String("screen")] = serializeScreen(config->screen());
     }
 
+    KSCREEN_PROBE2(serialize_config_return, config.data(), outputs.count());
     return obj;
 }
 
@@ -174,6 +177,7 @@ QSize ConfigSerializer::deserializeSize(const QDBusArgument &arg)
 ConfigPtr ConfigSerializer::deserializeConfig(const QVariantMap &map)
 {
     ConfigPtr config(new Config);
+    KSCREEN_PROBE2(deserialize_config_entry, config.data(), map.count());
 
     if (map.contains(QLatin1String("outputs"))) {
         const QDBusArgument &outputsArg = map[QLatin1String("outputs")].value<QDBusArgument>();
@@ -184,6 +188,7 @@ ConfigPtr ConfigSerializer::deserializeConfig(const QVariantMap &map)
             outputsArg >> value;
             const KScreen::OutputPtr output = deserializeOutput(value.value<QDBusArgument>());
             if (!output) {
+                KSCREEN_PROBE2(deserialize_config_return, config.data(), -1);
                 return ConfigPtr();
             }
             outputs.insert(output->id(), output);
@@ -196,11 +201,13 @@ ConfigPtr ConfigSerializer::deserializeConfig(const QVariantMap &map)
         const QDBusArgument &screenArg = map[QLatin1String("screen")].value<QDBusArgument>();
         const KScreen::ScreenPtr screen = deserializeScreen(screenArg);
         if (!screen) {
+            KSCREEN_PROBE2(deserialize_config_return, config.data(), -1);
             return ConfigPtr();
         }
         config->setScreen(screen);
     }
 
+    KSCREEN_PROBE2(deserialize_config_return, config.data(), config->outputs().count());
     return config;
 }
 
@@ -327,3 +334,25 @@ ScreenPtr ConfigSerializer::deserializeScreen(const QDBusArgument &arg)
     arg.endMap();
     return screen;
 }
+
+QVariantList ConfigSerializer::serializeViolations(const ConfigViolations &violations)
+{
+    QVariantList list;
+    Q_FOREACH (const ConfigViolation &violation, violations) {
+        list.append(violation.toMap());
+    }
+    return list;
+}
+
+ConfigViolations ConfigSerializer::deserializeViolations(const QVariantList &list)
+{
+    ConfigViolations violations;
+    Q_FOREACH (const QVariant &value, list) {
+        // Still marshalled when received over D-Bus
+        const QVariantMap map = value.userType() == qMetaTypeId<QDBusArgument>()
+                                    ? qdbus_cast<QVariantMap>(value.value<QDBusArgument>())
+                                    : value.toMap();
+        violations.append(ConfigViolation::fromMap(map));
+    }
+    return violations;
+}
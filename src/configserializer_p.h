@@ -25,6 +25,7 @@
 #include <QVariant>
 #include <QDBusArgument>
 
+#include "configviolation.h"
 #include "types.h"
 #include "kscreen_export.h"
 
@@ -71,6 +72,9 @@ KSCREEN_EXPORT KScreen::OutputPtr deserializeOutput(const QDBusArgument &output)
 KSCREEN_EXPORT KScreen::ModePtr deserializeMode(const QDBusArgument &mode);
 KSCREEN_EXPORT KScreen::ScreenPtr deserializeScreen(const QDBusArgument &screen);
 
+KSCREEN_EXPORT QVariantList serializeViolations(const KScreen::ConfigViolations &violations);
+KSCREEN_EXPORT KScreen::ConfigViolations deserializeViolations(const QVariantList &list);
+
 }
 
 }
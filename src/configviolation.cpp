@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026  agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "configviolation.h"
+
+using namespace KScreen;
+
+ConfigViolation::ConfigViolation()
+    : m_reason(Rejected)
+    , m_outputId(-1)
+{
+}
+
+ConfigViolation::ConfigViolation(Reason reason, int outputId, const QString &message)
+    : m_reason(reason)
+    , m_outputId(outputId)
+    , m_message(message)
+{
+}
+
+ConfigViolation::Reason ConfigViolation::reason() const
+{
+    return m_reason;
+}
+
+int ConfigViolation::outputId() const
+{
+    return m_outputId;
+}
+
+QString ConfigViolation::message() const
+{
+    return m_message;
+}
+
+bool ConfigViolation::operator==(const ConfigViolation &other) const
+{
+    return m_reason == other.m_reason && m_outputId == other.m_outputId && m_message == other.m_message;
+}
+
+QVariantMap ConfigViolation::toMap() const
+{
+    QVariantMap map;
+    map[QStringLiteral("reason")] = static_cast<int>(m_reason);
+    map[QStringLiteral("outputId")] = m_outputId;
+    map[QStringLiteral("message")] = m_message;
+    return map;
+}
+
+ConfigViolation ConfigViolation::fromMap(const QVariantMap &map)
+{
+    return ConfigViolation(static_cast<Reason>(map.value(QStringLiteral("reason"), Rejected).toInt()),
+                           map.value(QStringLiteral("outputId"), -1).toInt(),
+                           map.value(QStringLiteral("message")).toString());
+}
+
+QDebug operator<<(QDebug dbg, const KScreen::ConfigViolation &violation)
+{
+    dbg << "KScreen::ConfigViolation(Reason:" << violation.reason() << ", Output:" << violation.outputId()
+        << "," << violation.message() << ")";
+    return dbg;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026  agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef KSCREEN_CONFIGVIOLATION_H
+#define KSCREEN_CONFIGVIOLATION_H
+
+#include "kscreen_export.h"
+
+#include <QDebug>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+namespace KScreen
+{
+
+/**
+ * A reason why a config cannot be applied, as found by
+ * AbstractBackend::validateConfig()
+ *
+ * @see ValidateConfigOperation
+ * @since 5.12
+ */
+class KSCREEN_EXPORT ConfigViolation
+{
+public:
+    enum Reason {
+        Rejected,               ///< the backend would not apply the config, see message()
+        UnknownOutput,          ///< the output does not exist
+        OutputNotConnected,     ///< an enabled output is not connected
+        InvalidMode,            ///< the output has no such mode
+        InvalidScale,           ///< the scale is not positive
+        TooManyOutputs,         ///< more outputs enabled than the screen can drive
+        ScreenTooLarge,         ///< the outputs span more than the maximum screen size
+        ScreenTooSmall,         ///< the outputs span less than the minimum screen size
+        NoCrtcAvailable         ///< no free CRTC can drive the output
+    };
+
+    ConfigViolation();
+    ConfigViolation(Reason reason, int outputId, const QString &message);
+
+    Reason reason() const;
+
+    /**
+     * @return the output violating the constraint, or -1 if the config as a
+     *         whole does
+     */
+    int outputId() const;
+
+    /**
+     * @return a description for logs and debugging, not meant to be shown
+     *         to users
+     */
+    QString message() const;
+
+    bool operator==(const ConfigViolation &other) const;
+
+    QVariantMap toMap() const;
+    static ConfigViolation fromMap(const QVariantMap &map);
+
+private:
+    Reason m_reason;
+    int m_outputId;
+    QString m_message;
+};
+
+typedef QVector<ConfigViolation> ConfigViolations;
+
+}
+
+KSCREEN_EXPORT QDebug operator<<(QDebug dbg, const KScreen::ConfigViolation &violation);
+
+#endif // KSCREEN_CONFIGVIOLATION_H
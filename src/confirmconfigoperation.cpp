@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2026  agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "confirmconfigoperation.h"
+
+#include "backendmanager_p.h"
+#include "configoperation_p.h"
+#include "debug_p.h"
+
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingCall>
+
+using namespace KScreen;
+
+namespace KScreen
+{
+
+class ConfirmConfigOperationPrivate : public ConfigOperationPrivate
+{
+    Q_OBJECT
+
+public:
+    explicit ConfirmConfigOperationPrivate(quint32 transactionId, Context *context, ConfigOperation* qq);
+
+    void backendReady(org::kde::kscreen::Backend* backend) Q_DECL_OVERRIDE;
+    void onConfirmed(QDBusPendingCallWatcher *watcher);
+
+    quint32 transactionId;
+    bool confirmed;
+
+private:
+    Q_DECLARE_PUBLIC(ConfirmConfigOperation)
+};
+
+}
+
+ConfirmConfigOperationPrivate::ConfirmConfigOperationPrivate(quint32 transactionId, Context *context, ConfigOperation* qq)
+    : ConfigOperationPrivate(qq, context)
+    , transactionId(transactionId)
+    , confirmed(false)
+{
+}
+
+void ConfirmConfigOperationPrivate::backendReady(org::kde::kscreen::Backend* backend)
+{
+    ConfigOperationPrivate::backendReady(backend);
+
+    Q_Q(ConfirmConfigOperation);
+
+    if (!backend) {
+        q->setError(tr("Failed to prepare backend"));
+        q->emitResult();
+        return;
+    }
+
+    markPhase(ConfigOperation::RequestSent);
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(backend->confirm(transactionId), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished,
+            this, &ConfirmConfigOperationPrivate::onConfirmed);
+}
+
+void ConfirmConfigOperationPrivate::onConfirmed(QDBusPendingCallWatcher *watcher)
+{
+    Q_Q(ConfirmConfigOperation);
+
+    markPhase(ConfigOperation::ReplyReceived);
+    QDBusPendingReply<bool> reply = *watcher;
+    watcher->deleteLater();
+
+    if (reply.isError()) {
+        q->setError(reply.error().message());
+    } else {
+        confirmed = reply.value();
+    }
+    q->emitResult();
+}
+
+ConfirmConfigOperation::ConfirmConfigOperation(quint32 transactionId, QObject* parent)
+    : ConfigOperation(new ConfirmConfigOperationPrivate(transactionId, Q_NULLPTR, this), parent)
+{
+}
+
+ConfirmConfigOperation::ConfirmConfigOperation(Context *context, quint32 transactionId, QObject* parent)
+    : ConfigOperation(new ConfirmConfigOperationPrivate(transactionId, context, this), parent)
+{
+}
+
+ConfirmConfigOperation::~ConfirmConfigOperation()
+{
+}
+
+ConfigPtr ConfirmConfigOperation::config() const
+{
+    return ConfigPtr();
+}
+
+bool ConfirmConfigOperation::isConfirmed() const
+{
+    Q_D(const ConfirmConfigOperation);
+    return d->confirmed;
+}
+
+void ConfirmConfigOperation::start()
+{
+    Q_D(ConfirmConfigOperation);
+    d->markPhase(Started);
+    if (d->backendManager()->method() == BackendManager::InProcess) {
+        // In-process there are no transactions, nothing is reverted
+        qCDebug(KSCREEN) << "In-process backends have no transaction" << d->transactionId;
+        emitResult();
+    } else {
+        d->requestBackend();
+    }
+}
+
+#include "confirmconfigoperation.moc"
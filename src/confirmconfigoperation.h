@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2026  agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef KSCREEN_CONFIRMCONFIGOPERATION_H
+#define KSCREEN_CONFIRMCONFIGOPERATION_H
+
+#include "configoperation.h"
+#include "types.h"
+#include "kscreen_export.h"
+
+namespace KScreen {
+
+class ConfirmConfigOperationPrivate;
+
+/**
+ * Keeps a config that was set with a revert timeout
+ *
+ * @code
+ * auto op = new KScreen::SetConfigOperation(config);
+ * op->setRevertTimeout(15000);
+ * connect(op, &KScreen::ConfigOperation::finished, [](KScreen::ConfigOperation *op) {
+ *     const quint32 transaction = qobject_cast<KScreen::SetConfigOperation*>(op)->transactionId();
+ *     // ask the user, then
+ *     new KScreen::ConfirmConfigOperation(transaction);
+ * });
+ * @endcode
+ *
+ * @see SetConfigOperation::setRevertTimeout()
+ * @since 5.12
+ */
+class KSCREEN_EXPORT ConfirmConfigOperation : public KScreen::ConfigOperation
+{
+    Q_OBJECT
+public:
+    explicit ConfirmConfigOperation(quint32 transactionId, QObject* parent = 0);
+    /**
+     * Confirms @p transactionId with the backend of @p context
+     *
+     * @param context the context to talk to, the default context if null
+     */
+    explicit ConfirmConfigOperation(KScreen::Context *context, quint32 transactionId, QObject* parent = 0);
+    ~ConfirmConfigOperation();
+
+    /**
+     * @return a null config, confirming does not change the config
+     */
+    KScreen::ConfigPtr config() const Q_DECL_OVERRIDE;
+
+    /**
+     * @return whether the transaction was pending and is kept now, false when
+     *         it was reverted already or superseded by another config
+     */
+    bool isConfirmed() const;
+
+protected:
+    void start() Q_DECL_OVERRIDE;
+
+private:
+    Q_DECLARE_PRIVATE(ConfirmConfigOperation)
+};
+
+}
+
+#endif // KSCREEN_CONFIRMCONFIGOPERATION_H
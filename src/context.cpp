@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2026  agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "context.h"
+#include "backendmanager_p.h"
+#include "configmonitor.h"
+
+using namespace KScreen;
+
+class Context::Private
+{
+public:
+    Private()
+        : backendManager(Q_NULLPTR)
+        , configMonitor(Q_NULLPTR)
+    {
+    }
+
+    QString backendName;
+    QVariantMap backendArguments;
+    BackendManager *backendManager;
+    ConfigMonitor *configMonitor;
+};
+
+Context *Context::defaultContext()
+{
+    static Context *s_instance = Q_NULLPTR;
+
+    if (s_instance == Q_NULLPTR) {
+        s_instance = new Context();
+    }
+
+    return s_instance;
+}
+
+Context::Context()
+    : QObject()
+    , d(new Private)
+{
+    d->backendManager = new BackendManager(this);
+}
+
+Context::Context(const QString &backend, const QVariantMap &arguments, QObject *parent)
+    : QObject(parent)
+    , d(new Private)
+{
+    d->backendName = backend;
+    d->backendArguments = arguments;
+    d->backendManager = new BackendManager(this);
+}
+
+Context::~Context()
+{
+    // The monitor talks to the backend manager, so it has to go first, but
+    // not before a threaded backend has stopped sending changes to it
+    if (d->backendManager->method() == BackendManager::InProcess) {
+        d->backendManager->shutdownBackend();
+    }
+    delete d->configMonitor;
+    delete d->backendManager;
+    delete d;
+}
+
+QString Context::backendName() const
+{
+    return d->backendName;
+}
+
+QVariantMap Context::backendArguments() const
+{
+    return d->backendArguments;
+}
+
+BackendManager *Context::backendManager() const
+{
+    return d->backendManager;
+}
+
+ConfigMonitor *Context::configMonitor() const
+{
+    if (d->configMonitor == Q_NULLPTR) {
+        d->configMonitor = new ConfigMonitor(const_cast<Context*>(this));
+    }
+
+    return d->configMonitor;
+}
+
+ConfigPtr Context::config() const
+{
+    return d->backendManager->config();
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2026  agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef KSCREEN_CONTEXT_H
+#define KSCREEN_CONTEXT_H
+
+#include <QtCore/QObject>
+#include <QtCore/QVariantMap>
+
+#include "types.h"
+#include "kscreen_export.h"
+
+namespace KScreen
+{
+
+class BackendManager;
+class ConfigMonitor;
+
+/**
+ * @brief A connection to one backend
+ *
+ * A Context owns the connection to a backend, the ConfigMonitor watching it
+ * and the cached configuration of that backend. Operations and monitors of
+ * different contexts are independent of each other, so one process can talk
+ * to several backends at once, for example to the Fake backend to try out a
+ * layout while the real backend is live.
+ *
+ * Applications which only ever talk to one backend don't need to care about
+ * contexts: GetConfigOperation, SetConfigOperation and ConfigMonitor::instance()
+ * use the defaultContext() unless told otherwise.
+ *
+ * @since 5.12
+ */
+class KSCREEN_EXPORT Context : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * The context used by everything that does not get a context passed
+     * explicitly. The backend is picked by the KSCREEN_BACKEND and
+     * KSCREEN_BACKEND_ARGS environment variables, or by the platform.
+     *
+     * @return the process-wide default context
+     */
+    static Context *defaultContext();
+
+    /**
+     * Creates a new context.
+     *
+     * Whether the backend is loaded in-process or through the backend
+     * launcher follows the same rules as for the default context, see
+     * BackendManager::method(). Backends loaded in-process get an instance
+     * of their own when the plugin supports it.
+     *
+     * @param backend name of the backend to use, e.g. "Fake"; an empty name
+     *                picks the preferred backend like the default context does
+     * @param arguments arguments passed to the backend, e.g. "TEST_DATA" for the
+     *                Fake backend or "DISPLAY" for XRandR
+     * @param parent the parent object
+     */
+    explicit Context(const QString &backend,
+                     const QVariantMap &arguments = QVariantMap(),
+                     QObject *parent = Q_NULLPTR);
+    ~Context();
+
+    /**
+     * @return name of the backend requested for this context, empty for
+     * the preferred backend
+     */
+    QString backendName() const;
+
+    /**
+     * @return arguments passed to the backend of this context
+     */
+    QVariantMap backendArguments() const;
+
+    /**
+     * @return the manager of the backend connection of this context
+     */
+    BackendManager *backendManager() const;
+
+    /**
+     * The monitor is created on first use.
+     *
+     * @return the monitor watching the backend of this context
+     */
+    ConfigMonitor *configMonitor() const;
+
+    /**
+     * @return the last configuration received from the backend of this
+     * context, or a null pointer if none has been retrieved yet
+     */
+    ConfigPtr config() const;
+
+private:
+    explicit Context();
+    Q_DISABLE_COPY(Context)
+
+    class Private;
+    Private * const d;
+};
+
+} /* namespace KScreen */
+
+#endif // KSCREEN_CONTEXT_H
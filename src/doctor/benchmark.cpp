@@ -0,0 +1,245 @@
+/*************************************************************************************
+ *  Copyright 2026 by agent <agent@local>                                            *
+ *                                                                                   *
+ *  This library is free software; you can redistribute it and/or                    *
+ *  modify it under the terms of the GNU Lesser General Public                       *
+ *  License as published by the Free Software Foundation; either                     *
+ *  version 2.1 of the License, or (at your option) any later version.               *
+ *                                                                                   *
+ *  This library is distributed in the hope that it will be useful,                  *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of                   *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU                *
+ *  Lesser General Public License for more details.                                  *
+ *                                                                                   *
+ *  You should have received a copy of the GNU Lesser General Public                 *
+ *  License along with this library; if not, write to the Free Software              *
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA       *
+ *************************************************************************************/
+
+#include "benchmark.h"
+
+#include <QAtomicInteger>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusReply>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <algorithm>
+#include <new>
+#include <stdlib.h>
+
+#include "../abstractbackend.h"
+#include "../backendmanager_p.h"
+#include "../getconfigoperation.h"
+#include "../output.h"
+#include "../setconfigoperation.h"
+
+namespace KScreen
+{
+namespace ConfigSerializer
+{
+// Exported private symbol in configserializer_p.h in KScreen
+extern QJsonObject serializeConfig(const KScreen::ConfigPtr &config);
+}
+}
+
+using namespace KScreen;
+
+// Counts what the whole process allocates through operator new. Only the
+// difference around each measured call is reported, which covers the
+// Config, Output and Mode objects and their private data. Qt's implicitly
+// shared containers use malloc() and are not included.
+static QAtomicInteger<quint64> s_allocations;
+
+void *operator new(std::size_t size)
+{
+    s_allocations.fetchAndAddRelaxed(1);
+    if (void *p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) Q_DECL_NOTHROW
+{
+    free(p);
+}
+
+void operator delete[](void *p) Q_DECL_NOTHROW
+{
+    free(p);
+}
+
+QJsonObject Benchmark::Result::toJson() const
+{
+    QJsonObject obj;
+    obj[QStringLiteral("name")] = name;
+    obj[QStringLiteral("iterations")] = iterations;
+    obj[QStringLiteral("failures")] = failures;
+    obj[QStringLiteral("minUs")] = min;
+    obj[QStringLiteral("medianUs")] = median;
+    obj[QStringLiteral("p95Us")] = p95;
+    obj[QStringLiteral("p99Us")] = p99;
+    obj[QStringLiteral("maxUs")] = max;
+    obj[QStringLiteral("meanUs")] = mean;
+    obj[QStringLiteral("payloadBytes")] = payloadSize;
+    obj[QStringLiteral("allocationsMedian")] = allocationsMedian;
+    obj[QStringLiteral("allocationsMax")] = allocationsMax;
+    return obj;
+}
+
+QString Benchmark::Result::toText() const
+{
+    return QStringLiteral("%1 min %2us median %3us p95 %4us p99 %5us max %6us payload %7 bytes allocations %8 (max %9)%10")
+            .arg(name, -16)
+            .arg(min).arg(median).arg(p95).arg(p99).arg(max)
+            .arg(payloadSize).arg(allocationsMedian).arg(allocationsMax)
+            .arg(failures ? QStringLiteral(" failures %1").arg(failures) : QString());
+}
+
+Benchmark::Benchmark(int iterations)
+    : m_iterations(iterations)
+    , m_payloadSize(0)
+{
+}
+
+// Nearest rank, sorted must not be empty
+qint64 Benchmark::percentile(const QVector<qint64> &sorted, int percent)
+{
+    const int rank = (sorted.size() * percent + 99) / 100;
+    return sorted.at(qBound(0, rank - 1, sorted.size() - 1));
+}
+
+template<typename Function>
+Benchmark::Result Benchmark::measure(const QString &name, Function function)
+{
+    Result result;
+    result.name = name;
+    result.iterations = m_iterations;
+
+    // Warm up, the first run loads the backend and fills caches
+    function();
+
+    QVector<qint64> latencies;
+    latencies.reserve(m_iterations);
+    QVector<qint64> allocations;
+    allocations.reserve(m_iterations);
+    QElapsedTimer timer;
+    for (int i = 0; i < m_iterations; ++i) {
+        m_payloadSize = 0;
+        const quint64 allocationsBefore = s_allocations.load();
+        timer.start();
+        const bool ok = function();
+        latencies.append(timer.nsecsElapsed() / 1000);
+        allocations.append(s_allocations.load() - allocationsBefore);
+        if (!ok) {
+            ++result.failures;
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    qint64 sum = 0;
+    Q_FOREACH (qint64 latency, latencies) {
+        sum += latency;
+    }
+    result.min = latencies.first();
+    result.median = percentile(latencies, 50);
+    result.p95 = percentile(latencies, 95);
+    result.p99 = percentile(latencies, 99);
+    result.max = latencies.last();
+    result.mean = sum / latencies.size();
+    result.payloadSize = m_payloadSize;
+    std::sort(allocations.begin(), allocations.end());
+    result.allocationsMedian = percentile(allocations, 50);
+    result.allocationsMax = allocations.last();
+    return result;
+}
+
+ConfigPtr Benchmark::getConfig(bool edid)
+{
+    GetConfigOperation op(edid ? ConfigOperation::NoOptions : ConfigOperation::NoEDID);
+    if (!op.exec()) {
+        return ConfigPtr();
+    }
+    // Not timed separately, the serialization is what the backend sends us
+    m_payloadSize = QJsonDocument(ConfigSerializer::serializeConfig(op.config())).toJson(QJsonDocument::Compact).size();
+    return op.config();
+}
+
+bool Benchmark::setConfig(const ConfigPtr &config)
+{
+    SetConfigOperation op(config);
+    const bool ok = op.exec();
+    m_payloadSize = QJsonDocument(ConfigSerializer::serializeConfig(config)).toJson(QJsonDocument::Compact).size();
+    return ok;
+}
+
+QString Benchmark::activeBackend()
+{
+    BackendManager *manager = BackendManager::instance();
+    if (manager->method() == BackendManager::InProcess) {
+        // The one the operations used
+        AbstractBackend *backend = manager->loadBackendInProcess(manager->backendName());
+        return backend ? backend->name() : QString();
+    }
+
+    // The launcher may run another backend than we would pick
+    const QDBusMessage call = QDBusMessage::createMethodCall(QStringLiteral("org.kde.KScreen"),
+                                                             QStringLiteral("/"),
+                                                             QStringLiteral("org.kde.KScreen"),
+                                                             QStringLiteral("backend"));
+    const QDBusReply<QString> reply = QDBusConnection::sessionBus().call(call);
+    return reply.isValid() ? reply.value() : QString();
+}
+
+QVector<Benchmark::Result> Benchmark::run()
+{
+    QVector<Result> results;
+    results << measure(QStringLiteral("get"), [this]() {
+        return !getConfig(true).isNull();
+    });
+    results << measure(QStringLiteral("get-noedid"), [this]() {
+        return !getConfig(false).isNull();
+    });
+    m_backend = activeBackend();
+
+    // The current config set again, backends are expected to skip the modeset
+    const ConfigPtr config = getConfig(false);
+    if (config.isNull()) {
+        return results;
+    }
+    results << measure(QStringLiteral("set-noop"), [this, config]() {
+        return setConfig(config);
+    });
+    // Set and read back, what a settings UI does to confirm a change
+    results << measure(QStringLiteral("set-roundtrip"), [this, config]() {
+        const bool ok = setConfig(config);
+        const int payloadSize = m_payloadSize;
+        const bool readBack = !getConfig(false).isNull();
+        m_payloadSize += payloadSize;
+        return ok && readBack;
+    });
+    return results;
+}
+
+QJsonObject Benchmark::toJson(const QVector<Result> &results) const
+{
+    QJsonObject obj;
+    obj[QStringLiteral("backend")] = m_backend;
+    obj[QStringLiteral("method")] = BackendManager::instance()->method() == BackendManager::InProcess
+                                        ? QStringLiteral("inprocess") : QStringLiteral("outofprocess");
+    obj[QStringLiteral("iterations")] = m_iterations;
+    QJsonArray array;
+    Q_FOREACH (const Result &result, results) {
+        array.append(result.toJson());
+    }
+    obj[QStringLiteral("results")] = array;
+    return obj;
+}
@@ -0,0 +1,86 @@
+/*************************************************************************************
+ *  Copyright 2026 by agent <agent@local>                                            *
+ *                                                                                   *
+ *  This library is free software; you can redistribute it and/or                    *
+ *  modify it under the terms of the GNU Lesser General Public                       *
+ *  License as published by the Free Software Foundation; either                     *
+ *  version 2.1 of the License, or (at your option) any later version.               *
+ *                                                                                   *
+ *  This library is distributed in the hope that it will be useful,                  *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of                   *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU                *
+ *  Lesser General Public License for more details.                                  *
+ *                                                                                   *
+ *  You should have received a copy of the GNU Lesser General Public                 *
+ *  License along with this library; if not, write to the Free Software              *
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA       *
+ *************************************************************************************/
+
+#ifndef KSCREEN_DOCTOR_BENCHMARK_H
+#define KSCREEN_DOCTOR_BENCHMARK_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+#include "../config.h"
+
+namespace KScreen
+{
+
+/**
+ * Times the config operations against the active backend
+ *
+ * Each scenario runs a number of iterations after one warm-up run, and
+ * reports the latency distribution, the size of the serialized config and
+ * the heap allocations the client made per iteration.
+ */
+class Benchmark
+{
+public:
+    struct Result {
+        QString name;
+        int iterations = 0;
+        int failures = 0;
+        // Latencies in microseconds
+        qint64 min = 0;
+        qint64 median = 0;
+        qint64 p95 = 0;
+        qint64 p99 = 0;
+        qint64 max = 0;
+        qint64 mean = 0;
+        int payloadSize = 0;
+        // Allocations per iteration
+        qint64 allocationsMedian = 0;
+        qint64 allocationsMax = 0;
+
+        QJsonObject toJson() const;
+        QString toText() const;
+    };
+
+    explicit Benchmark(int iterations);
+
+    /** Runs all scenarios, blocking in nested event loops */
+    QVector<Result> run();
+
+    QJsonObject toJson(const QVector<Result> &results) const;
+
+    static qint64 percentile(const QVector<qint64> &sorted, int percent);
+
+private:
+    template<typename Function>
+    Result measure(const QString &name, Function function);
+
+    ConfigPtr getConfig(bool edid);
+    bool setConfig(const ConfigPtr &config);
+    static QString activeBackend();
+
+    int m_iterations;
+    int m_payloadSize;
+    // Name of the backend that served the operations
+    QString m_backend;
+};
+
+} // namespace
+
+#endif // KSCREEN_DOCTOR_BENCHMARK_H
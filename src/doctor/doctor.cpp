@@ -17,6 +17,7 @@
  *************************************************************************************/
 
 #include "doctor.h"
+#include "benchmark.h"
 #include "dpmsclient.h"
 
 #include <QCoreApplication>
@@ -29,16 +30,20 @@
 #include <QFile>
 #include <QLoggingCategory>
 #include <QRect>
+#include <QRegExp>
 #include <QStandardPaths>
 
 #include "../backendmanager_p.h"
 #include "../config.h"
+#include "../configmonitor.h"
 #include "../configoperation.h"
 #include "../getconfigoperation.h"
 #include "../setconfigoperation.h"
 #include "../edid.h"
 #include "../log.h"
 #include "../output.h"
+#include "../tracelog_p.h"
+#include "../tracing_p.h"
 
 Q_LOGGING_CATEGORY(KSCREEN_DOCTOR, "kscreen.doctor")
 
@@ -69,6 +74,8 @@ Doctor::Doctor(QObject *parent)
     , m_config(nullptr)
     , m_changed(false)
     , m_dpmsClient(nullptr)
+    , m_lastEventTime(-1)
+    , m_watchJson(false)
 {
 }
 
@@ -82,6 +89,58 @@ void Doctor::start(QCommandLineParser *parser)
     if (m_parser->isSet("info")) {
         showBackends();
     }
+    if (m_parser->isSet("trace")) {
+        const bool ok = showTrace(m_parser->value(QStringLiteral("trace")), m_parser->isSet("json"));
+        QTimer::singleShot(0, [ok]() {
+            qApp->exit(ok ? 0 : 1);
+        });
+        return;
+    }
+    if (m_parser->isSet("bench")) {
+        bool ok;
+        const int iterations = m_parser->value(QStringLiteral("bench")).toInt(&ok);
+        if (!ok || iterations < 1) {
+            cerr << "Invalid number of iterations: " << m_parser->value(QStringLiteral("bench")) << endl;
+            QTimer::singleShot(0, []() {
+                qApp->exit(2);
+            });
+            return;
+        }
+        // Runs from the event loop, the operations block in nested ones
+        QTimer::singleShot(0, this, [this, iterations]() {
+            qApp->exit(runBenchmark(iterations, m_parser->isSet("json")) ? 0 : 1);
+        });
+        return;
+    }
+    if (m_parser->isSet("script")) {
+        // One config and one backend connection for all commands
+        KScreen::GetConfigOperation *op = new KScreen::GetConfigOperation();
+        connect(op, &KScreen::GetConfigOperation::finished, this,
+                [this](KScreen::ConfigOperation *op) {
+                    if (op->hasError()) {
+                        cerr << "Failed to get the configuration: " << op->errorString() << endl;
+                        qApp->exit(1);
+                        return;
+                    }
+                    m_config = op->config();
+                    qApp->exit(runScript(m_parser->value(QStringLiteral("script"))));
+                });
+        return;
+    }
+    if (m_parser->isSet("watch")) {
+        KScreen::GetConfigOperation *op = new KScreen::GetConfigOperation();
+        connect(op, &KScreen::GetConfigOperation::finished, this,
+                [this](KScreen::ConfigOperation *op) {
+                    if (op->hasError()) {
+                        cerr << "Failed to get the configuration: " << op->errorString() << endl;
+                        qApp->exit(1);
+                        return;
+                    }
+                    m_config = op->config();
+                    watch(m_parser->isSet("json"));
+                });
+        return;
+    }
     if (parser->isSet("json") || parser->isSet("outputs") || !m_positionalArgs.isEmpty()) {
 
         KScreen::GetConfigOperation *op = new KScreen::GetConfigOperation();
@@ -187,85 +246,142 @@ void Doctor::parsePositionalArgs()
 {
     //qCDebug(KSCREEN_DOCTOR) << "POSARGS" << m_positionalArgs;
     Q_FOREACH(const QString &op, m_positionalArgs) {
-        auto ops = op.split('.');
-        if (ops.count() > 2) {
-            bool ok;
-            int output_id = -1;
-            if (ops[0] == QStringLiteral("output")) {
-                Q_FOREACH (const auto &output, m_config->outputs()) {
-                    if (output->name() == ops[1]) {
-                        output_id = output->id();
-                    }
+        const int error = parseArg(op);
+        if (error != 0) {
+            qApp->exit(error);
+            return;
+        }
+    }
+}
+
+// Returns 0 or the exit code, see main.cpp
+int Doctor::parseArg(const QString &op)
+{
+    auto ops = op.split('.');
+    if (ops.count() > 2) {
+        bool ok;
+        int output_id = -1;
+        if (ops[0] == QStringLiteral("output")) {
+            Q_FOREACH (const auto &output, m_config->outputs()) {
+                if (output->name() == ops[1]) {
+                    output_id = output->id();
                 }
-                if (output_id == -1) {
-                    output_id = ops[1].toInt(&ok);
-                    if (!ok) {
-                        cerr << "Unable to parse output id" << ops[1] << endl;
-                        qApp->exit(3);
-                        return;
-                    }
+            }
+            if (output_id == -1) {
+                output_id = ops[1].toInt(&ok);
+                if (!ok) {
+                    cerr << "Unable to parse output id" << ops[1] << endl;
+                    return 3;
                 }
-                if (ops.count() == 3 && ops[2] == QStringLiteral("enable")) {
-                    if (!setEnabled(output_id, true)) {
-                        qApp->exit(1);
-                        return;
-                    };
-                } else if (ops.count() == 3 && ops[2] == QStringLiteral("disable")) {
-                    if (!setEnabled(output_id, false)) {
-                        qApp->exit(1);
-                        return;
-                    };
-                } else if (ops.count() == 4 && ops[2] == QStringLiteral("mode")) {
-                    QString mode_id = ops[3];
-                    // set mode
-                    if (!setMode(output_id, mode_id)) {
-                        qApp->exit(9);
-                        return;
-                    }
-                    qCDebug(KSCREEN_DOCTOR) << "Output" << output_id << "set mode" << mode_id;
+            }
+            if (ops.count() == 3 && ops[2] == QStringLiteral("enable")) {
+                if (!setEnabled(output_id, true)) {
+                    return 1;
+                };
+            } else if (ops.count() == 3 && ops[2] == QStringLiteral("disable")) {
+                if (!setEnabled(output_id, false)) {
+                    return 1;
+                };
+            } else if (ops.count() == 4 && ops[2] == QStringLiteral("mode")) {
+                QString mode_id = ops[3];
+                // set mode
+                if (!setMode(output_id, mode_id)) {
+                    return 9;
+                }
+                qCDebug(KSCREEN_DOCTOR) << "Output" << output_id << "set mode" << mode_id;
 
-                } else if (ops.count() == 4 && ops[2] == QStringLiteral("position")) {
-                    QStringList _pos = ops[3].split(',');
-                    if (_pos.count() != 2) {
-                        qCWarning(KSCREEN_DOCTOR) << "Invalid position:" << ops[3];
-                        qApp->exit(5);
-                        return;
-                    }
-                    int x = _pos[0].toInt(&ok);
-                    int y = _pos[1].toInt(&ok);
-                    if (!ok) {
-                        cerr << "Unable to parse position" << ops[3] << endl;
-                        qApp->exit(5);
-                        return;
-                    }
+            } else if (ops.count() == 4 && ops[2] == QStringLiteral("position")) {
+                QStringList _pos = ops[3].split(',');
+                if (_pos.count() != 2) {
+                    qCWarning(KSCREEN_DOCTOR) << "Invalid position:" << ops[3];
+                    return 5;
+                }
+                int x = _pos[0].toInt(&ok);
+                int y = _pos[1].toInt(&ok);
+                if (!ok) {
+                    cerr << "Unable to parse position" << ops[3] << endl;
+                    return 5;
+                }
 
-                    QPoint p(x, y);
-                    qCDebug(KSCREEN_DOCTOR) << "Output position" << p;
-                    if (!setPosition(output_id, p)) {
-                        qApp->exit(1);
-                        return;
-                    }
-                } else if ((ops.count() == 4 || ops.count() == 5) && ops[2] == QStringLiteral("scale")) {
-                    // be lenient about . vs. comma as separator
-                    qreal scale = ops[3].replace(QStringLiteral(","), QStringLiteral(".")).toDouble(&ok);
-                    if (ops.count() == 5) {
-                        const auto dbl = ops[3] + QStringLiteral(".") + ops[4];
-                        scale = dbl.toDouble(&ok);
-                    };
-                    // set scale
-                    if (!ok || scale == 0 || !setScale(output_id, scale)) {
-                        qCDebug(KSCREEN_DOCTOR) << "Could not set scale " << scale << " to output " << output_id;
-                        qApp->exit(9);
-                        return;
-                    }
-                } else {
-                    cerr << "Unable to parse arguments" << op << endl;
-                    qApp->exit(2);
-                    return;
+                QPoint p(x, y);
+                qCDebug(KSCREEN_DOCTOR) << "Output position" << p;
+                if (!setPosition(output_id, p)) {
+                    return 1;
                 }
+            } else if ((ops.count() == 4 || ops.count() == 5) && ops[2] == QStringLiteral("scale")) {
+                // be lenient about . vs. comma as separator
+                qreal scale = ops[3].replace(QStringLiteral(","), QStringLiteral(".")).toDouble(&ok);
+                if (ops.count() == 5) {
+                    const auto dbl = ops[3] + QStringLiteral(".") + ops[4];
+                    scale = dbl.toDouble(&ok);
+                };
+                // set scale
+                if (!ok || scale == 0 || !setScale(output_id, scale)) {
+                    qCDebug(KSCREEN_DOCTOR) << "Could not set scale " << scale << " to output " << output_id;
+                    return 9;
+                }
+            } else {
+                cerr << "Unable to parse arguments" << op << endl;
+                return 2;
             }
         }
     }
+    return 0;
+}
+
+// Commands in the syntax of the positional arguments, separated by whitespace
+// or newlines, "#" starts a comment. All commands up to a "commit" or the end
+// of the script are applied at once.
+int Doctor::runScript(const QString &fileName)
+{
+    QFile file;
+    bool opened;
+    if (fileName == QLatin1String("-")) {
+        opened = file.open(stdin, QIODevice::ReadOnly);
+    } else {
+        file.setFileName(fileName);
+        opened = file.open(QIODevice::ReadOnly);
+    }
+    if (!opened) {
+        cerr << "Unable to open script " << fileName << ": " << file.errorString() << endl;
+        return 1;
+    }
+
+    m_changed = false;
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine().section(QLatin1Char('#'), 0, 0);
+        ++lineNumber;
+        const QString location = QStringLiteral("%1:%2").arg(fileName).arg(lineNumber);
+        Q_FOREACH (const QString &command, line.split(QRegExp(QStringLiteral("\\s+")), QString::SkipEmptyParts)) {
+            const int error = command == QLatin1String("commit") ? commitScriptGroup(location) : parseArg(command);
+            if (error != 0) {
+                cerr << location << ": " << command << " failed" << endl;
+                return error;
+            }
+        }
+    }
+    return commitScriptGroup(QStringLiteral("%1:%2").arg(fileName).arg(lineNumber));
+}
+
+int Doctor::commitScriptGroup(const QString &location)
+{
+    if (!m_changed) {
+        return 0;
+    }
+    if (!Config::canBeApplied(m_config)) {
+        cerr << location << ": the configuration cannot be applied" << endl;
+        return 10;
+    }
+    SetConfigOperation op(m_config);
+    if (!op.exec()) {
+        cerr << location << ": applying the configuration failed: " << op.errorString() << endl;
+        return 1;
+    }
+    qCDebug(KSCREEN_DOCTOR) << "Applied configuration at" << location;
+    m_changed = false;
+    return 0;
 }
 
 void Doctor::configReceived(KScreen::ConfigOperation *op)
@@ -354,6 +470,105 @@ void Doctor::showJson() const
     cout << doc.toJson(QJsonDocument::Indented);
 }
 
+bool Doctor::showTrace(const QString &fileName, bool json) const
+{
+    QString error;
+    const QVector<TraceLog::Record> records = TraceLog::decode(fileName, &error);
+    if (!error.isEmpty()) {
+        cerr << "Failed to read trace " << fileName << ": " << error << endl;
+        if (records.isEmpty()) {
+            return false;
+        }
+    }
+
+    if (json) {
+        QJsonArray array;
+        Q_FOREACH (const TraceLog::Record &record, records) {
+            array.append(TraceLog::toJson(record));
+        }
+        cout << QJsonDocument(array).toJson(QJsonDocument::Indented);
+    } else {
+        Q_FOREACH (const TraceLog::Record &record, records) {
+            cout << TraceLog::toText(record) << endl;
+        }
+    }
+    return true;
+}
+
+bool Doctor::runBenchmark(int iterations, bool json) const
+{
+    Benchmark benchmark(iterations);
+    const QVector<Benchmark::Result> results = benchmark.run();
+
+    bool ok = results.count() == 4;
+    Q_FOREACH (const Benchmark::Result &result, results) {
+        ok = ok && result.failures == 0;
+    }
+
+    if (json) {
+        cout << QJsonDocument(benchmark.toJson(results)).toJson(QJsonDocument::Indented);
+        return ok;
+    }
+    const QJsonObject info = benchmark.toJson(QVector<Benchmark::Result>());
+    cout << bold << "Backend: " << cr << info[QStringLiteral("backend")].toString()
+         << " (" << info[QStringLiteral("method")].toString() << "), "
+         << iterations << " iterations" << endl;
+    Q_FOREACH (const Benchmark::Result &result, results) {
+        cout << (result.failures ? red : green) << result.toText() << cr << endl;
+    }
+    if (!ok) {
+        cerr << "Benchmark failed, not all operations succeeded." << endl;
+    }
+    return ok;
+}
+
+void Doctor::watch(bool json)
+{
+    m_watchJson = json;
+    m_watchedConfig = KScreen::ConfigSerializer::serializeConfig(m_config);
+    m_lastEventTime = Tracing::now();
+
+    ConfigMonitor *monitor = ConfigMonitor::instance();
+    monitor->addConfig(m_config);
+    connect(monitor, &ConfigMonitor::configurationChanged, this, &Doctor::watchedConfigChanged);
+    if (!m_watchJson) {
+        cout << bold << "Watching " << m_config->outputs().count() << " outputs, Ctrl+C to stop" << cr << endl;
+    }
+}
+
+// One line per change, JSON lines with --json, flushed right away so the
+// output can be piped
+void Doctor::watchedConfigChanged()
+{
+    const qint64 received = Tracing::now();
+    const QString wallTime = QDateTime::currentDateTime().toString(QStringLiteral("yyyy-MM-ddTHH:mm:ss.zzz"));
+    // The monitor emits right after timing the notification
+    const qint64 latency = ConfigMonitor::instance()->lastLatency(ConfigMonitor::TotalLatency);
+    const qint64 sincePrevious = received - m_lastEventTime;
+    m_lastEventTime = received;
+
+    const QJsonObject serialized = KScreen::ConfigSerializer::serializeConfig(m_config);
+    const QJsonObject diff = TraceLog::configDiff(m_watchedConfig, serialized);
+    m_watchedConfig = serialized;
+
+    if (m_watchJson) {
+        QJsonObject record;
+        record[QStringLiteral("time")] = wallTime;
+        record[QStringLiteral("receivedUs")] = received;
+        record[QStringLiteral("backendUs")] = latency < 0 ? QJsonValue() : QJsonValue(received - latency);
+        record[QStringLiteral("latencyUs")] = latency < 0 ? QJsonValue() : QJsonValue(latency);
+        record[QStringLiteral("sincePreviousUs")] = sincePrevious;
+        record[QStringLiteral("changes")] = diff;
+        cout << QJsonDocument(record).toJson(QJsonDocument::Compact) << endl;
+        return;
+    }
+    cout << wallTime
+         << " +" << QString::number(sincePrevious / 1000.0, 'f', 1) << "ms"
+         << " latency " << (latency < 0 ? QStringLiteral("-") : QString::number(latency) + QStringLiteral("us")) << " "
+         << (diff.isEmpty() ? QStringLiteral("(no change)") : QString::fromUtf8(QJsonDocument(diff).toJson(QJsonDocument::Compact)))
+         << endl;
+}
+
 bool Doctor::setEnabled(int id, bool enabled = true)
 {
     if (!m_config) {
@@ -20,6 +20,7 @@
 #define KSCREEN_DOCTOR_H
 
 #include <QCommandLineParser>
+#include <QJsonObject>
 #include <QObject>
 #include "../config.h"
 
@@ -46,6 +47,10 @@ public:
     void showBackends() const;
     void showOutputs() const;
     void showJson() const;
+    bool showTrace(const QString &fileName, bool json) const;
+    bool runBenchmark(int iterations, bool json) const;
+    void watch(bool json);
+    int runScript(const QString &fileName);
     int outputCount() const;
     void setDpms(const QString &dpmsArg);
 
@@ -63,12 +68,19 @@ private:
     //static QString modeString(KWayland::Server::OutputDeviceInterface* outputdevice, int mid);
     void applyConfig();
     void parsePositionalArgs();
+    int parseArg(const QString &op);
+    int commitScriptGroup(const QString &location);
+    void watchedConfigChanged();
     int parseInt(const QString &str, bool &ok) const;
     KScreen::ConfigPtr m_config;
     QCommandLineParser* m_parser;
     bool m_changed;
     QStringList m_positionalArgs;
     DpmsClient *m_dpmsClient;
+    // State of --watch
+    QJsonObject m_watchedConfig;
+    qint64 m_lastEventTime;
+    bool m_watchJson;
 };
 
 } // namespace
@@ -34,6 +34,7 @@
  *
  * 8 : invalid output id
  * 9 : invalid mode id
+ * 10 : configuration cannot be applied (--script)
  *
  */
 
@@ -57,7 +58,13 @@ int main(int argc, char **argv)
     "\n   Position the hdmi monitor on the right of the laptop panel\n"
     "   $ kscreen-doctor output.HDMI-2.position.0,1280 output.eDP-1.position.0,0\n"
     "\n   Set resolution mode\n"
-    "   $ kscreen-doctor output.HDMI-2.mode.1920x1080@60 \n";
+    "   $ kscreen-doctor output.HDMI-2.mode.1920x1080@60 \n"
+    "\n   Benchmark the backend, comparable between runs with the Fake backend\n"
+    "   $ KSCREEN_BACKEND=Fake kscreen-doctor --bench 100 --json\n"
+    "\n   Follow hotplug and mode changes, one JSON record per line\n"
+    "   $ kscreen-doctor --watch --json\n"
+    "\n   Apply many changes with a single backend connection, one modeset per commit\n"
+    "   $ printf 'output.HDMI-2.enable\\ncommit\\noutput.eDP-1.disable\\n' | kscreen-doctor --script -\n";
 /*
     "\nError codes:\n"
     "   2 : general parse error\n"
@@ -90,6 +97,14 @@ int main(int argc, char **argv)
                                                   QStringLiteral("Display power management (wayland only)"), QStringLiteral("off"));
     QCommandLineOption log = QCommandLineOption(QStringList() << QStringLiteral("l") << "log",
                                                   QStringLiteral("Write a comment to the log file"), QStringLiteral("comment"));
+    QCommandLineOption trace = QCommandLineOption(QStringList() << QStringLiteral("t") << "trace",
+                                                  QStringLiteral("Decode a binary trace file (see KSCREEN_TRACE), as JSON with --json"), QStringLiteral("file"));
+    QCommandLineOption bench = QCommandLineOption(QStringList() << QStringLiteral("b") << "bench",
+                                                  QStringLiteral("Measure the latency of getting and setting the configuration, as JSON with --json"), QStringLiteral("iterations"));
+    QCommandLineOption watch = QCommandLineOption(QStringList() << QStringLiteral("w") << "watch",
+                                                  QStringLiteral("Print configuration changes as they happen, as JSON lines with --json"));
+    QCommandLineOption script = QCommandLineOption(QStringList() << QStringLiteral("s") << "script",
+                                                  QStringLiteral("Apply the settings read from a file, - for stdin. Settings are applied together up to each \"commit\" and at the end"), QStringLiteral("file"));
 
     QCommandLineParser parser;
     parser.setApplicationDescription(desc);
@@ -100,6 +115,10 @@ int main(int argc, char **argv)
     parser.addOption(outputs);
     parser.addOption(dpms);
     parser.addOption(log);
+    parser.addOption(trace);
+    parser.addOption(bench);
+    parser.addOption(watch);
+    parser.addOption(script);
     parser.process(app);
 
     if (!parser.positionalArguments().isEmpty()) {
@@ -25,6 +25,7 @@
 #include "backendmanager_p.h"
 #include "configserializer_p.h"
 #include "backendinterface.h"
+#include "usdt_p.h"
 
 using namespace KScreen;
 
@@ -36,7 +37,7 @@ class GetConfigOperationPrivate : public ConfigOperationPrivate
     Q_OBJECT
 
 public:
-    GetConfigOperationPrivate(GetConfigOperation::Options options, GetConfigOperation *qq);
+    GetConfigOperationPrivate(GetConfigOperation::Options options, Context *context, GetConfigOperation *qq);
 
     void backendReady(org::kde::kscreen::Backend* backend) Q_DECL_OVERRIDE;
     void onConfigReceived(QDBusPendingCallWatcher *watcher);
@@ -47,6 +48,8 @@ public:
     ConfigPtr config;
     // For in-process
     void loadEdid(KScreen::AbstractBackend* backend);
+    void loadConfigThreaded(KScreen::AbstractBackend* backend);
+    void onThreadedConfigLoaded(const KScreen::ConfigPtr &config);
 
     // For out-of-process
     int pendingEDIDs;
@@ -58,15 +61,15 @@ private:
 
 }
 
-GetConfigOperationPrivate::GetConfigOperationPrivate(GetConfigOperation::Options options, GetConfigOperation* qq)
-    : ConfigOperationPrivate(qq)
+GetConfigOperationPrivate::GetConfigOperationPrivate(GetConfigOperation::Options options, Context *context, GetConfigOperation* qq)
+    : ConfigOperationPrivate(qq, context)
     , options(options)
 {
 }
 
 void GetConfigOperationPrivate::backendReady(org::kde::kscreen::Backend *backend)
 {
-    Q_ASSERT(BackendManager::instance()->method() == BackendManager::OutOfProcess);
+    Q_ASSERT(backendManager()->method() == BackendManager::OutOfProcess);
     ConfigOperationPrivate::backendReady(backend);
 
     Q_Q(GetConfigOperation);
@@ -78,6 +81,7 @@ void GetConfigOperationPrivate::backendReady(org::kde::kscreen::Backend *backend
     }
 
     mBackend = backend;
+    markPhase(ConfigOperation::RequestSent);
     QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(mBackend->getConfig(), this);
     connect(watcher, &QDBusPendingCallWatcher::finished,
             this, &GetConfigOperationPrivate::onConfigReceived);
@@ -85,9 +89,10 @@ void GetConfigOperationPrivate::backendReady(org::kde::kscreen::Backend *backend
 
 void GetConfigOperationPrivate::onConfigReceived(QDBusPendingCallWatcher *watcher)
 {
-    Q_ASSERT(BackendManager::instance()->method() == BackendManager::OutOfProcess);
+    Q_ASSERT(backendManager()->method() == BackendManager::OutOfProcess);
     Q_Q(GetConfigOperation);
 
+    markPhase(ConfigOperation::ReplyReceived);
     QDBusPendingReply<QVariantMap> reply = *watcher;
     watcher->deleteLater();
     if (reply.isError()) {
@@ -102,6 +107,7 @@ void GetConfigOperationPrivate::onConfigReceived(QDBusPendingCallWatcher *watche
         q->emitResult();
         return;
     }
+    markPhase(ConfigOperation::Deserialized);
 
     if (options & GetConfigOperation::NoEDID || config->outputs().isEmpty()) {
         q->emitResult();
@@ -129,7 +135,7 @@ void GetConfigOperationPrivate::onConfigReceived(QDBusPendingCallWatcher *watche
 
 void GetConfigOperationPrivate::onEDIDReceived(QDBusPendingCallWatcher* watcher)
 {
-    Q_ASSERT(BackendManager::instance()->method() == BackendManager::OutOfProcess);
+    Q_ASSERT(backendManager()->method() == BackendManager::OutOfProcess);
     Q_Q(GetConfigOperation);
 
     QDBusPendingReply<QByteArray> reply = *watcher;
@@ -142,9 +148,11 @@ void GetConfigOperationPrivate::onEDIDReceived(QDBusPendingCallWatcher* watcher)
 
     const QByteArray edidData = reply.value();
     const int outputId = watcher->property("outputId").toInt();
+    KSCREEN_PROBE2(edid_received, outputId, edidData.size());
 
     config->output(outputId)->setEdid(edidData);
     if (--pendingEDIDs == 0) {
+        markPhase(ConfigOperation::EdidsReceived);
         q->emitResult();
     }
 }
@@ -152,7 +160,12 @@ void GetConfigOperationPrivate::onEDIDReceived(QDBusPendingCallWatcher* watcher)
 
 
 GetConfigOperation::GetConfigOperation(Options options, QObject* parent)
-    : ConfigOperation(new GetConfigOperationPrivate(options, this), parent)
+    : ConfigOperation(new GetConfigOperationPrivate(options, Q_NULLPTR, this), parent)
+{
+}
+
+GetConfigOperation::GetConfigOperation(Context *context, Options options, QObject* parent)
+    : ConfigOperation(new GetConfigOperationPrivate(options, context, this), parent)
 {
 }
 
@@ -169,10 +182,20 @@ KScreen::ConfigPtr GetConfigOperation::config() const
 void GetConfigOperation::start()
 {
     Q_D(GetConfigOperation);
-    if (BackendManager::instance()->method() == BackendManager::InProcess) {
+    d->markPhase(Started);
+    if (d->backendManager()->method() == BackendManager::InProcess) {
         auto backend = d->loadBackend();
+        if (!backend) {
+            return;
+        }
+        if (backend->thread() != thread()) {
+            d->loadConfigThreaded(backend);
+            return;
+        }
+        d->markPhase(RequestSent);
         d->config = backend->config();
-        KScreen::BackendManager::instance()->setConfig(d->config);
+        d->markPhase(ReplyReceived);
+        d->backendManager()->setConfig(d->config);
         d->loadEdid(backend);
         emitResult();
     } else {
@@ -182,7 +205,7 @@ void GetConfigOperation::start()
 
 void GetConfigOperationPrivate::loadEdid(KScreen::AbstractBackend* backend)
 {
-    Q_ASSERT(BackendManager::instance()->method() == BackendManager::InProcess);
+    Q_ASSERT(backendManager()->method() == BackendManager::InProcess);
     Q_Q(GetConfigOperation);
     if (options & KScreen::ConfigOperation::NoEDID) {
         return;
@@ -192,11 +215,57 @@ void GetConfigOperationPrivate::loadEdid(KScreen::AbstractBackend* backend)
     }
     Q_FOREACH (auto output, config->outputs()) {
         if (output->edid() == nullptr) {
+            KSCREEN_PROBE1(edid_fetch_entry, output->id());
             const QByteArray edidData = backend->edid(output->id());
+            KSCREEN_PROBE2(edid_fetch_return, output->id(), edidData.size());
             output->setEdid(edidData);
         }
     }
+    markPhase(ConfigOperation::EdidsReceived);
 }
 
 
 #include "getconfigoperation.moc"
+
+void GetConfigOperationPrivate::loadConfigThreaded(KScreen::AbstractBackend* backend)
+{
+    Q_ASSERT(backendManager()->method() == BackendManager::InProcess);
+
+    // The backend keeps modifying its config on its own thread, so hand out
+    // a copy taken over there
+    const QPointer<GetConfigOperationPrivate> guard(this);
+    BackendManager *manager = backendManager();
+    const bool withEdid = !(options & KScreen::ConfigOperation::NoEDID);
+    markPhase(ConfigOperation::RequestSent);
+    BackendManager::invokeInThread(backend, [=]() {
+        ConfigPtr result = backend->config();
+        if (result) {
+            result = result->clone();
+            if (withEdid) {
+                Q_FOREACH (auto output, result->outputs()) {
+                    if (output->edid() == nullptr) {
+                        output->setEdid(backend->edid(output->id()));
+                    }
+                }
+            }
+        }
+        BackendManager::invokeInThread(manager, [=]() {
+            if (guard) {
+                guard->onThreadedConfigLoaded(result);
+            }
+        });
+    });
+}
+
+void GetConfigOperationPrivate::onThreadedConfigLoaded(const KScreen::ConfigPtr &result)
+{
+    Q_Q(GetConfigOperation);
+    // The EDIDs were fetched on the backend thread along with the config
+    markPhase(ConfigOperation::ReplyReceived);
+    if (result && !(options & KScreen::ConfigOperation::NoEDID)) {
+        markPhase(ConfigOperation::EdidsReceived);
+    }
+    config = result;
+    backendManager()->setConfig(config);
+    q->emitResult();
+}
@@ -38,6 +38,13 @@ class KSCREEN_EXPORT GetConfigOperation : public KScreen::ConfigOperation
 public:
 
     explicit GetConfigOperation(Options options = NoOptions, QObject* parent = 0);
+    /**
+     * Retrieves the configuration of the backend of @p context
+     *
+     * @param context the context to talk to, the default context if null
+     * @since 5.12
+     */
+    explicit GetConfigOperation(KScreen::Context *context, Options options = NoOptions, QObject* parent = 0);
     virtual ~GetConfigOperation();
 
     virtual KScreen::ConfigPtr config() const Q_DECL_OVERRIDE;
@@ -0,0 +1,53 @@
+/*************************************************************************************
+ *  Copyright 2026 agent <agent@local>                                               *
+ *                                                                                   *
+ *  This library is free software; you can redistribute it and/or                    *
+ *  modify it under the terms of the GNU Lesser General Public                       *
+ *  License as published by the Free Software Foundation; either                     *
+ *  version 2.1 of the License, or (at your option) any later version.               *
+ *                                                                                   *
+ *  This library is distributed in the hope that it will be useful,                  *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of                   *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU                *
+ *  Lesser General Public License for more details.                                  *
+ *                                                                                   *
+ *  You should have received a copy of the GNU Lesser General Public                 *
+ *  License along with this library; if not, write to the Free Software              *
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA       *
+ *************************************************************************************/
+
+#ifndef KSCREEN_STATIC_BACKENDS_H
+#define KSCREEN_STATIC_BACKENDS_H
+
+#cmakedefine KSCREEN_STATIC_BACKENDS
+#cmakedefine KSCREEN_STATIC_XRANDR
+
+/**
+ * Imports the backends libkscreen was built to link statically
+ *
+ * Applications that load backends in-process put this once at file scope,
+ * and link KF5::KSC_QScreen, KF5::KSC_KWayland and, if it was built,
+ * KF5::KSC_XRandR. BackendManager then finds these backends without looking
+ * for plugin files. It expands to nothing when libkscreen was built with
+ * loadable backends.
+ *
+ * @since 5.12
+ */
+#ifdef KSCREEN_STATIC_BACKENDS
+#include <QtCore/QtPlugin>
+
+#ifdef KSCREEN_STATIC_XRANDR
+#define KSCREEN_IMPORT_STATIC_XRANDR Q_IMPORT_PLUGIN(XRandR)
+#else
+#define KSCREEN_IMPORT_STATIC_XRANDR
+#endif
+
+#define KSCREEN_IMPORT_STATIC_BACKENDS \
+    Q_IMPORT_PLUGIN(QScreenBackend) \
+    Q_IMPORT_PLUGIN(WaylandBackend) \
+    KSCREEN_IMPORT_STATIC_XRANDR
+#else
+#define KSCREEN_IMPORT_STATIC_BACKENDS
+#endif
+
+#endif // KSCREEN_STATIC_BACKENDS_H
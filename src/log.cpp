@@ -17,23 +17,157 @@
  *************************************************************************************/
 
 #include "log.h"
+#include "tracelog_p.h"
 
+#include <QAtomicInt>
 #include <QDateTime>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QMutex>
+#include <QRegExp>
+#include <QScopedArrayPointer>
+#include <QSemaphore>
 #include <QStandardPaths>
+#include <QThread>
+
+#include <functional>
 
 namespace KScreen {
 
 Log* Log::sInstance = nullptr;
 QtMessageHandler sDefaultMessageHandler = nullptr;
 
+namespace {
+
+enum LogLevel {
+    DebugLevel,
+    InfoLevel,
+    WarningLevel,
+    CriticalLevel,
+    OffLevel
+};
+
+struct LogRule
+{
+    QByteArray name;    // without the trailing * for wildcards
+    bool wildcard;
+    int level;
+};
+
+struct LogRules
+{
+    QMutex mutex;
+    QString text;
+    QVector<LogRule> rules;
+    QLoggingCategory::CategoryFilter previousFilter = nullptr;
+};
+
+}
+
+Q_GLOBAL_STATIC(LogRules, sLogRules)
+
+static QVector<LogRule> parseLogRules(const QString &text)
+{
+    QVector<LogRule> rules;
+    Q_FOREACH (const QString &entry, text.split(QRegExp(QStringLiteral("[;,\\s]+")), QString::SkipEmptyParts)) {
+        const int separator = entry.indexOf(QLatin1Char('='));
+        if (separator <= 0) {
+            continue;
+        }
+        const QString value = entry.mid(separator + 1).toLower();
+        LogRule rule;
+        if (value == QLatin1String("debug") || value == QLatin1String("true")) {
+            rule.level = DebugLevel;
+        } else if (value == QLatin1String("info")) {
+            rule.level = InfoLevel;
+        } else if (value == QLatin1String("warning")) {
+            rule.level = WarningLevel;
+        } else if (value == QLatin1String("critical")) {
+            rule.level = CriticalLevel;
+        } else if (value == QLatin1String("off") || value == QLatin1String("false")) {
+            rule.level = OffLevel;
+        } else {
+            continue;
+        }
+        rule.name = entry.left(separator).toLatin1();
+        rule.wildcard = rule.name.endsWith('*');
+        if (rule.wildcard) {
+            rule.name.chop(1);
+        }
+        rules.append(rule);
+    }
+    return rules;
+}
+
+// The exact name wins over wildcards, the longest wildcard over shorter ones
+static int logLevel(const QVector<LogRule> &rules, const char *name)
+{
+    int level = -1;
+    int matchLength = -1;
+    Q_FOREACH (const LogRule &rule, rules) {
+        if (!rule.wildcard) {
+            if (rule.name == name) {
+                return rule.level;
+            }
+        } else if (rule.name.size() > matchLength && qstrncmp(name, rule.name.constData(), rule.name.size()) == 0) {
+            level = rule.level;
+            matchLength = rule.name.size();
+        }
+    }
+    return level;
+}
+
+// Called by Qt for every category, whenever it is created or the filter
+// changes, so the verdict is cached in the category and messages below the
+// threshold are only a branch at the qCDebug() and friends call site.
+static bool isKScreenCategory(const char *name)
+{
+    // Every message of the process passes the message handler, so this must
+    // stay cheap: no lock, no lookup
+    return name && qstrncmp(name, "kscreen", 7) == 0;
+}
+
+static void kscreenCategoryFilter(QLoggingCategory *category)
+{
+    if (sLogRules.isDestroyed()) {
+        return;
+    }
+    const char *name = category->categoryName();
+    const bool isKScreen = isKScreenCategory(name);
+    QLoggingCategory::CategoryFilter previousFilter;
+    int level = -1;
+    {
+        QMutexLocker locker(&sLogRules->mutex);
+        previousFilter = sLogRules->previousFilter;
+        if (isKScreen) {
+            level = logLevel(sLogRules->rules, name);
+        }
+    }
+
+    // Qt's own rules, QT_LOGGING_RULES included, apply unless ours match
+    if (previousFilter) {
+        previousFilter(category);
+    }
+    if (level < 0) {
+        return;
+    }
+    category->setEnabled(QtDebugMsg, level <= DebugLevel);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+    category->setEnabled(QtInfoMsg, level <= InfoLevel);
+#endif
+    category->setEnabled(QtWarningMsg, level <= WarningLevel);
+    category->setEnabled(QtCriticalMsg, level <= CriticalLevel);
+}
+
 void kscreenLogOutput(QtMsgType type, const QMessageLogContext &context, const QString &msg)
 {
-    QByteArray localMsg = msg.toLocal8Bit();
-    if (QString::fromLocal8Bit(context.category).startsWith(QLatin1String("kscreen"))) {
-        Log::log(localMsg.constData(), context.category);
+    if (isKScreenCategory(context.category)) {
+        Log::log(msg, QString::fromLatin1(context.category));
+    }
+    if (type == QtFatalMsg) {
+        // The default handler aborts, write out what is queued while we still can
+        Log::flush();
     }
     sDefaultMessageHandler(type, context, msg);
 }
@@ -52,15 +186,270 @@ Log* Log::instance()
     return sInstance;
 }
 
+namespace {
+
+struct LogRecord
+{
+    qint64 time;
+    QString category;
+    QString context;
+    QString message;
+};
+
+// Bounded queue that any thread can push to without taking a lock, and that
+// a single consumer pops from. Every slot carries a sequence number telling
+// whether it is free for the producer at a given position or filled for the
+// consumer.
+class LogRing
+{
+public:
+    explicit LogRing(uint capacity)
+        : mSlots(new Slot[capacity])
+        , mMask(capacity - 1)
+        , mDequeuePos(0)
+    {
+        Q_ASSERT((capacity & mMask) == 0);
+        for (uint i = 0; i < capacity; ++i) {
+            mSlots[i].sequence.store(int(i));
+        }
+    }
+
+    // Returns false when the queue is full
+    bool push(const LogRecord &record)
+    {
+        uint pos = uint(mEnqueuePos.loadAcquire());
+        Slot *slot;
+        Q_FOREVER {
+            slot = &mSlots[pos & mMask];
+            const int diff = int(uint(slot->sequence.loadAcquire()) - pos);
+            if (diff == 0) {
+                if (mEnqueuePos.testAndSetRelaxed(int(pos), int(pos + 1))) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            }
+            pos = uint(mEnqueuePos.loadAcquire());
+        }
+        slot->record = record;
+        slot->sequence.storeRelease(int(pos + 1));
+        return true;
+    }
+
+    // Only for the consumer
+    bool pop(LogRecord &record)
+    {
+        Slot &slot = mSlots[mDequeuePos & mMask];
+        if (int(uint(slot.sequence.loadAcquire()) - (mDequeuePos + 1)) < 0) {
+            return false;
+        }
+        record = slot.record;
+        slot.record = LogRecord();
+        slot.sequence.storeRelease(int(mDequeuePos + mMask + 1));
+        ++mDequeuePos;
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        const Slot &slot = mSlots[mDequeuePos & mMask];
+        return int(uint(slot.sequence.loadAcquire()) - (mDequeuePos + 1)) < 0;
+    }
+
+private:
+    struct Slot
+    {
+        QAtomicInt sequence;
+        LogRecord record;
+    };
+
+    QScopedArrayPointer<Slot> mSlots;
+    const uint mMask;
+    QAtomicInt mEnqueuePos;
+    uint mDequeuePos;
+};
+
+}
+
 using namespace KScreen;
 class Log::Private
 {
   public:
+      Private();
+      ~Private();
+
+      void start();
+      void stop();
+      void post(const LogRecord &record);
+      // Writes out everything queued, with consumerMutex held
+      void drain();
+      bool openFile();
+      void rotate();
+      QString timestamp(qint64 time);
+
+      static void flushOnExit();
+
       QString context;
       bool enabled = false;
       QString logFile;
+      qint64 maxSize = 10 * 1024 * 1024;
+
+      LogRing ring;
+      QAtomicInt dropped;
+      QMutex consumerMutex;
+      QFile file;
+      QThread *writer = nullptr;
+      QSemaphore wakeup;
+      QAtomicInt writerSleeping;
+      QAtomicInt quit;
+
+      qint64 cachedSecond = -1;
+      QString cachedTimestamp;
+};
+
+namespace {
+
+class LogWriter : public QThread
+{
+public:
+    explicit LogWriter(std::function<void()> &&loop)
+        : mLoop(loop)
+    {
+        setObjectName(QStringLiteral("KScreen::Log writer"));
+    }
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        mLoop();
+    }
+
+private:
+    std::function<void()> mLoop;
 };
 
+}
+
+Log::Private::Private()
+    : ring(4096)
+{
+}
+
+Log::Private::~Private()
+{
+    stop();
+}
+
+void Log::Private::start()
+{
+    writer = new LogWriter([this]() {
+        Q_FOREVER {
+            // Only sleep when there's nothing queued, producers wake us up
+            // when they see that we do
+            writerSleeping.storeRelease(1);
+            if (ring.isEmpty() || !writerSleeping.testAndSetOrdered(1, 0)) {
+                wakeup.acquire();
+            }
+            if (quit.loadAcquire()) {
+                return;
+            }
+            QMutexLocker locker(&consumerMutex);
+            drain();
+        }
+    });
+    writer->start(QThread::LowPriority);
+}
+
+void Log::Private::stop()
+{
+    if (!writer) {
+        return;
+    }
+    quit.storeRelease(1);
+    wakeup.release();
+    writer->wait();
+    delete writer;
+    writer = nullptr;
+
+    QMutexLocker locker(&consumerMutex);
+    drain();
+    file.close();
+}
+
+void Log::Private::post(const LogRecord &record)
+{
+    if (!ring.push(record)) {
+        // Rather lose messages than block whoever is logging
+        dropped.ref();
+        return;
+    }
+    if (writerSleeping.testAndSetOrdered(1, 0)) {
+        wakeup.release();
+    }
+}
+
+bool Log::Private::openFile()
+{
+    file.close();
+    file.setFileName(logFile);
+    return file.open(QIODevice::Append | QIODevice::Text);
+}
+
+void Log::Private::rotate()
+{
+    const QString rotated = logFile + QLatin1String(".1");
+    file.close();
+    QFile::remove(rotated);
+    QFile::rename(logFile, rotated);
+    openFile();
+}
+
+QString Log::Private::timestamp(qint64 time)
+{
+    // Formatting a date is slow, reuse it for all messages of the same second
+    const qint64 second = time / 1000;
+    if (second != cachedSecond) {
+        cachedSecond = second;
+        cachedTimestamp = QDateTime::fromMSecsSinceEpoch(second * 1000).toString(QStringLiteral("dd.MM.yyyy hh:mm:ss"));
+    }
+    return QStringLiteral("%1.%2").arg(cachedTimestamp).arg(time % 1000, 3, 10, QLatin1Char('0'));
+}
+
+void Log::Private::drain()
+{
+    QByteArray batch;
+    LogRecord record;
+    while (ring.pop(record)) {
+        batch += QStringLiteral("\n%1 ; %2 ; %3 : %4").arg(timestamp(record.time), record.category,
+                                                           record.context, record.message).toUtf8();
+    }
+    const int lost = dropped.fetchAndStoreRelaxed(0);
+    if (lost > 0) {
+        batch += QStringLiteral("\n%1 ; log ; : %2 messages dropped, logging too fast")
+                     .arg(timestamp(QDateTime::currentMSecsSinceEpoch())).arg(lost).toUtf8();
+    }
+    if (batch.isEmpty()) {
+        return;
+    }
+
+    // The file may have been removed or rotated away behind our back
+    if (!file.isOpen() || !QFile::exists(logFile)) {
+        if (!openFile()) {
+            return;
+        }
+    }
+    file.write(batch);
+    file.flush();
+    if (maxSize > 0 && file.size() >= maxSize) {
+        rotate();
+    }
+}
+
+void Log::Private::flushOnExit()
+{
+    Log::flush();
+}
+
 Log::Log() :
    d(new Private)
 {
@@ -72,17 +461,32 @@ Log::Log() :
             d->enabled = true;
         }
     }
+    const QString rules = QString::fromLocal8Bit(qgetenv("KSCREEN_LOGGING_RULES"));
+    if (!rules.isEmpty()) {
+        setLogRules(rules);
+    }
     if (!d->enabled) {
          return;
     }
+    if (rules.isEmpty()) {
+        setLogRules(QStringLiteral("kscreen.*=debug"));
+    }
     d->logFile = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/kscreen/kscreen.log";
 
-    QLoggingCategory::setFilterRules("kscreen.*=true");
+    bool ok = false;
+    const qint64 maxSize = qgetenv("KSCREEN_LOGFILE_MAXSIZE").toLongLong(&ok);
+    if (ok) {
+        d->maxSize = maxSize;
+    }
+
     QFileInfo fi(d->logFile);
     if (!QDir().mkpath(fi.absolutePath())) {
         qWarning() << "Failed to create logging dir" << fi.absolutePath();
     }
 
+    d->start();
+    qAddPostRoutine(&Log::Private::flushOnExit);
+
     if (!sDefaultMessageHandler) {
         sDefaultMessageHandler = qInstallMessageHandler(kscreenLogOutput);
     }
@@ -121,18 +525,54 @@ QString Log::logFile() const
 
 void Log::log(const QString &msg, const QString &category)
 {
-    if (!instance()->enabled()) {
+    Log *log = instance();
+    TraceLog *trace = TraceLog::instance();
+    if (!log->enabled() && !trace->isEnabled()) {
         return;
     }
     auto _cat = category;
     _cat.remove("kscreen.");
-    const QString timestamp = QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm:ss.zzz");
-    QString logMessage = QString("\n%1 ; %2 ; %3 : %4").arg(timestamp, _cat, instance()->context(), msg);
-    QFile file(instance()->logFile());
-    if (!file.open(QIODevice::Append | QIODevice::Text)) {
+    trace->record(TraceLog::Message, _cat, log->context(), msg.toUtf8());
+    if (!log->enabled()) {
+        return;
+    }
+    // Formatting and writing happens on the writer thread
+    log->d->post(LogRecord{ QDateTime::currentMSecsSinceEpoch(), _cat, log->context(), msg });
+}
+
+void Log::setLogRules(const QString &rules)
+{
+    {
+        QMutexLocker locker(&sLogRules->mutex);
+        sLogRules->text = rules;
+        sLogRules->rules = parseLogRules(rules);
+    }
+
+    // Installing the filter runs it on all existing categories
+    const QLoggingCategory::CategoryFilter previousFilter = QLoggingCategory::installFilter(kscreenCategoryFilter);
+    if (previousFilter != kscreenCategoryFilter) {
+        {
+            QMutexLocker locker(&sLogRules->mutex);
+            sLogRules->previousFilter = previousFilter;
+        }
+        // Once more, with Qt's defaults underneath
+        QLoggingCategory::installFilter(kscreenCategoryFilter);
+    }
+}
+
+QString Log::logRules()
+{
+    QMutexLocker locker(&sLogRules->mutex);
+    return sLogRules->text;
+}
+
+void Log::flush()
+{
+    if (!sInstance || !sInstance->enabled()) {
         return;
     }
-    file.write(logMessage.toUtf8());
+    QMutexLocker locker(&sInstance->d->consumerMutex);
+    sInstance->d->drain();
 }
 
 } // ns
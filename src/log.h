@@ -40,6 +40,14 @@ void log(const QString& msg);
  * - disable logging by setting
  * KSCREEN_LOGGING=false
  * - set the log file to a custom path, the default is in ~/.local/share/kscreen/kscreen.log
+ * - set the verbosity of single categories with KSCREEN_LOGGING_RULES, see setLogRules(), all
+ * kscreen categories log debug messages by default
+ * - set the size in bytes at which the log file is rotated to kscreen.log.1, by setting
+ * KSCREEN_LOGFILE_MAXSIZE, the default is 10 MiB
+ *
+ * Messages are queued and written to the file by a background thread, use flush() to make sure
+ * they have been written. This happens on its own when the application exits and on qFatal().
+ * Messages still queued when the process crashes are lost.
  *
  * Please do not translate messages written to the logs, it's developer information and should be
  * english, independent from the user's locale preferences.
@@ -68,6 +76,38 @@ class KSCREEN_EXPORT Log
          */
         static void log(const QString &msg, const QString &category = QString());
 
+        /** Set the verbosity of logging categories
+         *
+         * The rules are separated by semicolons, commas or whitespace, each in the form
+         * "<category>=<level>". The level is one of debug, info, warning, critical or off.
+         * A category name ending in * matches all categories starting with it, the exact name
+         * or else the longest match wins. Categories without a matching rule follow Qt's rules.
+         *
+         * @code
+         * Log::setLogRules("kscreen.*=warning;kscreen.xrandr=debug");
+         * @endcode
+         *
+         * The backend launcher offers the same as setLogRules() on D-Bus.
+         *
+         * @arg rules The rules, replacing the ones set before.
+         * @since 5.12
+         */
+        static void setLogRules(const QString &rules);
+
+        /** The rules set by setLogRules()
+         *
+         * @since 5.12
+         */
+        static QString logRules();
+
+        /** Write all queued messages to the log file
+         *
+         * Blocks until the messages logged so far are in the file.
+         *
+         * @since 5.12
+         */
+        static void flush();
+
         /** Context for the logs.
          *
          * The context can be used to indicate what is going on overall, it is used to be able
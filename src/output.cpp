@@ -23,6 +23,7 @@
 #include "abstractbackend.h"
 #include "backendmanager_p.h"
 #include "debug_p.h"
+#include "usdt_p.h"
 
 #include <QStringList>
 #include <QPointer>
@@ -499,6 +500,8 @@ QRect Output::geometry() const
 
 void Output::apply(const OutputPtr& other)
 {
+    KSCREEN_PROBE2(output_apply_entry, d->id, other->d->modeList.count());
+
     typedef void (KScreen::Output::*ChangeSignal)();
     QList<ChangeSignal> changes;
 
@@ -570,6 +573,8 @@ void Output::apply(const OutputPtr& other)
 
     blockSignals(keepBlocked);
 
+    // Fires before the change signals, which run client code
+    KSCREEN_PROBE2(output_apply_return, d->id, changes.count());
     while (!changes.isEmpty()) {
         const ChangeSignal &sig = changes.first();
         Q_EMIT (this->*sig)();
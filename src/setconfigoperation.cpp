@@ -26,8 +26,11 @@
 #include "configserializer_p.h"
 #include "debug_p.h"
 #include "output.h"
+#include "setconfigresult.h"
 
+#include <QDBusMessage>
 #include <QDBusPendingCallWatcher>
+#include <QPointer>
 #include <QDBusPendingCall>
 
 using namespace KScreen;
@@ -40,13 +43,19 @@ class SetConfigOperationPrivate : public ConfigOperationPrivate
     Q_OBJECT
 
 public:
-    explicit SetConfigOperationPrivate(const KScreen::ConfigPtr &config, ConfigOperation* qq);
+    explicit SetConfigOperationPrivate(const KScreen::ConfigPtr &config, Context *context, ConfigOperation* qq);
 
     void backendReady(org::kde::kscreen::Backend* backend) Q_DECL_OVERRIDE;
     void onConfigSet(QDBusPendingCallWatcher *watcher);
-    void normalizeOutputPositions();
+
+    // For in-process
+    void onConfigApplied(KScreen::SetConfigResult *result);
+    void setConfigThreaded(KScreen::AbstractBackend *backend);
+    void onInProcessConfigSet(const QString &error, const KScreen::ConfigPtr &applied);
 
     KScreen::ConfigPtr config;
+    int revertTimeout;
+    quint32 transactionId;
 
 private:
     Q_DECLARE_PUBLIC(SetConfigOperation)
@@ -54,9 +63,11 @@ private:
 
 }
 
-SetConfigOperationPrivate::SetConfigOperationPrivate(const ConfigPtr &config, ConfigOperation* qq)
-    : ConfigOperationPrivate(qq)
+SetConfigOperationPrivate::SetConfigOperationPrivate(const ConfigPtr &config, Context *context, ConfigOperation* qq)
+    : ConfigOperationPrivate(qq, context)
     , config(config)
+    , revertTimeout(0)
+    , transactionId(0)
 {
 }
 
@@ -72,14 +83,17 @@ void SetConfigOperationPrivate::backendReady(org::kde::kscreen::Backend* backend
         return;
     }
 
-    const QVariantMap map = ConfigSerializer::serializeConfig(config).toVariantMap();
+    QVariantMap map = ConfigSerializer::serializeConfig(config).toVariantMap();
     if (map.isEmpty()) {
         q->setError(tr("Failed to serialize request"));
         q->emitResult();
         return;
     }
 
-    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(backend->setConfig(map), this);
+    markPhase(ConfigOperation::RequestSent);
+    QDBusPendingCall call = revertTimeout > 0 ? QDBusPendingCall(backend->setConfigWithRevert(map, revertTimeout))
+                                              : QDBusPendingCall(backend->setConfig(map));
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(call, this);
     connect(watcher, &QDBusPendingCallWatcher::finished,
             this, &SetConfigOperationPrivate::onConfigSet);
 }
@@ -88,25 +102,37 @@ void SetConfigOperationPrivate::onConfigSet(QDBusPendingCallWatcher *watcher)
 {
     Q_Q(SetConfigOperation);
 
-    QDBusPendingReply<QVariantMap> reply = *watcher;
+    markPhase(ConfigOperation::ReplyReceived);
     watcher->deleteLater();
 
-    if (reply.isError()) {
-        q->setError(reply.error().message());
+    if (watcher->isError()) {
+        q->setError(watcher->error().message());
         q->emitResult();
         return;
     }
 
-    config = ConfigSerializer::deserializeConfig(reply.value());
+    // setConfigWithRevert() also returns the transaction
+    const QVariantList arguments = watcher->reply().arguments();
+    if (revertTimeout > 0) {
+        transactionId = arguments.value(1).toUInt();
+    }
+    config = ConfigSerializer::deserializeConfig(qdbus_cast<QVariantMap>(arguments.value(0)));
     if (!config) {
         q->setError(tr("Failed to deserialize backend response"));
+    } else {
+        markPhase(ConfigOperation::Deserialized);
     }
 
     q->emitResult();
 }
 
 SetConfigOperation::SetConfigOperation(const ConfigPtr &config, QObject* parent)
-    : ConfigOperation(new SetConfigOperationPrivate(config, this), parent)
+    : ConfigOperation(new SetConfigOperationPrivate(config, Q_NULLPTR, this), parent)
+{
+}
+
+SetConfigOperation::SetConfigOperation(Context *context, const ConfigPtr &config, QObject* parent)
+    : ConfigOperation(new SetConfigOperationPrivate(config, context, this), parent)
 {
 }
 
@@ -120,46 +146,90 @@ ConfigPtr SetConfigOperation::config() const
     return d->config;
 }
 
+void SetConfigOperation::setRevertTimeout(int msecs)
+{
+    Q_D(SetConfigOperation);
+    d->revertTimeout = qMax(0, msecs);
+}
+
+int SetConfigOperation::revertTimeout() const
+{
+    Q_D(const SetConfigOperation);
+    return d->revertTimeout;
+}
+
+quint32 SetConfigOperation::transactionId() const
+{
+    Q_D(const SetConfigOperation);
+    return d->transactionId;
+}
+
 void SetConfigOperation::start()
 {
     Q_D(SetConfigOperation);
-    d->normalizeOutputPositions();
-    if (BackendManager::instance()->method() == BackendManager::InProcess) {
+    d->markPhase(Started);
+    d->normalizeOutputPositions(d->config);
+    if (d->backendManager()->method() == BackendManager::InProcess) {
+        if (d->revertTimeout > 0) {
+            qCWarning(KSCREEN) << "In-process backends don't revert configs, applying without revert timeout";
+        }
         auto backend = d->loadBackend();
-        backend->setConfig(d->config);
-        emitResult();
+        if (!backend) {
+            return;
+        }
+        if (backend->thread() != thread()) {
+            d->setConfigThreaded(backend);
+            return;
+        }
+        d->markPhase(RequestSent);
+        KScreen::SetConfigResult *result = backend->setConfigAsync(d->config);
+        connect(result, &KScreen::SetConfigResult::finished,
+                d, &SetConfigOperationPrivate::onConfigApplied);
     } else {
         d->requestBackend();
     }
 }
 
-void SetConfigOperationPrivate::normalizeOutputPositions()
+void SetConfigOperationPrivate::onConfigApplied(KScreen::SetConfigResult *result)
 {
-    if (!config) {
-        return;
-    }
-    int offsetX = INT_MAX;
-    int offsetY = INT_MAX;
-    Q_FOREACH (const KScreen::OutputPtr &output, config->outputs()) {
-        if (!output->isConnected() || !output->isEnabled()) {
-            continue;
-        }
-        offsetX = qMin(output->pos().x(), offsetX);
-        offsetY = qMin(output->pos().y(), offsetY);
-    }
+    onInProcessConfigSet(result->errorString(), result->config());
+}
 
-    if (!offsetX && !offsetY) {
-        return;
+void SetConfigOperationPrivate::setConfigThreaded(KScreen::AbstractBackend *backend)
+{
+    // The backend keeps the config it is given, so give it a copy of its own
+    // instead of sharing ours across threads
+    const QPointer<SetConfigOperationPrivate> guard(this);
+    BackendManager *manager = backendManager();
+    const ConfigPtr request = config ? config->clone() : ConfigPtr();
+    markPhase(ConfigOperation::RequestSent);
+    BackendManager::invokeInThread(backend, [=]() {
+        KScreen::SetConfigResult *result = backend->setConfigAsync(request);
+        // Finished in the backend thread, which keeps modifying its config
+        QObject::connect(result, &KScreen::SetConfigResult::finished, [=](KScreen::SetConfigResult *finished) {
+            const QString error = finished->errorString();
+            const ConfigPtr applied = finished->config() ? finished->config()->clone() : ConfigPtr();
+            BackendManager::invokeInThread(manager, [=]() {
+                if (guard) {
+                    guard->onInProcessConfigSet(error, applied);
+                }
+            });
+        });
+    });
+}
+
+void SetConfigOperationPrivate::onInProcessConfigSet(const QString &error, const KScreen::ConfigPtr &applied)
+{
+    Q_Q(SetConfigOperation);
+    markPhase(ConfigOperation::ReplyReceived);
+    if (!error.isEmpty()) {
+        q->setError(error);
     }
-    qCDebug(KSCREEN) << "Correcting output positions by:" << QPoint(offsetX, offsetY);
-    Q_FOREACH (const KScreen::OutputPtr &output, config->outputs()) {
-        if (!output->isConnected() || !output->isEnabled()) {
-            continue;
-        }
-        QPoint newPos = QPoint(output->pos().x() - offsetX, output->pos().y() - offsetY);
-        qCDebug(KSCREEN) << "Moved output from" << output->pos() << "to" << newPos;
-        output->setPos(newPos);
+    // Like out of process, the result is what the backend ended up with
+    if (applied) {
+        config = applied;
     }
+    q->emitResult();
 }
 
 #include "setconfigoperation.moc"
@@ -33,10 +33,43 @@ class KSCREEN_EXPORT SetConfigOperation : public KScreen::ConfigOperation
     Q_OBJECT
 public:
     explicit SetConfigOperation(const KScreen::ConfigPtr &config, QObject* parent = 0);
+    /**
+     * Applies @p config to the backend of @p context
+     *
+     * @param context the context to talk to, the default context if null
+     * @since 5.12
+     */
+    explicit SetConfigOperation(KScreen::Context *context, const KScreen::ConfigPtr &config, QObject* parent = 0);
     ~SetConfigOperation();
 
     KScreen::ConfigPtr config() const Q_DECL_OVERRIDE;
 
+    /**
+     * Has the config reverted after @p msecs unless it is confirmed
+     *
+     * The backend launcher keeps the config from before the change and applies
+     * it again when the change is not confirmed with a ConfirmConfigOperation
+     * in time, also when this process hangs or is gone by then. Must be set
+     * before the operation starts, that is before control returns to the event
+     * loop or exec() is called.
+     *
+     * In-process backends don't revert, the config is applied without a
+     * transaction.
+     *
+     * @param msecs the time to wait for confirmation, 0 to not revert
+     * @since 5.12
+     */
+    void setRevertTimeout(int msecs);
+    int revertTimeout() const;
+
+    /**
+     * @return the transaction to confirm to keep the config, or 0 when the
+     *         config is not reverted
+     * @see setRevertTimeout()
+     * @since 5.12
+     */
+    quint32 transactionId() const;
+
 protected:
     void start() Q_DECL_OVERRIDE;
 
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2026  agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "setconfigresult.h"
+#include "config.h"
+
+using namespace KScreen;
+
+class SetConfigResult::Private
+{
+public:
+    Private()
+        : finished(false)
+    {
+    }
+
+    KScreen::ConfigPtr config;
+    QString error;
+    bool finished;
+};
+
+SetConfigResult::SetConfigResult(QObject *parent)
+    : QObject(parent)
+    , d(new Private)
+{
+}
+
+SetConfigResult::~SetConfigResult()
+{
+    delete d;
+}
+
+bool SetConfigResult::isFinished() const
+{
+    return d->finished;
+}
+
+bool SetConfigResult::hasError() const
+{
+    return !d->error.isEmpty();
+}
+
+QString SetConfigResult::errorString() const
+{
+    return d->error;
+}
+
+ConfigPtr SetConfigResult::config() const
+{
+    return d->config;
+}
+
+void SetConfigResult::setConfig(const ConfigPtr &config)
+{
+    d->config = config;
+}
+
+void SetConfigResult::setError(const QString &error)
+{
+    d->error = error;
+}
+
+void SetConfigResult::emitResult()
+{
+    Q_ASSERT(!d->finished);
+    if (d->finished) {
+        return;
+    }
+    d->finished = true;
+    const bool ok = QMetaObject::invokeMethod(this, "doEmitResult", Qt::QueuedConnection);
+    Q_ASSERT(ok);
+    Q_UNUSED(ok);
+}
+
+void SetConfigResult::doEmitResult()
+{
+    Q_EMIT finished(this);
+    deleteLater();
+}
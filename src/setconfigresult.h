@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026  agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef KSCREEN_SETCONFIGRESULT_H
+#define KSCREEN_SETCONFIGRESULT_H
+
+#include <QObject>
+
+#include "kscreen_export.h"
+#include "types.h"
+
+namespace KScreen
+{
+
+/**
+ * Completion handle of AbstractBackend::setConfigAsync()
+ *
+ * The backend finishes it once it knows whether the config was applied,
+ * with the config it ended up with or with an error. finished() is always
+ * emitted from the event loop of the thread the result lives in, so it can
+ * be connected to right after the result was returned. The result deletes
+ * itself afterwards.
+ *
+ * @since 5.12
+ */
+class KSCREEN_EXPORT SetConfigResult : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SetConfigResult(QObject *parent = Q_NULLPTR);
+    virtual ~SetConfigResult();
+
+    /**
+     * @return whether emitResult() was called
+     */
+    bool isFinished() const;
+
+    bool hasError() const;
+    QString errorString() const;
+
+    /**
+     * @return the configuration of the system after applying, also when the
+     *         backend failed to apply and could tell what it is
+     */
+    KScreen::ConfigPtr config() const;
+
+    void setConfig(const KScreen::ConfigPtr &config);
+    void setError(const QString &error);
+
+    /**
+     * Finishes the result, emits finished() from the event loop
+     */
+    void emitResult();
+
+Q_SIGNALS:
+    void finished(KScreen::SetConfigResult *result);
+
+private Q_SLOTS:
+    void doEmitResult();
+
+private:
+    Q_DISABLE_COPY(SetConfigResult)
+
+    class Private;
+    Private * const d;
+};
+
+} // namespace KScreen
+
+#endif // KSCREEN_SETCONFIGRESULT_H
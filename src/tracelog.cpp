@@ -0,0 +1,552 @@
+/*************************************************************************************
+ *  Copyright 2026 by agent <agent@local>                                            *
+ *                                                                                   *
+ *  This library is free software; you can redistribute it and/or                    *
+ *  modify it under the terms of the GNU Lesser General Public                       *
+ *  License as published by the Free Software Foundation; either                     *
+ *  version 2.1 of the License, or (at your option) any later version.               *
+ *                                                                                   *
+ *  This library is distributed in the hope that it will be useful,                  *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of                   *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU                *
+ *  Lesser General Public License for more details.                                  *
+ *                                                                                   *
+ *  You should have received a copy of the GNU Lesser General Public                 *
+ *  License along with this library; if not, write to the Free Software              *
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA       *
+ *************************************************************************************/
+
+#include "tracelog_p.h"
+#include "tracing_p.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QStandardPaths>
+
+#ifdef Q_OS_UNIX
+#include <sys/file.h>
+#endif
+
+#include <string.h>
+
+using namespace KScreen;
+
+namespace
+{
+
+// The file starts with a FileHeader, followed by the string table and the
+// ring of records. Records are 8-byte aligned and never wrap around the end
+// of the ring: a Padding record fills the rest, or, when even a header would
+// not fit, the remaining bytes are just skipped.
+
+struct FileHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 stringCount;
+    quint64 capacity;   // size of the ring
+    quint64 head;       // absolute position of the next record
+    quint64 tail;       // absolute position of the oldest record
+    qint64 wallBase;    // wall clock of the last Start, in microseconds
+    qint64 timeBase;    // monotonic time of the last Start
+    quint64 reserved;
+};
+Q_STATIC_ASSERT(sizeof(FileHeader) == 64);
+
+struct RecordHeader
+{
+    quint64 time;
+    quint32 payloadSize;
+    quint16 event;
+    quint16 category;
+    quint16 context;
+    quint16 reserved16;
+    quint32 reserved32;
+};
+Q_STATIC_ASSERT(sizeof(RecordHeader) == 24);
+
+static const char s_magic[8] = { 'K', 'S', 'T', 'R', 'A', 'C', 'E', '\0' };
+static const quint32 s_version = 1;
+static const int s_maxStrings = 512;
+static const int s_stringSize = 64;
+static const qint64 s_ringOffset = sizeof(FileHeader) + s_maxStrings * s_stringSize;
+static const qint64 s_defaultCapacity = 4 * 1024 * 1024;
+static const int s_extraSlots = 3;
+
+static quint64 alignedSize(quint64 size)
+{
+    return (size + 7) & ~quint64(7);
+}
+
+// Position of the record following the one at @p pos
+static quint64 nextRecord(const uchar *ring, quint64 capacity, quint64 pos)
+{
+    const quint64 offset = pos % capacity;
+    if (capacity - offset < sizeof(RecordHeader)) {
+        return pos + (capacity - offset);
+    }
+    RecordHeader header;
+    memcpy(&header, ring + offset, sizeof(header));
+    return pos + alignedSize(sizeof(RecordHeader) + header.payloadSize);
+}
+
+static QString readString(const uchar *table, quint16 id, quint32 count)
+{
+    if (id == 0 || id > count) {
+        return QString();
+    }
+    const uchar *entry = table + (id - 1) * s_stringSize;
+    quint16 length;
+    memcpy(&length, entry, sizeof(length));
+    length = qMin<quint16>(length, s_stringSize - sizeof(length));
+    return QString::fromUtf8(reinterpret_cast<const char*>(entry + sizeof(length)), length);
+}
+
+static QString processName()
+{
+    if (QCoreApplication::instance() && !QCoreApplication::applicationName().isEmpty()) {
+        return QCoreApplication::applicationName();
+    }
+    return QStringLiteral("kscreen");
+}
+
+}
+
+class TraceLog::Private
+{
+public:
+    bool lock(const QString &path);
+    bool open(const QString &path, qint64 capacity);
+    quint16 stringId(const QString &string);
+    void write(quint16 event, const QString &category, const QString &context, const QByteArray &payload);
+
+    FileHeader *header() const
+    {
+        return reinterpret_cast<FileHeader*>(memory);
+    }
+
+    bool enabled = false;
+    QFile file;
+    uchar *memory = nullptr;
+    uchar *ring = nullptr;
+    quint64 capacity = 0;
+    QHash<QString, quint16> stringIds;
+    QMutex mutex;
+};
+
+bool TraceLog::Private::lock(const QString &path)
+{
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+#ifdef Q_OS_UNIX
+    // Another instance of the same program is already tracing to this file
+    if (flock(file.handle(), LOCK_EX | LOCK_NB) != 0) {
+        file.close();
+        return false;
+    }
+#endif
+    return true;
+}
+
+bool TraceLog::Private::open(const QString &path, qint64 requestedCapacity)
+{
+    const QFileInfo info(path);
+    QDir().mkpath(info.absolutePath());
+
+    // Concurrent instances take one of a few fixed slots next to the file,
+    // later runs reuse them like the file itself, so they don't pile up
+    bool locked = lock(path);
+    for (int slot = 1; !locked && slot <= s_extraSlots; ++slot) {
+        locked = lock(info.absolutePath() + QLatin1Char('/') + info.completeBaseName()
+                      + QLatin1Char('-') + QString::number(slot) + QLatin1Char('.') + info.suffix());
+    }
+    if (!locked) {
+        return false;
+    }
+
+    capacity = alignedSize(qMax<qint64>(requestedCapacity, 64 * 1024));
+    const qint64 fileSize = s_ringOffset + capacity;
+
+    // Keep the records of earlier runs when the layout still matches
+    bool reuse = false;
+    if (file.size() == fileSize) {
+        FileHeader existing;
+        if (file.read(reinterpret_cast<char*>(&existing), sizeof(existing)) == sizeof(existing)) {
+            reuse = memcmp(existing.magic, s_magic, sizeof(s_magic)) == 0
+                    && existing.version == s_version
+                    && existing.capacity == capacity
+                    && existing.stringCount <= quint32(s_maxStrings)
+                    && existing.tail <= existing.head
+                    && existing.head - existing.tail <= capacity;
+        }
+    }
+    if (!reuse && !file.resize(fileSize)) {
+        file.close();
+        return false;
+    }
+
+    memory = file.map(0, fileSize);
+    if (!memory) {
+        file.close();
+        return false;
+    }
+    ring = memory + s_ringOffset;
+
+    FileHeader *h = header();
+    if (reuse) {
+        const uchar *table = memory + sizeof(FileHeader);
+        for (quint32 id = 1; id <= h->stringCount; ++id) {
+            stringIds.insert(readString(table, id, h->stringCount), id);
+        }
+    } else {
+        memset(h, 0, sizeof(FileHeader));
+        memcpy(h->magic, s_magic, sizeof(s_magic));
+        h->version = s_version;
+        h->capacity = capacity;
+    }
+
+    const qint64 now = Tracing::now();
+    h->wallBase = QDateTime::currentMSecsSinceEpoch() * 1000;
+    h->timeBase = now;
+
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream << h->wallBase << h->timeBase << processName();
+    write(Start, QString(), QString(), payload);
+    return true;
+}
+
+quint16 TraceLog::Private::stringId(const QString &string)
+{
+    if (string.isEmpty()) {
+        return 0;
+    }
+    const auto it = stringIds.constFind(string);
+    if (it != stringIds.constEnd()) {
+        return *it;
+    }
+
+    FileHeader *h = header();
+    if (h->stringCount >= quint32(s_maxStrings)) {
+        return 0;
+    }
+    QByteArray utf8 = string.toUtf8();
+    utf8.truncate(s_stringSize - sizeof(quint16));
+    const quint16 length = utf8.size();
+    uchar *entry = memory + sizeof(FileHeader) + h->stringCount * s_stringSize;
+    memcpy(entry, &length, sizeof(length));
+    memcpy(entry + sizeof(length), utf8.constData(), length);
+
+    const quint16 id = ++h->stringCount;
+    stringIds.insert(string, id);
+    return id;
+}
+
+void TraceLog::Private::write(quint16 event, const QString &category, const QString &context,
+                              const QByteArray &payload)
+{
+    FileHeader *h = header();
+
+    RecordHeader record;
+    memset(&record, 0, sizeof(record));
+    record.time = Tracing::now();
+    record.payloadSize = quint32(qMin<quint64>(payload.size(), capacity / 4));
+    record.event = event;
+    record.category = stringId(category);
+    record.context = stringId(context);
+    const quint64 size = alignedSize(sizeof(RecordHeader) + record.payloadSize);
+
+    // Records don't wrap, skip to the start of the ring if this one would
+    quint64 offset = h->head % capacity;
+    const quint64 skip = (capacity - offset < size) ? capacity - offset : 0;
+
+    // Drop the oldest records until there is room
+    while (h->head + skip + size - h->tail > capacity) {
+        h->tail = nextRecord(ring, capacity, h->tail);
+    }
+
+    if (skip) {
+        if (skip >= sizeof(RecordHeader)) {
+            RecordHeader padding;
+            memset(&padding, 0, sizeof(padding));
+            padding.event = Padding;
+            padding.payloadSize = skip - sizeof(RecordHeader);
+            memcpy(ring + offset, &padding, sizeof(padding));
+        }
+        h->head += skip;
+        offset = 0;
+    }
+
+    memcpy(ring + offset, &record, sizeof(record));
+    memcpy(ring + offset + sizeof(record), payload.constData(), record.payloadSize);
+    // Only now the record becomes visible to readers
+    h->head += size;
+}
+
+TraceLog *TraceLog::instance()
+{
+    static TraceLog *s_instance = new TraceLog();
+    return s_instance;
+}
+
+TraceLog::TraceLog()
+    : d(new Private)
+{
+    // Nothing in here may log, the logging itself ends up in the trace
+    const QByteArray env = qgetenv("KSCREEN_TRACE");
+    if (env.isEmpty() || env == "0" || env.toLower() == "false") {
+        return;
+    }
+
+    QString path;
+    if (env == "1" || env.toLower() == "true") {
+        path = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation)
+               + QStringLiteral("/kscreen/") + processName() + QStringLiteral(".trace");
+    } else {
+        path = QFile::decodeName(env);
+    }
+
+    bool ok = false;
+    qint64 capacity = qgetenv("KSCREEN_TRACE_SIZE").toLongLong(&ok);
+    if (!ok || capacity <= 0) {
+        capacity = s_defaultCapacity;
+    }
+    d->enabled = d->open(path, capacity);
+}
+
+TraceLog::~TraceLog()
+{
+    delete d;
+}
+
+bool TraceLog::isEnabled() const
+{
+    return d->enabled;
+}
+
+QString TraceLog::fileName() const
+{
+    return d->enabled ? d->file.fileName() : QString();
+}
+
+void TraceLog::record(Event event, const QString &category, const QString &context,
+                      const QByteArray &payload)
+{
+    if (!d->enabled) {
+        return;
+    }
+    QMutexLocker locker(&d->mutex);
+    d->write(event, category, context, payload);
+}
+
+void TraceLog::recordConfig(Event event, const QString &category,
+                            const QJsonObject &before, const QJsonObject &after)
+{
+    if (!d->enabled) {
+        return;
+    }
+    const QJsonObject diff = configDiff(before, after);
+    if (diff.isEmpty()) {
+        return;
+    }
+    record(event, category, QString(), QJsonDocument(diff).toJson(QJsonDocument::Compact));
+}
+
+static QJsonObject objectDiff(const QJsonObject &before, const QJsonObject &after)
+{
+    QJsonObject diff;
+    for (auto it = after.constBegin(); it != after.constEnd(); ++it) {
+        if (before.value(it.key()) != it.value()) {
+            diff.insert(it.key(), it.value());
+        }
+    }
+    for (auto it = before.constBegin(); it != before.constEnd(); ++it) {
+        if (!after.contains(it.key())) {
+            diff.insert(it.key(), QJsonValue());
+        }
+    }
+    return diff;
+}
+
+static QHash<QString, QJsonObject> outputsById(const QJsonObject &config)
+{
+    QHash<QString, QJsonObject> outputs;
+    Q_FOREACH (const QJsonValue &value, config.value(QStringLiteral("outputs")).toArray()) {
+        const QJsonObject output = value.toObject();
+        outputs.insert(QString::number(output.value(QStringLiteral("id")).toInt()), output);
+    }
+    return outputs;
+}
+
+QJsonObject TraceLog::configDiff(const QJsonObject &before, const QJsonObject &after)
+{
+    // Outputs are keyed by their id, removed ones are null
+    const QHash<QString, QJsonObject> beforeOutputs = outputsById(before);
+    const QHash<QString, QJsonObject> afterOutputs = outputsById(after);
+    QJsonObject outputs;
+    for (auto it = afterOutputs.constBegin(); it != afterOutputs.constEnd(); ++it) {
+        if (!beforeOutputs.contains(it.key())) {
+            outputs.insert(it.key(), it.value());
+            continue;
+        }
+        const QJsonObject diff = objectDiff(beforeOutputs.value(it.key()), it.value());
+        if (!diff.isEmpty()) {
+            outputs.insert(it.key(), diff);
+        }
+    }
+    for (auto it = beforeOutputs.constBegin(); it != beforeOutputs.constEnd(); ++it) {
+        if (!afterOutputs.contains(it.key())) {
+            outputs.insert(it.key(), QJsonValue());
+        }
+    }
+
+    QJsonObject diff;
+    if (!outputs.isEmpty()) {
+        diff.insert(QStringLiteral("outputs"), outputs);
+    }
+    const QJsonObject screen = objectDiff(before.value(QStringLiteral("screen")).toObject(),
+                                          after.value(QStringLiteral("screen")).toObject());
+    if (!screen.isEmpty()) {
+        diff.insert(QStringLiteral("screen"), screen);
+    }
+    return diff;
+}
+
+QVector<TraceLog::Record> TraceLog::decode(const QString &fileName, QString *error)
+{
+    QVector<Record> records;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return records;
+    }
+    const QByteArray data = file.readAll();
+
+    FileHeader h;
+    if (data.size() < s_ringOffset) {
+        if (error) {
+            *error = QStringLiteral("File is too short to be a trace");
+        }
+        return records;
+    }
+    memcpy(&h, data.constData(), sizeof(h));
+    if (memcmp(h.magic, s_magic, sizeof(s_magic)) != 0 || h.version != s_version
+            || quint64(data.size()) < s_ringOffset + h.capacity || h.tail > h.head
+            || h.head - h.tail > h.capacity || h.stringCount > quint32(s_maxStrings)) {
+        if (error) {
+            *error = QStringLiteral("Not a trace or an unsupported version");
+        }
+        return records;
+    }
+
+    const uchar *table = reinterpret_cast<const uchar*>(data.constData()) + sizeof(FileHeader);
+    const uchar *ring = table + s_maxStrings * s_stringSize;
+
+    qint64 wallBase = -1;
+    qint64 timeBase = 0;
+    for (quint64 pos = h.tail; pos < h.head; pos = nextRecord(ring, h.capacity, pos)) {
+        const quint64 offset = pos % h.capacity;
+        if (h.capacity - offset < sizeof(RecordHeader)) {
+            continue;
+        }
+        RecordHeader header;
+        memcpy(&header, ring + offset, sizeof(header));
+        if (alignedSize(sizeof(RecordHeader) + header.payloadSize) > h.capacity - offset) {
+            if (error) {
+                *error = QStringLiteral("Corrupted record at %1").arg(pos);
+            }
+            break;
+        }
+        if (header.event == Padding) {
+            continue;
+        }
+
+        Record record;
+        record.time = header.time;
+        record.event = header.event;
+        record.category = readString(table, header.category, h.stringCount);
+        record.context = readString(table, header.context, h.stringCount);
+        record.payload = QByteArray(reinterpret_cast<const char*>(ring + offset + sizeof(RecordHeader)),
+                                    header.payloadSize);
+        if (record.event == Start) {
+            QDataStream stream(record.payload);
+            stream >> wallBase >> timeBase;
+        } else if (wallBase < 0 && record.time >= h.timeBase) {
+            // The Start of this run has been overwritten already
+            wallBase = h.wallBase;
+            timeBase = h.timeBase;
+        }
+        record.wallTime = wallBase < 0 ? -1 : wallBase + (record.time - timeBase);
+        records.append(record);
+    }
+    return records;
+}
+
+QString TraceLog::eventName(quint16 event)
+{
+    switch (event) {
+    case Padding:
+        return QStringLiteral("Padding");
+    case Start:
+        return QStringLiteral("Start");
+    case Message:
+        return QStringLiteral("Message");
+    case ConfigChanged:
+        return QStringLiteral("ConfigChanged");
+    case ConfigApplied:
+        return QStringLiteral("ConfigApplied");
+    case OperationFinished:
+        return QStringLiteral("OperationFinished");
+    }
+    return QStringLiteral("Event%1").arg(event);
+}
+
+static QString payloadText(const TraceLog::Record &record)
+{
+    if (record.event == TraceLog::Start) {
+        QDataStream stream(record.payload);
+        qint64 wall, time;
+        QString process;
+        stream >> wall >> time >> process;
+        return process;
+    }
+    return QString::fromUtf8(record.payload);
+}
+
+QString TraceLog::toText(const Record &record)
+{
+    const QString time = record.wallTime < 0
+        ? QStringLiteral("+%1us").arg(record.time)
+        : QDateTime::fromMSecsSinceEpoch(record.wallTime / 1000).toString(QStringLiteral("dd.MM.yyyy hh:mm:ss.zzz"));
+    return QStringLiteral("%1 ; %2 ; %3 ; %4 : %5").arg(time, record.category, record.context,
+                                                        eventName(record.event), payloadText(record));
+}
+
+QJsonObject TraceLog::toJson(const Record &record)
+{
+    QJsonObject obj;
+    obj.insert(QStringLiteral("time"), double(record.time));
+    obj.insert(QStringLiteral("wallTime"), record.wallTime < 0 ? QJsonValue()
+                : QJsonValue(QDateTime::fromMSecsSinceEpoch(record.wallTime / 1000).toString(Qt::ISODate)));
+    obj.insert(QStringLiteral("event"), eventName(record.event));
+    obj.insert(QStringLiteral("category"), record.category);
+    obj.insert(QStringLiteral("context"), record.context);
+    if (record.event == ConfigChanged || record.event == ConfigApplied) {
+        obj.insert(QStringLiteral("payload"), QJsonDocument::fromJson(record.payload).object());
+    } else {
+        obj.insert(QStringLiteral("payload"), payloadText(record));
+    }
+    return obj;
+}
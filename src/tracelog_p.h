@@ -0,0 +1,101 @@
+/*************************************************************************************
+ *  Copyright 2026 by agent <agent@local>                                            *
+ *                                                                                   *
+ *  This library is free software; you can redistribute it and/or                    *
+ *  modify it under the terms of the GNU Lesser General Public                       *
+ *  License as published by the Free Software Foundation; either                     *
+ *  version 2.1 of the License, or (at your option) any later version.               *
+ *                                                                                   *
+ *  This library is distributed in the hope that it will be useful,                  *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of                   *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU                *
+ *  Lesser General Public License for more details.                                  *
+ *                                                                                   *
+ *  You should have received a copy of the GNU Lesser General Public                 *
+ *  License along with this library; if not, write to the Free Software              *
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA       *
+ *************************************************************************************/
+
+#ifndef KSCREEN_TRACELOG_P_H
+#define KSCREEN_TRACELOG_P_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+#include "kscreen_export.h"
+
+namespace KScreen
+{
+
+/**
+ * Binary trace of display events, cheap enough to be left on permanently.
+ *
+ * Setting KSCREEN_TRACE to 1 or true records to
+ * ~/.local/share/kscreen/<application>.trace, any other value is taken as
+ * the path of the trace file. The file is a memory mapped ring buffer of
+ * KSCREEN_TRACE_SIZE bytes (4 MiB by default), the oldest records are
+ * overwritten once it is full. Since the file is mapped, the records
+ * survive a crash, and a restarted process keeps appending to them.
+ * While another process traces to the file, <name>-1.<suffix> up to
+ * <name>-3.<suffix> in the same directory are used instead, and nothing is
+ * recorded when all of them are taken.
+ *
+ * Every record has a fixed size header with a monotonic timestamp, the ids
+ * of its category and context strings and the event id, followed by the
+ * payload. The strings are kept in a table at the start of the file.
+ *
+ * kscreen-doctor --trace <file> decodes a trace into text or JSON.
+ */
+class KSCREEN_EXPORT TraceLog
+{
+public:
+    enum Event {
+        Padding = 0,        // fills the end of the ring, never decoded
+        Start,              // a process opened the trace
+        Message,            // UTF-8 text, see KScreen::Log
+        ConfigChanged,      // diff to the previous config, as compact JSON
+        ConfigApplied,      // diff a config applies to the current one, as compact JSON
+        OperationFinished   // phase timings of a ConfigOperation, as text
+    };
+
+    struct Record
+    {
+        qint64 time;        // monotonic, in microseconds
+        qint64 wallTime;    // microseconds since the epoch, -1 if unknown
+        quint16 event;
+        QString category;
+        QString context;
+        QByteArray payload;
+    };
+
+    static TraceLog *instance();
+    ~TraceLog();
+
+    bool isEnabled() const;
+    QString fileName() const;
+
+    void record(Event event, const QString &category, const QString &context,
+                const QByteArray &payload);
+    // Records the changes from @p before to @p after, two serialized configs
+    void recordConfig(Event event, const QString &category,
+                      const QJsonObject &before, const QJsonObject &after);
+
+    static QJsonObject configDiff(const QJsonObject &before, const QJsonObject &after);
+
+    static QVector<Record> decode(const QString &fileName, QString *error = nullptr);
+    static QString eventName(quint16 event);
+    static QString toText(const Record &record);
+    static QJsonObject toJson(const Record &record);
+
+private:
+    TraceLog();
+    Q_DISABLE_COPY(TraceLog)
+
+    class Private;
+    Private * const d;
+};
+
+}
+
+#endif // KSCREEN_TRACELOG_P_H
@@ -0,0 +1,120 @@
+/*************************************************************************************
+ *  Copyright 2026 by agent <agent@local>                                            *
+ *                                                                                   *
+ *  This library is free software; you can redistribute it and/or                    *
+ *  modify it under the terms of the GNU Lesser General Public                       *
+ *  License as published by the Free Software Foundation; either                     *
+ *  version 2.1 of the License, or (at your option) any later version.               *
+ *                                                                                   *
+ *  This library is distributed in the hope that it will be useful,                  *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of                   *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU                *
+ *  Lesser General Public License for more details.                                  *
+ *                                                                                   *
+ *  You should have received a copy of the GNU Lesser General Public                 *
+ *  License along with this library; if not, write to the Free Software              *
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA       *
+ *************************************************************************************/
+
+#include "tracing_p.h"
+#include "config.h"
+
+#include <QDBusArgument>
+#include <QElapsedTimer>
+
+#include <time.h>
+
+using namespace KScreen;
+
+static const char s_stampsProperty[] = "_kscreen_trace";
+
+qint64 Tracing::now()
+{
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+        return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+#endif
+    QElapsedTimer timer;
+    timer.start();
+    return timer.msecsSinceReference() * 1000;
+}
+
+QString Tracing::stampName(Stamp stamp)
+{
+    switch (stamp) {
+    case Origin:
+        return QStringLiteral("origin");
+    case Backend:
+        return QStringLiteral("backend");
+    case Launcher:
+        return QStringLiteral("launcher");
+    case Received:
+        return QStringLiteral("received");
+    case Delivered:
+        return QStringLiteral("delivered");
+    }
+    return QString();
+}
+
+qint64 Tracing::stampValue(const QVariantMap &stamps, Stamp stamp)
+{
+    return stamps.value(stampName(stamp), -1).toLongLong();
+}
+
+void Tracing::setStamp(QVariantMap &stamps, Stamp stamp, qint64 time)
+{
+    stamps.insert(stampName(stamp), time);
+}
+
+void Tracing::markOrigin(const ConfigPtr &config, qint64 origin)
+{
+    markOrigin(config.data(), origin);
+}
+
+void Tracing::markOrigin(QObject *object, qint64 origin)
+{
+    if (!object) {
+        return;
+    }
+    QVariantMap stamps;
+    setStamp(stamps, Origin, origin);
+    setStamp(stamps, Backend);
+    setStamps(object, stamps);
+}
+
+QVariantMap Tracing::takeStamps(const ConfigPtr &config)
+{
+    return takeStamps(config.data());
+}
+
+QVariantMap Tracing::takeStamps(QObject *object)
+{
+    if (!object) {
+        return QVariantMap();
+    }
+    const QVariantMap stamps = object->property(s_stampsProperty).toMap();
+    object->setProperty(s_stampsProperty, QVariant());
+    return stamps;
+}
+
+void Tracing::setStamps(const ConfigPtr &config, const QVariantMap &stamps)
+{
+    setStamps(config.data(), stamps);
+}
+
+void Tracing::setStamps(QObject *object, const QVariantMap &stamps)
+{
+    if (object) {
+        object->setProperty(s_stampsProperty, stamps.isEmpty() ? QVariant() : QVariant(stamps));
+    }
+}
+
+QVariantMap Tracing::fromVariant(const QVariant &variant)
+{
+    if (variant.userType() == qMetaTypeId<QDBusArgument>()) {
+        return qdbus_cast<QVariantMap>(variant.value<QDBusArgument>());
+    }
+    return variant.toMap();
+}
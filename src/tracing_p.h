@@ -0,0 +1,76 @@
+/*************************************************************************************
+ *  Copyright 2026 by agent <agent@local>                                            *
+ *                                                                                   *
+ *  This library is free software; you can redistribute it and/or                    *
+ *  modify it under the terms of the GNU Lesser General Public                       *
+ *  License as published by the Free Software Foundation; either                     *
+ *  version 2.1 of the License, or (at your option) any later version.               *
+ *                                                                                   *
+ *  This library is distributed in the hope that it will be useful,                  *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of                   *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU                *
+ *  Lesser General Public License for more details.                                  *
+ *                                                                                   *
+ *  You should have received a copy of the GNU Lesser General Public                 *
+ *  License along with this library; if not, write to the Free Software              *
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA       *
+ *************************************************************************************/
+
+#ifndef KSCREEN_TRACING_P_H
+#define KSCREEN_TRACING_P_H
+
+#include <QVariantMap>
+
+#include "types.h"
+#include "kscreen_export.h"
+
+class QObject;
+
+namespace KScreen
+{
+
+/**
+ * Timestamps following a change notification from the backend event that
+ * caused it to the ConfigMonitor of a client.
+ *
+ * The stamps are taken from the monotonic clock, in microseconds, which is
+ * shared by all processes of a session. Inside a process they travel as a
+ * property of the emitted Config, or of the Output or Screen of an
+ * incremental change, over D-Bus as the "trace" key of the serialized config.
+ */
+namespace Tracing
+{
+
+enum Stamp {
+    Origin,     // the backend received the event
+    Backend,    // the backend emitted configChanged()
+    Launcher,   // the launcher sent the change over D-Bus
+    Received,   // the client received the change
+    Delivered   // the client emitted configurationChanged()
+};
+
+KSCREEN_EXPORT qint64 now();
+
+KSCREEN_EXPORT QString stampName(Stamp stamp);
+KSCREEN_EXPORT qint64 stampValue(const QVariantMap &stamps, Stamp stamp);
+KSCREEN_EXPORT void setStamp(QVariantMap &stamps, Stamp stamp, qint64 time = now());
+
+// Marks @p config as caused by an event received at @p origin
+KSCREEN_EXPORT void markOrigin(const KScreen::ConfigPtr &config, qint64 origin);
+KSCREEN_EXPORT void markOrigin(QObject *object, qint64 origin);
+
+// Returns the stamps carried by @p config and removes them from it, so that
+// they don't stick to configs that are emitted more than once
+KSCREEN_EXPORT QVariantMap takeStamps(const KScreen::ConfigPtr &config);
+KSCREEN_EXPORT QVariantMap takeStamps(QObject *object);
+KSCREEN_EXPORT void setStamps(const KScreen::ConfigPtr &config, const QVariantMap &stamps);
+KSCREEN_EXPORT void setStamps(QObject *object, const QVariantMap &stamps);
+
+// Stamps as sent over D-Bus, which can arrive still marshalled
+KSCREEN_EXPORT QVariantMap fromVariant(const QVariant &variant);
+
+}
+
+}
+
+#endif // KSCREEN_TRACING_P_H
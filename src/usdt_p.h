@@ -0,0 +1,50 @@
+/*************************************************************************************
+ *  Copyright 2026 by agent <agent@local>                                            *
+ *                                                                                   *
+ *  This library is free software; you can redistribute it and/or                    *
+ *  modify it under the terms of the GNU Lesser General Public                       *
+ *  License as published by the Free Software Foundation; either                     *
+ *  version 2.1 of the License, or (at your option) any later version.               *
+ *                                                                                   *
+ *  This library is distributed in the hope that it will be useful,                  *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of                   *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU                *
+ *  Lesser General Public License for more details.                                  *
+ *                                                                                   *
+ *  You should have received a copy of the GNU Lesser General Public                 *
+ *  License along with this library; if not, write to the Free Software              *
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA       *
+ *************************************************************************************/
+
+#ifndef KSCREEN_USDT_P_H
+#define KSCREEN_USDT_P_H
+
+/*
+ * Static tracepoints for perf and bpftrace, under the "kscreen" provider.
+ *
+ * They are only compiled in when building with KSCREEN_ENABLE_USDT. Otherwise
+ * the macros expand to nothing and their arguments are not even evaluated,
+ * so keep the arguments free of side effects.
+ *
+ * See tools/kscreen-latency.bt for how to use them.
+ */
+
+#ifdef KSCREEN_ENABLE_USDT
+
+#include <sys/sdt.h>
+
+#define KSCREEN_PROBE(name) DTRACE_PROBE(kscreen, name)
+#define KSCREEN_PROBE1(name, a1) DTRACE_PROBE1(kscreen, name, a1)
+#define KSCREEN_PROBE2(name, a1, a2) DTRACE_PROBE2(kscreen, name, a1, a2)
+#define KSCREEN_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(kscreen, name, a1, a2, a3)
+
+#else
+
+#define KSCREEN_PROBE(name) do {} while (0)
+#define KSCREEN_PROBE1(name, a1) do {} while (0)
+#define KSCREEN_PROBE2(name, a1, a2) do {} while (0)
+#define KSCREEN_PROBE3(name, a1, a2, a3) do {} while (0)
+
+#endif
+
+#endif // KSCREEN_USDT_P_H
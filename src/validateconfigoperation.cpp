@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2026  agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "validateconfigoperation.h"
+
+#include "abstractbackend.h"
+#include "backendmanager_p.h"
+#include "configoperation_p.h"
+#include "config.h"
+#include "configserializer_p.h"
+#include "debug_p.h"
+
+#include <QDBusPendingCallWatcher>
+#include <QPointer>
+#include <QDBusPendingCall>
+
+using namespace KScreen;
+
+namespace KScreen
+{
+
+class ValidateConfigOperationPrivate : public ConfigOperationPrivate
+{
+    Q_OBJECT
+
+public:
+    explicit ValidateConfigOperationPrivate(const KScreen::ConfigPtr &config, Context *context, ConfigOperation* qq);
+
+    void backendReady(org::kde::kscreen::Backend* backend) Q_DECL_OVERRIDE;
+    void onConfigValidated(QDBusPendingCallWatcher *watcher);
+
+    // For in-process
+    void validateConfigThreaded(KScreen::AbstractBackend *backend);
+
+    KScreen::ConfigPtr config;
+    KScreen::ConfigViolations violations;
+
+private:
+    Q_DECLARE_PUBLIC(ValidateConfigOperation)
+};
+
+}
+
+ValidateConfigOperationPrivate::ValidateConfigOperationPrivate(const ConfigPtr &config, Context *context, ConfigOperation* qq)
+    : ConfigOperationPrivate(qq, context)
+    , config(config ? config->clone() : ConfigPtr())
+{
+}
+
+void ValidateConfigOperationPrivate::backendReady(org::kde::kscreen::Backend* backend)
+{
+    ConfigOperationPrivate::backendReady(backend);
+
+    Q_Q(ValidateConfigOperation);
+
+    if (!backend) {
+        q->setError(tr("Failed to prepare backend"));
+        q->emitResult();
+        return;
+    }
+
+    const QVariantMap map = ConfigSerializer::serializeConfig(config).toVariantMap();
+    if (map.isEmpty()) {
+        q->setError(tr("Failed to serialize request"));
+        q->emitResult();
+        return;
+    }
+
+    markPhase(ConfigOperation::RequestSent);
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(backend->validateConfig(map), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished,
+            this, &ValidateConfigOperationPrivate::onConfigValidated);
+}
+
+void ValidateConfigOperationPrivate::onConfigValidated(QDBusPendingCallWatcher *watcher)
+{
+    Q_Q(ValidateConfigOperation);
+
+    markPhase(ConfigOperation::ReplyReceived);
+    QDBusPendingReply<QVariantMap, QVariantList> reply = *watcher;
+    watcher->deleteLater();
+
+    if (reply.isError()) {
+        q->setError(reply.error().message());
+        q->emitResult();
+        return;
+    }
+
+    violations = ConfigSerializer::deserializeViolations(reply.argumentAt<1>());
+    const QVariantMap map = reply.argumentAt<0>();
+    config = map.isEmpty() ? ConfigPtr() : ConfigSerializer::deserializeConfig(map);
+    if (!config && violations.isEmpty()) {
+        q->setError(tr("Failed to deserialize backend response"));
+    } else {
+        markPhase(ConfigOperation::Deserialized);
+    }
+
+    q->emitResult();
+}
+
+void ValidateConfigOperationPrivate::validateConfigThreaded(KScreen::AbstractBackend *backend)
+{
+    const QPointer<ValidateConfigOperationPrivate> guard(this);
+    BackendManager *manager = backendManager();
+    const ConfigPtr request = config;
+    markPhase(ConfigOperation::RequestSent);
+    BackendManager::invokeInThread(backend, [=]() {
+        ConfigViolations result;
+        const ConfigPtr normalized = backend->validateConfig(request, &result);
+        BackendManager::invokeInThread(manager, [=]() {
+            if (guard) {
+                guard->markPhase(ConfigOperation::ReplyReceived);
+                guard->config = normalized;
+                guard->violations = result;
+                guard->q_func()->emitResult();
+            }
+        });
+    });
+}
+
+ValidateConfigOperation::ValidateConfigOperation(const ConfigPtr &config, QObject* parent)
+    : ConfigOperation(new ValidateConfigOperationPrivate(config, Q_NULLPTR, this), parent)
+{
+}
+
+ValidateConfigOperation::ValidateConfigOperation(Context *context, const ConfigPtr &config, QObject* parent)
+    : ConfigOperation(new ValidateConfigOperationPrivate(config, context, this), parent)
+{
+}
+
+ValidateConfigOperation::~ValidateConfigOperation()
+{
+}
+
+ConfigPtr ValidateConfigOperation::config() const
+{
+    Q_D(const ValidateConfigOperation);
+    return d->config;
+}
+
+ConfigViolations ValidateConfigOperation::violations() const
+{
+    Q_D(const ValidateConfigOperation);
+    return d->violations;
+}
+
+bool ValidateConfigOperation::isValid() const
+{
+    Q_D(const ValidateConfigOperation);
+    return !hasError() && d->config && d->violations.isEmpty();
+}
+
+void ValidateConfigOperation::start()
+{
+    Q_D(ValidateConfigOperation);
+    d->markPhase(Started);
+    // The same correction SetConfigOperation applies before sending
+    d->normalizeOutputPositions(d->config);
+    if (d->backendManager()->method() == BackendManager::InProcess) {
+        auto backend = d->loadBackend();
+        if (!backend) {
+            return;
+        }
+        if (backend->thread() != thread()) {
+            d->validateConfigThreaded(backend);
+            return;
+        }
+        d->markPhase(RequestSent);
+        d->config = backend->validateConfig(d->config, &d->violations);
+        d->markPhase(ReplyReceived);
+        emitResult();
+    } else {
+        d->requestBackend();
+    }
+}
+
+#include "validateconfigoperation.moc"
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2026  agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef KSCREEN_VALIDATECONFIGOPERATION_H
+#define KSCREEN_VALIDATECONFIGOPERATION_H
+
+#include "configoperation.h"
+#include "configviolation.h"
+#include "types.h"
+#include "kscreen_export.h"
+
+namespace KScreen {
+
+class ValidateConfigOperationPrivate;
+
+/**
+ * Asks the backend whether a config can be applied, without applying it
+ *
+ * Unlike Config::canBeApplied(), which checks the config against the last
+ * known state in this process, the backend checks it against the current
+ * state of the system and its own constraints, for example the CRTCs
+ * available to XRandR.
+ *
+ * @code
+ * auto op = new KScreen::ValidateConfigOperation(config);
+ * connect(op, &KScreen::ConfigOperation::finished, [](KScreen::ConfigOperation *op) {
+ *     auto validation = qobject_cast<KScreen::ValidateConfigOperation*>(op);
+ *     if (!validation->isValid()) {
+ *         qDebug() << validation->violations();
+ *     }
+ * });
+ * @endcode
+ *
+ * @since 5.12
+ */
+class KSCREEN_EXPORT ValidateConfigOperation : public KScreen::ConfigOperation
+{
+    Q_OBJECT
+public:
+    explicit ValidateConfigOperation(const KScreen::ConfigPtr &config, QObject* parent = 0);
+    /**
+     * Validates @p config against the backend of @p context
+     *
+     * @param context the context to talk to, the default context if null
+     */
+    explicit ValidateConfigOperation(KScreen::Context *context, const KScreen::ConfigPtr &config, QObject* parent = 0);
+    ~ValidateConfigOperation();
+
+    /**
+     * @return the config as the backend would apply it, the config passed to
+     *         the constructor is not modified
+     */
+    KScreen::ConfigPtr config() const Q_DECL_OVERRIDE;
+
+    /**
+     * @return why the config cannot be applied, empty if it can
+     */
+    KScreen::ConfigViolations violations() const;
+
+    /**
+     * @return whether the operation succeeded and the backend reported no violations
+     */
+    bool isValid() const;
+
+protected:
+    void start() Q_DECL_OVERRIDE;
+
+private:
+    Q_DECLARE_PRIVATE(ValidateConfigOperation)
+};
+
+}
+
+#endif // KSCREEN_VALIDATECONFIGOPERATION_H